@@ -32,6 +32,25 @@ float magnitude_est_cu8(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len);
 float magnitude_true_cu8(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len);
 float magnitude_est_cs16(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len);
 float magnitude_true_cs16(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len);
+/// Magnitude estimate of CF32 samples clamped to [-1,1], scaled as magnitude_est_cs16().
+float magnitude_est_cf32(float const *iq_buf, uint16_t *y_buf, uint32_t len);
+
+/// Input samples per block of the squelch estimate.
+#define SQUELCH_BLOCK_LEN 64
+/// Only every SQUELCH_STRIDE-th sample is looked at, pulses of PD_MIN_PULSE_SAMPLES always have two.
+#define SQUELCH_STRIDE 4
+
+/** Cheap level estimate of a frame for the squelch, from every SQUELCH_STRIDE-th sample.
+
+    Uses the envelope or magnitude estimate of the sample format, the levels compare to the full estimate.
+    @param iq_buf input samples
+    @param sample_size CU8: 2, CS16: 4, CF32: 8
+    @param use_mag_est use the magnitude estimate for CU8 samples
+    @param len number of samples
+    @param[out] peak_db level of the loudest block of SQUELCH_BLOCK_LEN samples
+    @return the average level in dB
+*/
+float baseband_squelch_estimate(void const *iq_buf, int sample_size, int use_mag_est, uint32_t len, float *peak_db);
 
 #define AMP_TO_DB(x) (10.0f * ((x) > 0 ? log10f(x) : 0) - 42.1442f)  // 10*log10f(16384.0f)
 #define MAG_TO_DB(x) (20.0f * ((x) > 0 ? log10f(x) : 0) - 84.2884f)  // 20*log10f(16384.0f)
@@ -86,17 +105,41 @@ tabulated magnitude and amplitude values:
 */
 
 #define FILTER_ORDER 1
+/// Maximum number of taps of the designed FIR low pass.
+#define LP_FIR_MAX_TAPS 127
+/// Second order sections of the designed Butterworth low pass.
+#define LP_BIQUAD_SECTIONS 2
+/// Samples per block of the biquad sections.
+#define LP_BLOCK_LEN 8
+
+/// AM low pass filter types.
+enum baseband_lp_type {
+    BASEBAND_LP_IIR    = 0, ///< Fixed first order IIR, butter(1, 0.05)
+    BASEBAND_LP_FIR    = 1, ///< Hamming windowed sinc FIR
+    BASEBAND_LP_BIQUAD = 2, ///< Butterworth biquad cascade
+};
 
 /// Filter state buffer.
 typedef struct filter_state {
     int16_t y[FILTER_ORDER];
     int16_t x[FILTER_ORDER];
+    int type;              ///< Filter type, see enum baseband_lp_type
+    uint32_t rate;         ///< Sample rate the filter is designed for
+    float cutoff;          ///< Cutoff the filter is designed for
+    unsigned num_taps;     ///< FIR taps, odd
+    float fir_coeffs[LP_FIR_MAX_TAPS];
+    float fir_hist[LP_FIR_MAX_TAPS - 1];               ///< Last FIR inputs, oldest first
+    float bq_coeffs[LP_BIQUAD_SECTIONS][5];            ///< b0, b1, b2, a1, a2 of each section
+    float bq_block[LP_BIQUAD_SECTIONS][LP_BLOCK_LEN + 4][LP_BLOCK_LEN]; ///< Block response of each section to y[-1], y[-2], x[-2], x[-1], x[0], ...
+    float bq_state[LP_BIQUAD_SECTIONS][4];             ///< x[-1], x[-2], y[-1], y[-2] of each section
 } filter_state_t;
 
 /// FM_Demod state buffer.
 typedef struct demodfm_state {
     int32_t xr;        ///< Last I/Q sample, real part
     int32_t xi;        ///< Last I/Q sample, imag part
+    float xr_f;        ///< Last I/Q sample, real part, CF32
+    float xi_f;        ///< Last I/Q sample, imag part, CF32
     int32_t xf;        ///< Last Instantaneous frequency
     int32_t yf;        ///< Last Instantaneous frequency, low pass filtered
     uint32_t rate;     ///< Current sample rate
@@ -109,9 +152,19 @@ typedef struct demodfm_state {
 /** Reset the lowpass filter to an initial state. */
 void baseband_low_pass_filter_reset(filter_state_t *lowpass_filter);
 
+/** Design the lowpass filter for a sample rate.
+
+    Does nothing if the type, sample rate, and cutoff are unchanged, otherwise also resets the filter.
+    @param type the filter type, see enum baseband_lp_type, the fixed IIR ignores the sample rate and cutoff
+    @param samp_rate the sample rate
+    @param cutoff cutoff frequency in Hz, or 0 for 10 kHz
+*/
+void baseband_low_pass_filter_setup(filter_state_t *state, int type, uint32_t samp_rate, float cutoff);
+
 /** Lowpass filter.
 
-    Function is stateful.
+    Function is stateful, uses the filter set up with baseband_low_pass_filter_setup().
+    SIMD versions of the designed filters match the scalar versions exactly.
     @param x_buf input samples to be filtered
     @param[out] y_buf output from filter
     @param len number of samples to process
@@ -137,7 +190,154 @@ void baseband_demod_FM(demodfm_state_t *state, uint8_t const *x_buf, int16_t *y_
 /// For evaluation.
 void baseband_demod_FM_cs16(demodfm_state_t *state, int16_t const *x_buf, int16_t *y_buf, unsigned long num_samples, uint32_t samp_rate, float low_pass);
 
-/** Initialize tables and constants.
+/// FM demodulator for CF32 samples, see baseband_demod_FM().
+void baseband_demod_FM_cf32(demodfm_state_t *state, float const *x_buf, int16_t *y_buf, unsigned long num_samples, uint32_t samp_rate, float low_pass);
+
+/// FM discriminator variants.
+enum baseband_fm_disc {
+    BASEBAND_FM_ATAN2 = 0, ///< Integer atan2 approximation, error max 0.07 radians (default)
+    BASEBAND_FM_POLY  = 1, ///< Branchless polynomial atan2, error max 1e-5 radians plus output rounding, SIMD
+    BASEBAND_FM_CONJ  = 2, ///< Conjugate product sin(dphi) without atan, error below dphi^3 / 6, folds beyond +-Pi/2, SIMD
+};
+
+/** Select the discriminator used by baseband_demod_FM() and baseband_demod_FM_cs16().
+
+    The SIMD variants follow baseband_simd_select().
+    @param disc the wanted discriminator, unknown values select BASEBAND_FM_ATAN2
+    @return the selected discriminator
+*/
+int baseband_fm_disc_select(int disc);
+
+/// Get the currently selected FM discriminator.
+int baseband_fm_disc_current(void);
+
+/// Get a printable name for an FM discriminator.
+char const *baseband_fm_disc_name(int disc);
+
+/** Instantaneous frequency of CU8 samples, i.e. baseband_demod_FM() without the low pass.
+
+    For evaluation, only the previous sample is used from and stored to the state.
+    @param[in,out] state State to store between chunk processing
+    @param x_buf input samples (I/Q samples in interleaved uint8)
+    @param[out] f_buf phase difference to the previous sample (Pi equals INT16_MAX)
+    @param len number of samples to process
+*/
+void baseband_fm_discriminate(demodfm_state_t *state, uint8_t const *x_buf, int16_t *f_buf, uint32_t len);
+
+/// Instantaneous frequency of CS16 samples, see baseband_fm_discriminate() (Pi equals INT32_MAX).
+void baseband_fm_discriminate_cs16(demodfm_state_t *state, int16_t const *x_buf, int32_t *f_buf, uint32_t len);
+
+/// Instantaneous frequency of CF32 samples, see baseband_fm_discriminate() (Pi equals INT32_MAX).
+void baseband_fm_discriminate_cf32(demodfm_state_t *state, float const *x_buf, int32_t *f_buf, uint32_t len);
+
+/** Fused AM and FM demodulator, reads each IQ sample from memory only once.
+
+    Computes the AM envelope (amplitude or magnitude estimate), low pass filters it,
+    and FM demodulates the same chunk while it is still in cache.
+    The output is identical to envelope_detect() or magnitude_est_cu8(),
+    baseband_low_pass_filter(), and baseband_demod_FM() called in sequence.
+    Function is stateful.
+    @param[in,out] lp_state AM low pass filter state to store between chunk processing
+    @param[in,out] fm_state FM demodulator state to store between chunk processing
+    @param iq_buf input samples (I/Q samples in interleaved uint8)
+    @param use_mag_est use magnitude instead of amplitude estimation
+    @param[out] am_buf low pass filtered AM output
+    @param[out] fm_buf FM output, NULL to skip FM demodulation
+    @param len number of samples to process
+    @param samp_rate sample rate of samples to process
+    @param low_pass FM low-pass filter frequency or ratio
+    @return the average level in dB
+*/
+float baseband_demod_AM_FM(filter_state_t *lp_state, demodfm_state_t *fm_state, uint8_t const *iq_buf, int use_mag_est, int16_t *am_buf, int16_t *fm_buf, uint32_t len, uint32_t samp_rate, float low_pass);
+
+/// Fused AM and FM demodulator for CS16 samples, see baseband_demod_AM_FM().
+float baseband_demod_AM_FM_cs16(filter_state_t *lp_state, demodfm_state_t *fm_state, int16_t const *iq_buf, int16_t *am_buf, int16_t *fm_buf, uint32_t len, uint32_t samp_rate, float low_pass);
+
+/// Fused AM and FM demodulator for CF32 samples, see baseband_demod_AM_FM().
+float baseband_demod_AM_FM_cf32(filter_state_t *lp_state, demodfm_state_t *fm_state, float const *iq_buf, int16_t *am_buf, int16_t *fm_buf, uint32_t len, uint32_t samp_rate, float low_pass);
+
+/// Maximum decimation factor of the polyphase decimator.
+#define DECIMATOR_MAX_FACTOR 16
+/// FIR taps per polyphase branch, the filter has factor times this many taps.
+#define DECIMATOR_PHASE_TAPS 16
+#define DECIMATOR_MAX_TAPS (DECIMATOR_MAX_FACTOR * DECIMATOR_PHASE_TAPS)
+/// Input samples converted per pass, bounds the work buffers.
+#define DECIMATOR_CHUNK_LEN 4096
+
+/// Polyphase FIR decimator state buffer.
+typedef struct decimator_state {
+    unsigned factor;   ///< Decimation factor, 1 if disabled
+    unsigned num_taps; ///< Number of FIR taps, factor * DECIMATOR_PHASE_TAPS
+    unsigned skip;     ///< Input samples to skip before the next output sample
+    int16_t coeffs[DECIMATOR_MAX_TAPS];                      ///< Low pass coefficients in Q0.15, unity DC gain
+    int16_t i_buf[DECIMATOR_MAX_TAPS + DECIMATOR_CHUNK_LEN]; ///< Input history and current chunk, I
+    int16_t q_buf[DECIMATOR_MAX_TAPS + DECIMATOR_CHUNK_LEN]; ///< Input history and current chunk, Q
+} decimator_state_t;
+
+/** Set up the decimator for a factor, computes the anti-alias filter and resets the history.
+
+    The low pass is a Hamming windowed sinc with the cutoff at the output Nyquist frequency.
+    @param[out] state decimator state to set up
+    @param factor decimation factor, 1 to DECIMATOR_MAX_FACTOR, with 1 the filter is a half-band low pass
+*/
+void baseband_decimator_setup(decimator_state_t *state, unsigned factor);
+
+/** Reset the decimator history, keeps the filter. */
+void baseband_decimator_reset(decimator_state_t *state);
+
+/** Polyphase FIR decimator, only the retained output samples are computed.
+
+    Function is stateful. The output is CS16 at the input rate divided by the factor,
+    delayed by half the filter length.
+    @param[in,out] state State to store between chunk processing
+    @param iq_buf input samples (I/Q samples in interleaved uint8)
+    @param[out] y_buf output samples (I/Q samples in interleaved int16), len / factor + 1 samples at most
+    @param len number of samples to process
+    @return the number of output samples
+*/
+uint32_t baseband_decimate_cu8(decimator_state_t *state, uint8_t const *iq_buf, int16_t *y_buf, uint32_t len);
+
+/// Polyphase FIR decimator for CS16 samples, see baseband_decimate_cu8().
+uint32_t baseband_decimate_cs16(decimator_state_t *state, int16_t const *iq_buf, int16_t *y_buf, uint32_t len);
+
+/// Polyphase FIR decimator for CF32 samples, clamped to [-1,1], see baseband_decimate_cu8().
+uint32_t baseband_decimate_cf32(decimator_state_t *state, float const *iq_buf, int16_t *y_buf, uint32_t len);
+
+/** Find the smallest and largest level in a block of envelope or FM samples.
+
+    @param buf input levels
+    @param len number of levels, at least 1
+    @param[out] min smallest level
+    @param[out] max largest level
+*/
+void baseband_level_range(int16_t const *buf, uint32_t len, int16_t *min, int16_t *max);
+
+/// SIMD implementation levels, ordered by preference.
+enum baseband_simd {
+    BASEBAND_SIMD_NONE = 0,
+    BASEBAND_SIMD_SSE2 = 1,
+    BASEBAND_SIMD_AVX2 = 2,
+    BASEBAND_SIMD_NEON = 3,
+    BASEBAND_SIMD_BEST = BASEBAND_SIMD_NEON,
+};
+
+/** Select the implementation for envelope_detect(), magnitude_est_cu8(), magnitude_est_cs16(), magnitude_est_cf32(), baseband_level_range(), and the designed low pass filters.
+
+    All levels produce bit-exact output.
+    Falls back to the best level at or below the requested one that is supported
+    by the build and the CPU.
+    @param level the wanted SIMD level, BASEBAND_SIMD_BEST to auto-detect
+    @return the selected SIMD level
+*/
+int baseband_simd_select(int level);
+
+/// Get the currently selected SIMD level.
+int baseband_simd_current(void);
+
+/// Get a printable name for a SIMD level.
+char const *baseband_simd_name(int level);
+
+/** Initialize tables and constants, selects the best SIMD implementation.
     Should be called once at startup.
 */
 void baseband_init(void);
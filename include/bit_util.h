@@ -60,6 +60,26 @@ unsigned extract_nibbles_4b1s(uint8_t const *message, unsigned offset_bits, unsi
 /// @param key key to use when decoding
 uint32_t keeloq_common_decrypt(const uint32_t data, const uint64_t key);
 
+/// Decrypt one Keeloq encoded block with many keys.
+///
+/// Batches of 64 keys run in parallel, one key per bit lane (bitslicing).
+///
+/// @param data encrypted data
+/// @param keys keys to try
+/// @param num_keys number of keys
+/// @param[out] out decrypted data for each key
+void keeloq_common_decrypt_keys(uint32_t data, uint64_t const keys[], unsigned num_keys, uint32_t out[]);
+
+/// Decrypt many Keeloq encoded blocks with one key.
+///
+/// Batches of 64 blocks run in parallel, one block per bit lane (bitslicing).
+///
+/// @param data encrypted data blocks
+/// @param num_blocks number of blocks
+/// @param key key to use when decoding
+/// @param[out] out decrypted data for each block
+void keeloq_common_decrypt_blocks(uint32_t const data[], unsigned num_blocks, uint64_t key, uint32_t out[]);
+
 /// Create a per device MFR key
 ///
 /// @param data encrypted data
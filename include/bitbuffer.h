@@ -33,17 +33,35 @@ typedef bitrow_t bitarray_t[BITBUF_ROWS];
 typedef struct bitbuffer {
     uint16_t num_rows;                      ///< Number of active rows
     uint16_t free_row;                      ///< Index of next free row
+    uint16_t dirty_rows;                    ///< Rows written since the last clear, see bitbuffer_clear()
+    uint16_t dirty_cols;                    ///< Bytes per row written since the last clear
     uint16_t bits_per_row[BITBUF_ROWS];     ///< Number of active bits per row
     uint16_t syncs_before_row[BITBUF_ROWS]; ///< Number of sync pulses before row
     bitarray_t bb;                          ///< The actual bits buffer
 } bitbuffer_t;
 
-/// Clear the content of the bitbuffer.
+/** Clear the content of the bitbuffer.
+
+    Only the rows and bytes written since the last clear are zeroed, not the whole buffer.
+    Bytes written directly need to be within the bits of a row to be cleared.
+*/
 void bitbuffer_clear(bitbuffer_t *bits);
 
+/// Copy the content of a bitbuffer, only the rows and bytes in use are copied.
+void bitbuffer_copy(bitbuffer_t *dst, bitbuffer_t const *src);
+
 /// Add a single bit at the end of the bitbuffer (MSB first).
 void bitbuffer_add_bit(bitbuffer_t *bits, int bit);
 
+/** Add a run of count bits of the same value at the end of the bitbuffer.
+
+    Same as count calls to bitbuffer_add_bit() but writes whole bytes where possible.
+*/
+void bitbuffer_add_bits(bitbuffer_t *bits, int value, unsigned count);
+
+/// Add the lowest nbits (up to 32) of word at the end of the bitbuffer (MSB first).
+void bitbuffer_add_word(bitbuffer_t *bits, uint32_t word, unsigned nbits);
+
 /// Add a new row to the bitbuffer.
 void bitbuffer_add_row(bitbuffer_t *bits);
 
@@ -111,6 +129,25 @@ void bitbuffer_parse(bitbuffer_t *bits, const char *code);
 unsigned bitbuffer_search(bitbuffer_t *bitbuffer, unsigned row, unsigned start,
         const uint8_t *pattern, unsigned pattern_bits_len);
 
+/// A search pattern prepared for bitbuffer_search_compiled(), see bitbuffer_pattern_compile().
+typedef struct bitbuffer_pattern {
+    uint64_t head;          ///< First bits of the pattern (up to 56), left aligned
+    uint64_t head_mask;     ///< Mask of the head bits
+    uint8_t const *bits;    ///< The pattern, not owned
+    unsigned len;           ///< Pattern length in bits
+} bitbuffer_pattern_t;
+
+/// Prepare a pattern for repeated searches, the pattern needs to stay valid while it is used.
+void bitbuffer_pattern_compile(bitbuffer_pattern_t *compiled, const uint8_t *pattern, unsigned pattern_bits_len);
+
+/// Search the specified row of the bitbuffer, starting from bit 'start', for a compiled pattern.
+///
+/// Same as bitbuffer_search() but tests eight bit offsets per byte of the row.
+///
+/// @return the location of the first match, or the end of the row if no match is found.
+unsigned bitbuffer_search_compiled(bitbuffer_t *bitbuffer, unsigned row, unsigned start,
+        bitbuffer_pattern_t const *pattern);
+
 /// Manchester decoding from one bitbuffer into another, starting at the
 /// specified row and start bit.
 ///
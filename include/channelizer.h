@@ -0,0 +1,62 @@
+/** @file
+    FFT-based polyphase channelizer.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_CHANNELIZER_H_
+#define INCLUDE_CHANNELIZER_H_
+
+#include <stdint.h>
+
+/// Maximum number of channels, must be a power of two.
+#define CHANNELIZER_MAX_CHANNELS 64
+/// FIR taps per polyphase branch, the prototype filter has num_channels times this many taps.
+#define CHANNELIZER_PHASE_TAPS 16
+
+/** Critically sampled polyphase filter bank.
+
+    Splits the input into num_channels channels spaced samp_rate / num_channels apart,
+    channel 0 is at the tuned center, the upper half of the channels are the negative offsets.
+    Each channel is low pass filtered, mixed down and decimated by num_channels.
+*/
+typedef struct channelizer channelizer_t;
+
+/** Create a channelizer.
+
+    @param num_channels number of channels, a power of two from 2 to CHANNELIZER_MAX_CHANNELS
+    @return the channelizer or NULL on bad arguments or alloc failure
+*/
+channelizer_t *channelizer_create(unsigned num_channels);
+
+void channelizer_free(channelizer_t *ch);
+
+/// Reset the input history.
+void channelizer_reset(channelizer_t *ch);
+
+unsigned channelizer_num_channels(channelizer_t const *ch);
+
+/// Get the frequency of a channel relative to the tuned center, in Hz.
+int channelizer_channel_offset(channelizer_t const *ch, unsigned channel, uint32_t samp_rate);
+
+/** Split a block of CU8 samples into channels.
+
+    Function is stateful, partial groups of input samples are kept for the next call.
+    @param ch the channelizer
+    @param iq_buf input samples (I/Q samples in interleaved uint8)
+    @param len number of samples to process
+    @param[out] out_bufs one CS16 output buffer per channel, each with room for len / num_channels + 1 samples
+    @return the number of output samples in each channel
+*/
+uint32_t channelizer_process_cu8(channelizer_t *ch, uint8_t const *iq_buf, uint32_t len, int16_t **out_bufs);
+
+/// Split a block of CS16 samples into channels, see channelizer_process_cu8().
+uint32_t channelizer_process_cs16(channelizer_t *ch, int16_t const *iq_buf, uint32_t len, int16_t **out_bufs);
+
+/// Split a block of CF32 samples into channels, see channelizer_process_cu8().
+uint32_t channelizer_process_cf32(channelizer_t *ch, float const *iq_buf, uint32_t len, int16_t **out_bufs);
+
+#endif /* INCLUDE_CHANNELIZER_H_ */
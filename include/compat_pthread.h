@@ -4,6 +4,7 @@
 #ifndef THREADS
 
 // explicit request for "no threads"
+#define THREAD_LOCAL
 
 // no pthreads only on MSC, use compat on all WIN32 anyway
 //#elif _MSC_VER>=1200
@@ -13,6 +14,11 @@
 #include <process.h>
 #define THREAD_CALL                     __stdcall
 #define THREAD_RETURN                   unsigned int
+#ifdef _MSC_VER
+#define THREAD_LOCAL                    __declspec(thread)
+#else
+#define THREAD_LOCAL                    __thread
+#endif
 typedef HANDLE                          pthread_t;
 #define pthread_create(tp, x, p, d)     ((*tp=(HANDLE)_beginthreadex(NULL, 0, p, d, 0, NULL)) == NULL ? -1 : 0)
 #define pthread_cancel(th)              (!TerminateThread(th, 0))
@@ -39,6 +45,7 @@ typedef CONDITION_VARIABLE              pthread_cond_t;
 #include <pthread.h>
 #define THREAD_CALL
 #define THREAD_RETURN                   void*
+#define THREAD_LOCAL                    __thread
 
 #endif
 
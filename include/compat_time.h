@@ -16,6 +16,8 @@
 #include <sys/time.h>
 #endif
 
+#include <stdint.h>
+
 /** Subtract `struct timeval` values.
 
     @param[out] result time difference result
@@ -25,6 +27,12 @@
 */
 int timeval_subtract(struct timeval *result, struct timeval const *x, struct timeval const *y);
 
+/** Monotonic clock for measuring short durations.
+
+    @return a time in nanoseconds from an unspecified start point
+*/
+uint64_t monotonic_ns(void);
+
 // platform-specific functions
 
 #ifdef _WIN32
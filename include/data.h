@@ -67,14 +67,17 @@ typedef union data_value {
     void        *v_ptr; /**< A data value pointer, 4/8 bytes size/alignment */
 } data_value_t;
 
+struct data_arena;
+
 typedef struct data {
     struct data *next; /**< chaining to the next element in the linked list; NULL indicates end-of-list */
-    char        *key;
-    char        *pretty_key; /**< the name used for displaying data to user in with a nicer name */
+    char const  *key; /**< interned or in the arena, use data_rename() to change */
+    char const  *pretty_key; /**< the name used for displaying data to user in with a nicer name */
     char        *format; /**< if not null, contains special formatting string */
     data_value_t value;
     data_type_t type;
     unsigned    retain; /**< incremented on data_retain, data_free only frees if this is zero */
+    struct data_arena *arena; /**< memory of the element and its strings, shared by the elements of an event */
 } data_t;
 
 /** Constructs a structured data object.
@@ -93,6 +96,11 @@ typedef struct data {
     - numerical arrays
     - string arrays (copied deeply)
 
+    The elements and their strings are allocated from one arena per object,
+    elements appended later share the arena of the last element. Keys and
+    pretty keys are interned per thread, a recurring key is not copied again.
+    Interned keys are never freed.
+
     Things it moves:
     - recursive data_t* and data_array_t* values
 
@@ -156,6 +164,16 @@ R_API data_t *data_dat(data_t *first, char const *key, char const *pretty_key, c
 */
 R_API data_t *data_hex(data_t *first, char const *key, char const *pretty_key, char const *format, uint8_t const *val, unsigned len, char *buf);
 
+/** Changes the key and the format of an element, e.g. on unit conversion.
+
+    The strings are copied, the old ones are released with the element.
+    @param data the element to change
+    @param key the new key, NULL to keep the key
+    @param format the new format, the current format is kept if it is passed, NULL for none
+    @return 0 on success, -1 if there was a memory allocation error, the element is unchanged then
+*/
+R_API int data_rename(data_t *data, char const *key, char const *format);
+
 /** Constructs an array from given data of the given uniform type.
 
     @param num_values The number of values to be copied.
@@ -0,0 +1,49 @@
+/** @file
+    Worker pool to run the decoders of a package in parallel.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_DECODER_POOL_H_
+#define INCLUDE_DECODER_POOL_H_
+
+/// Maximum number of threads, including the calling thread.
+#define DECODER_POOL_MAX_THREADS 64
+
+/** Fork-join pool of worker threads.
+
+    The threads are started once and wait for jobs, the calling thread helps
+    with the jobs and returns once all of them are done.
+*/
+typedef struct decoder_pool decoder_pool_t;
+
+/// A job, worker is the index of the thread running it, 0 is the calling thread.
+typedef void (*decoder_pool_job_fn)(void *ctx, unsigned job, unsigned worker);
+
+/** Create a pool and start the threads.
+
+    @param num_threads number of threads including the calling thread, 2 to DECODER_POOL_MAX_THREADS
+    @return the pool or NULL if built without threads, on bad arguments, or on failure
+*/
+decoder_pool_t *decoder_pool_create(unsigned num_threads);
+
+/// Stop the threads and free the pool.
+void decoder_pool_free(decoder_pool_t *pool);
+
+/// Number of threads including the calling thread, 1 if the pool is NULL.
+unsigned decoder_pool_num_threads(decoder_pool_t const *pool);
+
+/** Run jobs 0 to num_jobs - 1 on the pool and wait for them to finish.
+
+    Jobs are handed out in order to the next idle thread.
+    @param pool the pool, if NULL all jobs run on the calling thread
+    @param num_jobs number of jobs
+    @param job_fn the function to run each job
+    @param ctx context passed to job_fn
+*/
+void decoder_pool_run(decoder_pool_t *pool, unsigned num_jobs, decoder_pool_job_fn job_fn, void *ctx);
+
+#endif /* INCLUDE_DECODER_POOL_H_ */
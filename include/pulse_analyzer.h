@@ -16,6 +16,27 @@
 
 struct r_device;
 
+#define MAX_HIST_BINS 16
+
+/// Histogram data for single bin
+typedef struct {
+    unsigned count;
+    int sum;
+    int mean;
+    int min;
+    int max;
+} hist_bin_t;
+
+/// Histogram data for all bins
+typedef struct {
+    unsigned bins_count;
+    unsigned dropped; ///< Number of values that didn't fit in the bins
+    hist_bin_t bins[MAX_HIST_BINS];
+} histogram_t;
+
+/// Add values to a histogram (unsorted), a value joins the first bin with a mean within the relative tolerance.
+void histogram_sum(histogram_t *hist, int const *data, unsigned len, float tolerance);
+
 /// Analyze and print result.
 void pulse_analyzer(pulse_data_t *data, int package_type, struct r_device *device);
 
@@ -41,6 +41,9 @@ void pulse_detect_free(pulse_detect_t *pulse_detect);
 /// Reset pulse detector to initial values.
 void pulse_detect_reset(pulse_detect_t *pulse_detect);
 
+/// Get and clear the number of package starts rejected as spurious short pulses, these never reach the decoders.
+unsigned pulse_detect_take_rejected(pulse_detect_t *pulse_detect);
+
 /// Set pulse detector level values.
 ///
 /// @param pulse_detect The pulse_detect instance
@@ -16,6 +16,11 @@
 
 #include "pulse_detect.h"
 #include "r_device.h"
+#include "bitbuffer.h"
+#include "pulse_analyzer.h"
+
+/// Signature of all pulse slicers, returns the number of events processed.
+typedef int (*pulse_slicer_fn)(pulse_data_t const *pulses, r_device *device);
 
 /// Demodulate a Pulse Code Modulation signal.
 ///
@@ -158,4 +163,107 @@ int pulse_slicer_osv1(pulse_data_t const *pulses, r_device *device);
 /// @return number of events processed
 int pulse_slicer_string(const char *code, r_device *device);
 
+/// Sample domain timing of a decoder, decoders with equal keys get the same bits from the slicer.
+typedef struct pulse_slicer_key {
+    pulse_slicer_fn slicer;
+    int s_short;
+    int s_long;
+    int s_reset;
+    int s_gap;
+    int s_sync;
+    int s_tolerance;
+    float f_short; ///< precision reciprocal, PCM only
+    float f_long;  ///< precision reciprocal, PCM only
+} pulse_slicer_key_t;
+
+/// Bitbuffers one slicer run produced for a key.
+typedef struct pulse_slicer_slot {
+    pulse_slicer_key_t key;
+    char const *name; ///< slicer name for the bitbuffer debug output
+    unsigned bucket;  ///< index into the hash table
+    unsigned first;   ///< index of the first recorded bitbuffer
+    unsigned count;   ///< number of recorded bitbuffers
+} pulse_slicer_slot_t;
+
+/// Slicing cache for one pulse package, see pulse_slicer_cached().
+typedef struct pulse_slicer_cache {
+    unsigned max_slots;
+    unsigned num_slots;
+    pulse_slicer_slot_t *slots;
+    unsigned table_mask; ///< hash table size minus one, the size is a power of two
+    int *table;          ///< slot index per bucket, -1 if empty
+    unsigned num_bits;
+    unsigned bits_size;
+    bitbuffer_t *bits;   ///< recorded bitbuffers of all slots
+    bitbuffer_t scratch; ///< copy of a recorded bitbuffer handed to a decoder
+    unsigned slices;       ///< number of slicer runs
+    unsigned slices_saved; ///< number of slicer runs replaced by a recorded result
+} pulse_slicer_cache_t;
+
+/// Size the cache for up to max_decoders decoders per package, previous contents are freed.
+void pulse_slicer_cache_init(pulse_slicer_cache_t *cache, unsigned max_decoders);
+
+void pulse_slicer_cache_free(pulse_slicer_cache_t *cache);
+
+/// Forget the recorded bitbuffers, needed before each new pulse package.
+void pulse_slicer_cache_clear(pulse_slicer_cache_t *cache);
+
+/// Compute the key of a decoder at a sample rate.
+///
+/// Only the PCM, PPM, PWM, Manchester and OSv1 slicers can be shared, and only by decoders that are not verbose.
+/// @return 1 if decoders with equal keys can share the sliced bits, 0 otherwise
+int pulse_slicer_key(pulse_slicer_key_t *key, uint32_t sample_rate, pulse_slicer_fn slicer, r_device const *device);
+
+/// Check that no width of the decoder rounds to zero samples, otherwise the slicer warns and returns.
+int pulse_slicer_timing_valid(pulse_slicer_key_t const *key, r_device const *device);
+
+int pulse_slicer_key_equal(pulse_slicer_key_t const *a, pulse_slicer_key_t const *b);
+
+/// Run the slicer of a key and the decoder, reuse the bits if a decoder with the same key already ran on the package.
+///
+/// Each decoder gets its own copy of the recorded bitbuffer, it may be modified.
+///
+/// @param cache the cache, cleared for the current package
+/// @param pulses The pulse sequence to demodulate
+/// @param key The decoder key, see pulse_slicer_key()
+/// @param device The decoder
+/// @return number of events processed
+int pulse_slicer_cached(pulse_slicer_cache_t *cache, pulse_data_t const *pulses, pulse_slicer_key_t const *key, r_device *device);
+
+/// Relative tolerance of the width histogram bins, see pulse_slicer_widths().
+#define PULSE_SLICER_WIDTHS_TOLERANCE 0.2f
+
+enum pulse_slicer_band_widths {
+    PULSE_SLICER_NO_BANDS    = 0, ///< the decoder always runs
+    PULSE_SLICER_PULSE_BANDS = 1, ///< the bands apply to the pulse widths
+    PULSE_SLICER_GAP_BANDS   = 2, ///< the bands apply to the gap widths
+};
+
+/// Widths a decoder needs in a package to possibly match, see pulse_slicer_bands().
+typedef struct pulse_slicer_bands {
+    int widths;   ///< see enum pulse_slicer_band_widths
+    int lower[2]; ///< lower bounds (non inclusive) in samples
+    int upper[2]; ///< upper bounds (non inclusive) in samples
+} pulse_slicer_bands_t;
+
+/// Pulse and gap width histograms of a package.
+typedef struct pulse_slicer_widths {
+    histogram_t pulses;
+    histogram_t gaps;
+} pulse_slicer_widths_t;
+
+/// Compute the bands of widths a slicer turns into bits.
+///
+/// Without any width in the bands the PPM and PWM slicers only produce empty rows
+/// and the PCM RZ slicer produces no event at all.
+/// Other slicers get no bands and always run.
+void pulse_slicer_bands(pulse_slicer_bands_t *bands, pulse_slicer_key_t const *key);
+
+/// Build the pulse and gap width histograms of a package.
+void pulse_slicer_widths(pulse_slicer_widths_t *widths, pulse_data_t const *pulses);
+
+/// Check if any width of the package might be in the bands.
+/// @return 0 if the slicer can't produce any bits, 1 otherwise
+int pulse_slicer_bands_present(pulse_slicer_bands_t const *bands, pulse_slicer_widths_t const *widths);
+
 #endif /* INCLUDE_PULSE_SLICER_H_ */
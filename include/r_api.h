@@ -19,6 +19,7 @@ struct r_device;
 struct data;
 struct pulse_data;
 struct list;
+struct r_dispatch;
 struct mg_mgr;
 
 /* general */
@@ -41,6 +42,33 @@ void unregister_protocol(struct r_cfg *cfg, struct r_device *r_dev);
 
 void register_all_protocols(struct r_cfg *cfg, unsigned disabled);
 
+/// Rebuild the OOK and FSK dispatch tables, needed whenever the registered protocols change.
+void update_protocol_dispatch(struct r_cfg *cfg);
+
+/** Build a dispatch table from a list of decoders.
+
+    Only decoders for the package type are included, sorted by priority.
+    Decoders with priority UINT_MAX are never run.
+    @param[out] dispatch the table to build, previous contents are freed
+    @param r_devs list of decoders
+    @param fsk 0 for OOK packages, 1 for FSK packages
+*/
+void r_dispatch_build(struct r_dispatch *dispatch, struct list const *r_devs, int fsk);
+
+void r_dispatch_free(struct r_dispatch *dispatch);
+
+/** Order the decoders within each priority by their recent hits.
+
+    In adaptive mode the decoders of a priority run in order of their hits,
+    counted with exponential decay. Once a decoder had events only decoders
+    in the always run set still run for the package. Hits are reset.
+    @param dispatch the table to set up
+    @param half_life packages after which a hit counts half, 0 to run all decoders in list order
+    @param always protocol numbers of the decoders that always run
+    @param num_always number of protocol numbers
+*/
+void r_dispatch_set_adaptive(struct r_dispatch *dispatch, unsigned half_life, unsigned const *always, unsigned num_always);
+
 /* output helper */
 
 void calc_rssi_snr(struct r_cfg *cfg, struct pulse_data *pulse_data);
@@ -51,9 +79,11 @@ char const **well_known_output_fields(struct r_cfg *cfg);
 
 char const **determine_csv_fields(struct r_cfg *cfg, char const *const *well_known, int *num_fields);
 
-int run_ook_demods(struct list *r_devs, struct pulse_data *pulse_data);
+/// Run the decoders of each priority in turn on an OOK package, stops after the first priority with events.
+int run_ook_demods(struct r_dispatch *dispatch, struct pulse_data *pulse_data);
 
-int run_fsk_demods(struct list *r_devs, struct pulse_data *fsk_pulse_data);
+/// Run the decoders of each priority in turn on an FSK package, stops after the first priority with events.
+int run_fsk_demods(struct r_dispatch *dispatch, struct pulse_data *fsk_pulse_data);
 
 /* handlers */
 
@@ -5,6 +5,8 @@
 #ifndef INCLUDE_R_DEVICE_H_
 #define INCLUDE_R_DEVICE_H_
 
+#include <stdint.h>
+
 /**
     Supported Modulation and Coding types.
 
@@ -54,6 +56,13 @@ enum decode_return_codes {
 struct bitbuffer;
 struct data;
 
+/// Decoder run time accounting, only counted if built with DECODER_PROFILING.
+typedef struct r_device_profile {
+    unsigned calls;     ///< Packages sliced for the decoder
+    uint64_t slice_ns;  ///< Wall time spent slicing and decoding
+    uint64_t decode_ns; ///< Wall time spent in decode_fn
+} r_device_profile_t;
+
 /** Device protocol decoder struct. */
 typedef struct r_device {
     unsigned protocol_num; ///< fixed sequence number, assigned in main().
@@ -72,6 +81,7 @@ typedef struct r_device {
     unsigned priority; ///< Run later and only if no previous events were produced
     unsigned disabled; ///< 0: default enabled, 1: default disabled, 2: disabled, 3: disabled and hidden
     char const *const *fields; ///< List of fields this decoder produces; required for CSV output. NULL-terminated.
+    unsigned no_prefilter; ///< 1: always run, even if the package has no pulse widths that match the timing
 
     /* public for each decoder */
     int verbose;
@@ -84,6 +94,8 @@ typedef struct r_device {
     unsigned decode_ok;
     unsigned decode_messages;
     unsigned decode_fails[5];
+    r_device_profile_t profile;       ///< Since the last stats report
+    r_device_profile_t profile_total; ///< Up to the last stats report, add profile for the total
 
     /* private for flex decoder and output callback */
     void *decode_ctx;
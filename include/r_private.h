@@ -15,28 +15,105 @@
 #include "am_analyze.h"
 #include "rtl_433.h"
 #include "compat_time.h"
+#include "channelizer.h"
+#include "pulse_slicer.h"
+#include "decoder_pool.h"
+
+/// A decoder and the slicer for its modulation.
+typedef struct r_dispatch_entry {
+    pulse_slicer_fn slicer;
+    r_device *r_dev;
+    pulse_slicer_key_t key; ///< Slicer key at the current sample rate, the slicer is NULL if it can't be shared
+    int shared;             ///< Another decoder has the same key
+    unsigned leader;        ///< Index of the first entry with the same key
+    pulse_slicer_bands_t bands; ///< Widths the decoder needs at the current sample rate
+    int parallel;           ///< The decoder may run on a pool thread, it is not verbose and the slicer won't warn
+    double hits;            ///< Decayed count of packages with events, in units of the dispatch hit_weight
+    int always;             ///< Adaptive mode, keep running after another decoder of the priority had events
+} r_dispatch_entry_t;
+
+struct r_deferred;
+
+/// Decoders for one package type (OOK or FSK) in the order they run, see r_dispatch_build().
+typedef struct r_dispatch {
+    unsigned len;               ///< Number of decoders
+    unsigned num_groups;        ///< Number of distinct priorities
+    r_dispatch_entry_t *entries; ///< Decoders sorted by priority, in list order within a priority
+    unsigned *group_end;        ///< End index into entries of each priority group
+    uint32_t key_rate;          ///< Sample rate the entry keys are computed for, 0 if none
+    pulse_slicer_cache_t cache; ///< Bits sliced for the current package, shared by decoders with the same timing
+    pulse_slicer_widths_t widths; ///< Width histograms of the current package
+    unsigned prefiltered;       ///< Number of decoders skipped as no widths matched their timing
+    decoder_pool_t *pool;       ///< Runs the decoders of a priority in parallel if set, not owned
+    pulse_slicer_cache_t *worker_caches; ///< Slicing cache per pool thread
+    unsigned *jobs;             ///< Entries of the current priority that run
+    struct r_deferred *deferred; ///< Outputs held back per job while running in parallel
+    int *unit_tail;             ///< Last job of the pool work unit by leader entry while grouping, -1 if none
+    int *unit_head;             ///< First job of each pool work unit
+    int *unit_next;             ///< Next job in the same pool work unit, -1 at the end
+    unsigned *order;            ///< Entry indices in run order, by hits within each priority in adaptive mode
+    unsigned half_life;         ///< Adaptive mode, packages after which a hit counts half, 0: off
+    double hit_weight;          ///< Weight of a hit on the current package, grows as older hits decay
+    double hit_growth;          ///< Growth of hit_weight per package
+} r_dispatch_t;
+
+/// A package detected on a channel, waiting to be decoded.
+typedef struct dm_package {
+    int package_type;
+    pulse_data_t pulse_data;
+    pulse_data_t fsk_pulse_data;
+} dm_package_t;
+
+/// Per channel state in channelizer mode.
+typedef struct dm_channel {
+    struct dm_state *demod; ///< Channel demodulator, pulse detector, and pulse data
+    unsigned long n_samples; ///< Channel samples in the current buffer
+    uint32_t samp_rate;     ///< Channel sample rate
+    unsigned fpdm;          ///< FSK pulse detector mode
+    int detect;             ///< Run the pulse detector
+    int noise_only;         ///< Current buffer is below the estimated noise level
+    int skipped;            ///< Current buffer was skipped by the fast squelch
+    uint64_t input_pos;     ///< Channel samples processed so far
+    list_t packages;        ///< Packages detected in the current buffer
+} dm_channel_t;
 
 struct dm_state {
     float auto_level;
     float squelch_offset;
+    int fast_squelch; // squelch on a subsample estimate before computing the envelope
     float level_limit;
     float noise_level;
     float min_level_auto;
     float min_level;
     float min_snr;
     float low_pass;
+    int am_filter; // AM low pass type, see enum baseband_lp_type
+    float am_cutoff; // AM low pass cutoff, 0: default
     int use_mag_est;
     int detect_verbosity;
 
-    int16_t am_buf[MAXIMAL_BUF_LENGTH];  // AM demodulated signal (for OOK decoding)
+    unsigned long buf_samples; // frame length in samples the buffers are sized for, see dm_state_alloc_buffers()
+    int16_t *am_buf;  // AM demodulated signal (for OOK decoding)
     union {
-        // These buffers aren't used at the same time, so let's use a union to save some memory
-        int16_t fm[MAXIMAL_BUF_LENGTH];  // FM demodulated signal (for FSK decoding)
-        uint16_t temp[MAXIMAL_BUF_LENGTH];  // Temporary buffer (to be optimized out..)
+        // These buffers aren't used at the same time, so they share one allocation
+        int16_t *fm;  // FM demodulated signal (for FSK decoding)
+        uint16_t *temp;  // Temporary buffer, also holds IQ format conversions for dumpers
     } buf;
-    uint8_t u8_buf[MAXIMAL_BUF_LENGTH]; // format conversion buffer
-    float f32_buf[MAXIMAL_BUF_LENGTH]; // format conversion buffer
-    int sample_size; // CU8: 2, CS16: 4
+    uint8_t *u8_buf; // format conversion buffer, only with a U8 logic dumper
+    float *f32_buf; // format conversion buffer, only with F32 dumpers
+    int16_t *decim_buf; // decimated CS16 samples, only with decimation or on a channel
+    int sample_size; // CU8: 2, CS16: 4, CF32: 8
+    unsigned decimation; // requested decimation factor, 0 or 1: off
+    decimator_state_t decimator;
+    unsigned num_channels; // requested channelizer channels, 0: off
+    unsigned decoder_threads; // requested decoder threads, 0 or 1: off
+    decoder_pool_t *decoder_pool;
+    unsigned adaptive_half_life; // adaptive decoder order, see r_dispatch_set_adaptive(), 0: off
+    unsigned *always_run; // protocol numbers that keep running after a hit in adaptive mode
+    unsigned num_always_run;
+    channelizer_t *channelizer;
+    dm_channel_t *channels;
+    decoder_pool_t *channel_pool; // demodulates the channels in parallel, NULL: on the calling thread
     pulse_detect_t *pulse_detect;
     filter_state_t lowpass_filter_state;
     demodfm_state_t demod_FM_state;
@@ -51,6 +128,8 @@ struct dm_state {
 
     /* Protocol states */
     list_t r_devs;
+    r_dispatch_t ook_dispatch; // r_devs for OOK packages, see update_protocol_dispatch()
+    r_dispatch_t fsk_dispatch; // r_devs for FSK packages
 
     pulse_data_t    pulse_data;
     pulse_data_t    fsk_pulse_data;
@@ -61,4 +140,16 @@ struct dm_state {
     float sample_file_pos;
 };
 
+/** Size the demodulator buffers for frames of up to max_samples input samples.
+
+    Dumpers and the decimator or channels need to be set up before, as they
+    decide which conversion buffers are needed. Buffers are reallocated if the
+    frame length changed, the contents are not kept.
+    @return the total size of the buffers in bytes
+*/
+size_t dm_state_alloc_buffers(struct dm_state *demod, unsigned long max_samples);
+
+/// Free the demodulator buffers, including those of the channels.
+void dm_state_free_buffers(struct dm_state *demod);
+
 #endif /* INCLUDE_R_PRIVATE_H_ */
@@ -16,6 +16,7 @@
 #define DEFAULT_ASYNC_BUF_NUMBER    0 // Force use of default value (librtlsdr default: 15)
 #define DEFAULT_BUF_LENGTH      (16 * 32 * 512) // librtlsdr default
 #define FSK_PULSE_DETECTOR_LIMIT 800000000
+#define DEFAULT_ADAPTIVE_HALF_LIFE 1000 // packages, see -Y adaptive
 
 #define MINIMAL_BUF_LENGTH      512
 #define MAXIMAL_BUF_LENGTH      (256 * 16384)
@@ -123,6 +124,7 @@ typedef struct r_cfg {
     unsigned total_frames_ook;      ///< total frames with ook demod statistic
     unsigned total_frames_fsk;      ///< total frames with fsk demod statistic
     unsigned total_frames_events;   ///< total frames with decoder events statistic
+    unsigned total_frames_rejected; ///< total packages rejected before decoding statistic
     /* sdr stats */
     time_t sdr_since; ///< time of last SDR connect statistic
     /* per report interval stats */
@@ -130,6 +132,9 @@ typedef struct r_cfg {
     unsigned frames_ook;    ///< counter of ook demods for report interval statistic
     unsigned frames_fsk;    ///< counter of fsk demods for report interval statistic
     unsigned frames_events; ///< counter of decoder events for report interval statistic
+    unsigned frames_rejected; ///< counter of packages rejected before decoding for report interval statistic
+    uint64_t frames_samples;         ///< counter of input samples for report interval statistic
+    uint64_t frames_samples_skipped; ///< counter of input samples skipped by the fast squelch for report interval statistic
     struct mg_mgr *mgr;
 } r_cfg_t;
 
@@ -15,10 +15,20 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <float.h>
 
 #include "logger.h"
 #include "r_util.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BASEBAND_SIMD_X86
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BASEBAND_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
 static uint16_t scaled_squares[256];
 
 /// precalculate lookup table for envelope detection.
@@ -33,7 +43,7 @@ static void calc_squares(void)
 
 // This will give a noisy envelope of OOK/ASK signals.
 // Subtract the bias (-128) and get an envelope estimation.
-float envelope_detect(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+static uint32_t envelope_detect_scalar(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
 {
     unsigned long i;
     uint32_t sum = 0;
@@ -41,7 +51,7 @@ float envelope_detect(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
         y_buf[i] = scaled_squares[iq_buf[2 * i ]] + scaled_squares[iq_buf[2 * i + 1]];
         sum += y_buf[i];
     }
-    return len > 0 && sum >= len ? AMP_TO_DB((float)sum / len) : AMP_TO_DB(1);
+    return sum;
 }
 
 /// This will give a noisy envelope of OOK/ASK signals.
@@ -62,7 +72,7 @@ float envelope_detect_nolut(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len
 
 /// 122/128, 51/128 Magnitude Estimator for CU8 (SIMD has min/max).
 /// Note that magnitude emphasizes quiet signals / deemphasizes loud signals.
-float magnitude_est_cu8(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+static uint32_t magnitude_est_cu8_scalar(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
 {
     unsigned long i;
     uint32_t sum = 0;
@@ -75,7 +85,7 @@ float magnitude_est_cu8(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
         y_buf[i] = mag_est; // max 22144, fs 16384
         sum += y_buf[i];
     }
-    return len > 0 && sum >= len ? MAG_TO_DB((float)sum / len) : MAG_TO_DB(1);
+    return sum;
 }
 
 /// True Magnitude for CU8 (sqrt can SIMD but float is slow).
@@ -93,7 +103,7 @@ float magnitude_true_cu8(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
 }
 
 /// 122/128, 51/128 Magnitude Estimator for CS16 (SIMD has min/max).
-float magnitude_est_cs16(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+static uint32_t magnitude_est_cs16_scalar(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
 {
     unsigned long i;
     uint32_t sum = 0;
@@ -106,7 +116,7 @@ float magnitude_est_cs16(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
         y_buf[i] = mag_est >> 8; // max 5668864, scaled 22144, fs 16384
         sum += y_buf[i];
     }
-    return len > 0 && sum >= len ? MAG_TO_DB((float)sum / len) : MAG_TO_DB(1);
+    return sum;
 }
 
 /// True Magnitude for CS16 (sqrt can SIMD but float is slow).
@@ -123,6 +133,671 @@ float magnitude_true_cs16(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
     return len > 0 && sum >= len ? MAG_TO_DB((float)sum / len) : MAG_TO_DB(1);
 }
 
+/// 122/128, 51/128 Magnitude Estimator for CF32, clamped to full scale and scaled like CS16 (SIMD has min/max).
+static uint32_t magnitude_est_cf32_scalar(float const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    unsigned long i;
+    uint32_t sum = 0;
+    for (i = 0; i < len; i++) {
+        float x = fabsf(iq_buf[2 * i]);
+        float y = fabsf(iq_buf[2 * i + 1]);
+        x = x < 1.0f ? x : 1.0f;
+        y = y < 1.0f ? y : 1.0f;
+        float mi = x < y ? x : y;
+        float mx = x > y ? x : y;
+        y_buf[i] = (uint16_t)((122.0f * mx + 51.0f * mi) * (INT16_MAX / 256.0f)); // max 22143, fs 16384
+        sum += y_buf[i];
+    }
+    return sum;
+}
+
+/// Minimum and maximum of a block of levels, the range is packed as (max << 16) | (uint16_t)min.
+static uint32_t level_range_scalar(int16_t const *buf, uint32_t len)
+{
+    int16_t lo = INT16_MAX;
+    int16_t hi = INT16_MIN;
+    for (uint32_t i = 0; i < len; i++) {
+        lo = buf[i] < lo ? buf[i] : lo;
+        hi = buf[i] > hi ? buf[i] : hi;
+    }
+    return ((uint32_t)(uint16_t)hi << 16) | (uint16_t)lo;
+}
+
+/* SIMD variants, these need to match the scalar versions exactly. */
+
+#ifdef BASEBAND_SIMD_X86
+
+__attribute__((target("sse2")))
+static inline uint32_t hsum_epu32_sse2(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t)_mm_cvtsi128_si32(v);
+}
+
+/// Add eight uint16 to four uint32 accumulators.
+__attribute__((target("sse2")))
+static inline __m128i acc_epu16_sse2(__m128i acc, __m128i v)
+{
+    __m128i const zero = _mm_setzero_si128();
+    acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+    return _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+}
+
+__attribute__((target("sse2")))
+static uint32_t envelope_detect_sse2(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    __m128i const lo_mask = _mm_set1_epi16(0x00ff);
+    __m128i const bias    = _mm_set1_epi16(127);
+    __m128i acc           = _mm_setzero_si128();
+    unsigned long i       = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m128i v = _mm_loadu_si128((__m128i const *)&iq_buf[2 * i]);
+        __m128i x = _mm_sub_epi16(bias, _mm_and_si128(v, lo_mask));
+        __m128i y = _mm_sub_epi16(bias, _mm_srli_epi16(v, 8));
+        __m128i e = _mm_add_epi16(_mm_mullo_epi16(x, x), _mm_mullo_epi16(y, y)); // max 32768
+        _mm_storeu_si128((__m128i *)&y_buf[i], e);
+        acc = acc_epu16_sse2(acc, e);
+    }
+    uint32_t sum = hsum_epu32_sse2(acc);
+    for (; i < len; i++) {
+        y_buf[i] = scaled_squares[iq_buf[2 * i]] + scaled_squares[iq_buf[2 * i + 1]];
+        sum += y_buf[i];
+    }
+    return sum;
+}
+
+__attribute__((target("sse2")))
+static uint32_t magnitude_est_cu8_sse2(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    __m128i const lo_mask = _mm_set1_epi16(0x00ff);
+    __m128i const bias    = _mm_set1_epi16(128);
+    __m128i const zero    = _mm_setzero_si128();
+    __m128i const k_mx    = _mm_set1_epi16(122);
+    __m128i const k_mi    = _mm_set1_epi16(51);
+    __m128i acc           = _mm_setzero_si128();
+    unsigned long i       = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m128i v  = _mm_loadu_si128((__m128i const *)&iq_buf[2 * i]);
+        __m128i x  = _mm_sub_epi16(_mm_and_si128(v, lo_mask), bias);
+        __m128i y  = _mm_sub_epi16(_mm_srli_epi16(v, 8), bias);
+        x          = _mm_max_epi16(x, _mm_sub_epi16(zero, x));
+        y          = _mm_max_epi16(y, _mm_sub_epi16(zero, y));
+        __m128i mi = _mm_min_epi16(x, y);
+        __m128i mx = _mm_max_epi16(x, y);
+        __m128i e  = _mm_add_epi16(_mm_mullo_epi16(mx, k_mx), _mm_mullo_epi16(mi, k_mi)); // max 22144
+        _mm_storeu_si128((__m128i *)&y_buf[i], e);
+        acc = acc_epu16_sse2(acc, e);
+    }
+    uint32_t sum = hsum_epu32_sse2(acc);
+    for (; i < len; i++) {
+        uint16_t x = abs(iq_buf[2 * i] - 128);
+        uint16_t y = abs(iq_buf[2 * i + 1] - 128);
+        uint16_t mi = x < y ? x : y;
+        uint16_t mx = x > y ? x : y;
+        y_buf[i] = 122 * mx + 51 * mi;
+        sum += y_buf[i];
+    }
+    return sum;
+}
+
+/// Magnitude estimate of four interleaved CS16 samples, no SSE4.1 min/max/mullo in SSE2.
+__attribute__((target("sse2")))
+static inline __m128i magnitude_est_cs16_x4_sse2(__m128i v)
+{
+    __m128i x  = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+    __m128i y  = _mm_srai_epi32(v, 16);
+    __m128i sx = _mm_srai_epi32(x, 31);
+    __m128i sy = _mm_srai_epi32(y, 31);
+    x          = _mm_sub_epi32(_mm_xor_si128(x, sx), sx);
+    y          = _mm_sub_epi32(_mm_xor_si128(y, sy), sy);
+    __m128i gt = _mm_cmpgt_epi32(x, y);
+    __m128i mx = _mm_or_si128(_mm_and_si128(gt, x), _mm_andnot_si128(gt, y));
+    __m128i mi = _mm_or_si128(_mm_and_si128(gt, y), _mm_andnot_si128(gt, x));
+    // 122 * mx = 128 * mx - 4 * mx - 2 * mx, 51 * mi = 32 * mi + 16 * mi + 2 * mi + mi
+    __m128i e = _mm_sub_epi32(_mm_slli_epi32(mx, 7), _mm_add_epi32(_mm_slli_epi32(mx, 2), _mm_slli_epi32(mx, 1)));
+    e         = _mm_add_epi32(e, _mm_add_epi32(_mm_slli_epi32(mi, 5), _mm_slli_epi32(mi, 4)));
+    e         = _mm_add_epi32(e, _mm_add_epi32(_mm_slli_epi32(mi, 1), mi));
+    return _mm_srli_epi32(e, 8); // max 22144
+}
+
+__attribute__((target("sse2")))
+static uint32_t magnitude_est_cs16_sse2(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    __m128i acc     = _mm_setzero_si128();
+    unsigned long i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m128i e0 = magnitude_est_cs16_x4_sse2(_mm_loadu_si128((__m128i const *)&iq_buf[2 * i]));
+        __m128i e1 = magnitude_est_cs16_x4_sse2(_mm_loadu_si128((__m128i const *)&iq_buf[2 * i + 8]));
+        _mm_storeu_si128((__m128i *)&y_buf[i], _mm_packs_epi32(e0, e1));
+        acc = _mm_add_epi32(acc, _mm_add_epi32(e0, e1));
+    }
+    uint32_t sum = hsum_epu32_sse2(acc);
+    for (; i < len; i++) {
+        uint32_t x = abs(iq_buf[2 * i]);
+        uint32_t y = abs(iq_buf[2 * i + 1]);
+        uint32_t mi = x < y ? x : y;
+        uint32_t mx = x > y ? x : y;
+        y_buf[i] = (122 * mx + 51 * mi) >> 8;
+        sum += y_buf[i];
+    }
+    return sum;
+}
+
+/// Magnitude estimate of four CF32 samples, given as two vectors of interleaved I/Q.
+__attribute__((target("sse2")))
+static inline __m128i magnitude_est_cf32_x4_sse2(__m128 a0, __m128 a1)
+{
+    __m128 const abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 const one      = _mm_set1_ps(1.0f);
+    __m128 x  = _mm_min_ps(_mm_and_ps(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)), abs_mask), one);
+    __m128 y  = _mm_min_ps(_mm_and_ps(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)), abs_mask), one);
+    __m128 mi = _mm_min_ps(x, y);
+    __m128 mx = _mm_max_ps(x, y);
+    __m128 e  = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(122.0f), mx), _mm_mul_ps(_mm_set1_ps(51.0f), mi));
+    return _mm_cvttps_epi32(_mm_mul_ps(e, _mm_set1_ps(INT16_MAX / 256.0f))); // max 22143
+}
+
+__attribute__((target("sse2")))
+static uint32_t magnitude_est_cf32_sse2(float const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    __m128i acc     = _mm_setzero_si128();
+    unsigned long i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m128i e0 = magnitude_est_cf32_x4_sse2(_mm_loadu_ps(&iq_buf[2 * i]), _mm_loadu_ps(&iq_buf[2 * i + 4]));
+        __m128i e1 = magnitude_est_cf32_x4_sse2(_mm_loadu_ps(&iq_buf[2 * i + 8]), _mm_loadu_ps(&iq_buf[2 * i + 12]));
+        _mm_storeu_si128((__m128i *)&y_buf[i], _mm_packs_epi32(e0, e1));
+        acc = _mm_add_epi32(acc, _mm_add_epi32(e0, e1));
+    }
+    return hsum_epu32_sse2(acc) + magnitude_est_cf32_scalar(&iq_buf[2 * i], &y_buf[i], len - i);
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t hsum_epu32_avx2(__m256i v)
+{
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t)_mm_cvtsi128_si32(s);
+}
+
+/// Add sixteen uint16 to eight uint32 accumulators.
+__attribute__((target("avx2")))
+static inline __m256i acc_epu16_avx2(__m256i acc, __m256i v)
+{
+    __m256i const zero = _mm256_setzero_si256();
+    acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(v, zero));
+    return _mm256_add_epi32(acc, _mm256_unpackhi_epi16(v, zero));
+}
+
+__attribute__((target("avx2")))
+static uint32_t envelope_detect_avx2(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    __m256i const lo_mask = _mm256_set1_epi16(0x00ff);
+    __m256i const bias    = _mm256_set1_epi16(127);
+    __m256i acc           = _mm256_setzero_si256();
+    unsigned long i       = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m256i v = _mm256_loadu_si256((__m256i const *)&iq_buf[2 * i]);
+        __m256i x = _mm256_sub_epi16(bias, _mm256_and_si256(v, lo_mask));
+        __m256i y = _mm256_sub_epi16(bias, _mm256_srli_epi16(v, 8));
+        __m256i e = _mm256_add_epi16(_mm256_mullo_epi16(x, x), _mm256_mullo_epi16(y, y)); // max 32768
+        _mm256_storeu_si256((__m256i *)&y_buf[i], e);
+        acc = acc_epu16_avx2(acc, e);
+    }
+    uint32_t sum = hsum_epu32_avx2(acc);
+    for (; i < len; i++) {
+        y_buf[i] = scaled_squares[iq_buf[2 * i]] + scaled_squares[iq_buf[2 * i + 1]];
+        sum += y_buf[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2")))
+static uint32_t magnitude_est_cu8_avx2(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    __m256i const lo_mask = _mm256_set1_epi16(0x00ff);
+    __m256i const bias    = _mm256_set1_epi16(128);
+    __m256i const k_mx    = _mm256_set1_epi16(122);
+    __m256i const k_mi    = _mm256_set1_epi16(51);
+    __m256i acc           = _mm256_setzero_si256();
+    unsigned long i       = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m256i v  = _mm256_loadu_si256((__m256i const *)&iq_buf[2 * i]);
+        __m256i x  = _mm256_abs_epi16(_mm256_sub_epi16(_mm256_and_si256(v, lo_mask), bias));
+        __m256i y  = _mm256_abs_epi16(_mm256_sub_epi16(_mm256_srli_epi16(v, 8), bias));
+        __m256i mi = _mm256_min_epi16(x, y);
+        __m256i mx = _mm256_max_epi16(x, y);
+        __m256i e  = _mm256_add_epi16(_mm256_mullo_epi16(mx, k_mx), _mm256_mullo_epi16(mi, k_mi)); // max 22144
+        _mm256_storeu_si256((__m256i *)&y_buf[i], e);
+        acc = acc_epu16_avx2(acc, e);
+    }
+    uint32_t sum = hsum_epu32_avx2(acc);
+    for (; i < len; i++) {
+        uint16_t x = abs(iq_buf[2 * i] - 128);
+        uint16_t y = abs(iq_buf[2 * i + 1] - 128);
+        uint16_t mi = x < y ? x : y;
+        uint16_t mx = x > y ? x : y;
+        y_buf[i] = 122 * mx + 51 * mi;
+        sum += y_buf[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i magnitude_est_cs16_x8_avx2(__m256i v)
+{
+    __m256i const k_mx = _mm256_set1_epi32(122);
+    __m256i const k_mi = _mm256_set1_epi32(51);
+    __m256i x  = _mm256_abs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16));
+    __m256i y  = _mm256_abs_epi32(_mm256_srai_epi32(v, 16));
+    __m256i mi = _mm256_min_epu32(x, y);
+    __m256i mx = _mm256_max_epu32(x, y);
+    __m256i e  = _mm256_add_epi32(_mm256_mullo_epi32(mx, k_mx), _mm256_mullo_epi32(mi, k_mi));
+    return _mm256_srli_epi32(e, 8); // max 22144
+}
+
+__attribute__((target("avx2")))
+static uint32_t magnitude_est_cs16_avx2(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    __m256i acc     = _mm256_setzero_si256();
+    unsigned long i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m256i e0 = magnitude_est_cs16_x8_avx2(_mm256_loadu_si256((__m256i const *)&iq_buf[2 * i]));
+        __m256i e1 = magnitude_est_cs16_x8_avx2(_mm256_loadu_si256((__m256i const *)&iq_buf[2 * i + 16]));
+        // packs works per 128-bit lane, restore the sample order
+        __m256i e = _mm256_permute4x64_epi64(_mm256_packs_epi32(e0, e1), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i *)&y_buf[i], e);
+        acc = _mm256_add_epi32(acc, _mm256_add_epi32(e0, e1));
+    }
+    uint32_t sum = hsum_epu32_avx2(acc);
+    for (; i < len; i++) {
+        uint32_t x = abs(iq_buf[2 * i]);
+        uint32_t y = abs(iq_buf[2 * i + 1]);
+        uint32_t mi = x < y ? x : y;
+        uint32_t mx = x > y ? x : y;
+        y_buf[i] = (122 * mx + 51 * mi) >> 8;
+        sum += y_buf[i];
+    }
+    return sum;
+}
+
+/// Magnitude estimate of eight CF32 samples, in the order 0, 1, 4, 5, 2, 3, 6, 7.
+__attribute__((target("avx2")))
+static inline __m256i magnitude_est_cf32_x8_avx2(__m256 a0, __m256 a1)
+{
+    __m256 const abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 const one      = _mm256_set1_ps(1.0f);
+    __m256 x  = _mm256_min_ps(_mm256_and_ps(_mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)), abs_mask), one);
+    __m256 y  = _mm256_min_ps(_mm256_and_ps(_mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)), abs_mask), one);
+    __m256 mi = _mm256_min_ps(x, y);
+    __m256 mx = _mm256_max_ps(x, y);
+    __m256 e  = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(122.0f), mx), _mm256_mul_ps(_mm256_set1_ps(51.0f), mi));
+    return _mm256_cvttps_epi32(_mm256_mul_ps(e, _mm256_set1_ps(INT16_MAX / 256.0f))); // max 22143
+}
+
+__attribute__((target("avx2")))
+static uint32_t magnitude_est_cf32_avx2(float const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    __m256i acc     = _mm256_setzero_si256();
+    unsigned long i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m256i e = magnitude_est_cf32_x8_avx2(_mm256_loadu_ps(&iq_buf[2 * i]), _mm256_loadu_ps(&iq_buf[2 * i + 8]));
+        // shuffle works per 128-bit lane, restore the sample order
+        e = _mm256_permute4x64_epi64(e, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128((__m128i *)&y_buf[i], _mm_packs_epi32(_mm256_castsi256_si128(e), _mm256_extracti128_si256(e, 1)));
+        acc = _mm256_add_epi32(acc, e);
+    }
+    return hsum_epu32_avx2(acc) + magnitude_est_cf32_scalar(&iq_buf[2 * i], &y_buf[i], len - i);
+}
+
+__attribute__((target("sse2")))
+static uint32_t level_range_sse2(int16_t const *buf, uint32_t len)
+{
+    __m128i lo      = _mm_set1_epi16(INT16_MAX);
+    __m128i hi      = _mm_set1_epi16(INT16_MIN);
+    unsigned long i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m128i v = _mm_loadu_si128((__m128i const *)&buf[i]);
+        lo = _mm_min_epi16(lo, v);
+        hi = _mm_max_epi16(hi, v);
+    }
+    // fold the lanes, then the scalar tail
+    lo = _mm_min_epi16(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(1, 0, 3, 2)));
+    hi = _mm_max_epi16(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(1, 0, 3, 2)));
+    lo = _mm_min_epi16(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+    hi = _mm_max_epi16(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+    lo = _mm_min_epi16(lo, _mm_srli_epi32(lo, 16));
+    hi = _mm_max_epi16(hi, _mm_srli_epi32(hi, 16));
+    int16_t v_lo = (int16_t)_mm_cvtsi128_si32(lo);
+    int16_t v_hi = (int16_t)_mm_cvtsi128_si32(hi);
+    uint32_t tail = level_range_scalar(&buf[i], len - i);
+    int16_t t_lo  = (int16_t)(tail & 0xffff);
+    int16_t t_hi  = (int16_t)(tail >> 16);
+    v_lo = t_lo < v_lo ? t_lo : v_lo;
+    v_hi = t_hi > v_hi ? t_hi : v_hi;
+    return ((uint32_t)(uint16_t)v_hi << 16) | (uint16_t)v_lo;
+}
+
+__attribute__((target("avx2")))
+static uint32_t level_range_avx2(int16_t const *buf, uint32_t len)
+{
+    __m256i lo      = _mm256_set1_epi16(INT16_MAX);
+    __m256i hi      = _mm256_set1_epi16(INT16_MIN);
+    unsigned long i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m256i v = _mm256_loadu_si256((__m256i const *)&buf[i]);
+        lo = _mm256_min_epi16(lo, v);
+        hi = _mm256_max_epi16(hi, v);
+    }
+    __m128i lo4 = _mm_min_epi16(_mm256_castsi256_si128(lo), _mm256_extracti128_si256(lo, 1));
+    __m128i hi4 = _mm_max_epi16(_mm256_castsi256_si128(hi), _mm256_extracti128_si256(hi, 1));
+    lo4 = _mm_min_epi16(lo4, _mm_shuffle_epi32(lo4, _MM_SHUFFLE(1, 0, 3, 2)));
+    hi4 = _mm_max_epi16(hi4, _mm_shuffle_epi32(hi4, _MM_SHUFFLE(1, 0, 3, 2)));
+    lo4 = _mm_min_epi16(lo4, _mm_shuffle_epi32(lo4, _MM_SHUFFLE(2, 3, 0, 1)));
+    hi4 = _mm_max_epi16(hi4, _mm_shuffle_epi32(hi4, _MM_SHUFFLE(2, 3, 0, 1)));
+    lo4 = _mm_min_epi16(lo4, _mm_srli_epi32(lo4, 16));
+    hi4 = _mm_max_epi16(hi4, _mm_srli_epi32(hi4, 16));
+    int16_t v_lo = (int16_t)_mm_cvtsi128_si32(lo4);
+    int16_t v_hi = (int16_t)_mm_cvtsi128_si32(hi4);
+    uint32_t tail = level_range_scalar(&buf[i], len - i);
+    int16_t t_lo  = (int16_t)(tail & 0xffff);
+    int16_t t_hi  = (int16_t)(tail >> 16);
+    v_lo = t_lo < v_lo ? t_lo : v_lo;
+    v_hi = t_hi > v_hi ? t_hi : v_hi;
+    return ((uint32_t)(uint16_t)v_hi << 16) | (uint16_t)v_lo;
+}
+
+#endif /* BASEBAND_SIMD_X86 */
+
+#ifdef BASEBAND_SIMD_NEON
+
+static uint32_t envelope_detect_neon(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    uint8x8_t const bias = vdup_n_u8(127);
+    uint32x4_t acc       = vdupq_n_u32(0);
+    unsigned long i      = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint8x16x2_t v = vld2q_u8(&iq_buf[2 * i]);
+        // 127 - x wraps to the correct signed value in 16 bit
+        int16x8_t xl  = vreinterpretq_s16_u16(vsubl_u8(bias, vget_low_u8(v.val[0])));
+        int16x8_t xh  = vreinterpretq_s16_u16(vsubl_u8(bias, vget_high_u8(v.val[0])));
+        int16x8_t yl  = vreinterpretq_s16_u16(vsubl_u8(bias, vget_low_u8(v.val[1])));
+        int16x8_t yh  = vreinterpretq_s16_u16(vsubl_u8(bias, vget_high_u8(v.val[1])));
+        uint16x8_t el = vreinterpretq_u16_s16(vmlaq_s16(vmulq_s16(xl, xl), yl, yl)); // max 32768
+        uint16x8_t eh = vreinterpretq_u16_s16(vmlaq_s16(vmulq_s16(xh, xh), yh, yh));
+        vst1q_u16(&y_buf[i], el);
+        vst1q_u16(&y_buf[i + 8], eh);
+        acc = vpadalq_u16(vpadalq_u16(acc, el), eh);
+    }
+    uint32_t sum = vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+    for (; i < len; i++) {
+        y_buf[i] = scaled_squares[iq_buf[2 * i]] + scaled_squares[iq_buf[2 * i + 1]];
+        sum += y_buf[i];
+    }
+    return sum;
+}
+
+static uint32_t magnitude_est_cu8_neon(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    uint8x16_t const bias = vdupq_n_u8(128);
+    uint8x8_t const k_mx  = vdup_n_u8(122);
+    uint8x8_t const k_mi  = vdup_n_u8(51);
+    uint32x4_t acc        = vdupq_n_u32(0);
+    unsigned long i       = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint8x16x2_t v = vld2q_u8(&iq_buf[2 * i]);
+        uint8x16_t x   = vabdq_u8(v.val[0], bias);
+        uint8x16_t y   = vabdq_u8(v.val[1], bias);
+        uint8x16_t mi  = vminq_u8(x, y);
+        uint8x16_t mx  = vmaxq_u8(x, y);
+        uint16x8_t el  = vmlal_u8(vmull_u8(vget_low_u8(mx), k_mx), vget_low_u8(mi), k_mi); // max 22144
+        uint16x8_t eh  = vmlal_u8(vmull_u8(vget_high_u8(mx), k_mx), vget_high_u8(mi), k_mi);
+        vst1q_u16(&y_buf[i], el);
+        vst1q_u16(&y_buf[i + 8], eh);
+        acc = vpadalq_u16(vpadalq_u16(acc, el), eh);
+    }
+    uint32_t sum = vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+    for (; i < len; i++) {
+        uint16_t x = abs(iq_buf[2 * i] - 128);
+        uint16_t y = abs(iq_buf[2 * i + 1] - 128);
+        uint16_t mi = x < y ? x : y;
+        uint16_t mx = x > y ? x : y;
+        y_buf[i] = 122 * mx + 51 * mi;
+        sum += y_buf[i];
+    }
+    return sum;
+}
+
+/// Magnitude estimate of four CS16 samples, note that vabsq_s16() would saturate.
+static inline uint32x4_t magnitude_est_cs16_x4_neon(int16x4_t i_s16, int16x4_t q_s16)
+{
+    uint32x4_t x  = vreinterpretq_u32_s32(vabsq_s32(vmovl_s16(i_s16)));
+    uint32x4_t y  = vreinterpretq_u32_s32(vabsq_s32(vmovl_s16(q_s16)));
+    uint32x4_t mi = vminq_u32(x, y);
+    uint32x4_t mx = vmaxq_u32(x, y);
+    return vshrq_n_u32(vmlaq_n_u32(vmulq_n_u32(mx, 122), mi, 51), 8); // max 22144
+}
+
+static uint32_t magnitude_est_cs16_neon(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    uint32x4_t acc  = vdupq_n_u32(0);
+    unsigned long i = 0;
+    for (; i + 8 <= len; i += 8) {
+        int16x8x2_t v = vld2q_s16(&iq_buf[2 * i]);
+        uint32x4_t el = magnitude_est_cs16_x4_neon(vget_low_s16(v.val[0]), vget_low_s16(v.val[1]));
+        uint32x4_t eh = magnitude_est_cs16_x4_neon(vget_high_s16(v.val[0]), vget_high_s16(v.val[1]));
+        vst1q_u16(&y_buf[i], vcombine_u16(vmovn_u32(el), vmovn_u32(eh)));
+        acc = vaddq_u32(acc, vaddq_u32(el, eh));
+    }
+    uint32_t sum = vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+    for (; i < len; i++) {
+        uint32_t x = abs(iq_buf[2 * i]);
+        uint32_t y = abs(iq_buf[2 * i + 1]);
+        uint32_t mi = x < y ? x : y;
+        uint32_t mx = x > y ? x : y;
+        y_buf[i] = (122 * mx + 51 * mi) >> 8;
+        sum += y_buf[i];
+    }
+    return sum;
+}
+
+static uint32_t level_range_neon(int16_t const *buf, uint32_t len)
+{
+    int16x8_t lo    = vdupq_n_s16(INT16_MAX);
+    int16x8_t hi    = vdupq_n_s16(INT16_MIN);
+    unsigned long i = 0;
+    for (; i + 8 <= len; i += 8) {
+        int16x8_t v = vld1q_s16(&buf[i]);
+        lo = vminq_s16(lo, v);
+        hi = vmaxq_s16(hi, v);
+    }
+    int16x4_t lo4 = vmin_s16(vget_low_s16(lo), vget_high_s16(lo));
+    int16x4_t hi4 = vmax_s16(vget_low_s16(hi), vget_high_s16(hi));
+    lo4 = vpmin_s16(lo4, lo4);
+    hi4 = vpmax_s16(hi4, hi4);
+    lo4 = vpmin_s16(lo4, lo4);
+    hi4 = vpmax_s16(hi4, hi4);
+    int16_t v_lo = vget_lane_s16(lo4, 0);
+    int16_t v_hi = vget_lane_s16(hi4, 0);
+    uint32_t tail = level_range_scalar(&buf[i], len - i);
+    int16_t t_lo  = (int16_t)(tail & 0xffff);
+    int16_t t_hi  = (int16_t)(tail >> 16);
+    v_lo = t_lo < v_lo ? t_lo : v_lo;
+    v_hi = t_hi > v_hi ? t_hi : v_hi;
+    return ((uint32_t)(uint16_t)v_hi << 16) | (uint16_t)v_lo;
+}
+
+#endif /* BASEBAND_SIMD_NEON */
+
+/* Runtime dispatch, selected in baseband_init(). */
+
+/// The kernels return the (wrapping) sum of all output levels.
+typedef uint32_t (*amp_cu8_fn)(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len);
+typedef uint32_t (*amp_cs16_fn)(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len);
+typedef uint32_t (*amp_cf32_fn)(float const *iq_buf, uint16_t *y_buf, uint32_t len);
+
+static amp_cu8_fn envelope_detect_impl     = envelope_detect_scalar;
+static amp_cu8_fn magnitude_est_cu8_impl   = magnitude_est_cu8_scalar;
+static amp_cs16_fn magnitude_est_cs16_impl = magnitude_est_cs16_scalar;
+static amp_cf32_fn magnitude_est_cf32_impl = magnitude_est_cf32_scalar;
+static uint32_t (*level_range_impl)(int16_t const *buf, uint32_t len) = level_range_scalar;
+static int baseband_simd_level;
+
+static void fm_disc_update(void);
+static void lp_update(void);
+
+float envelope_detect(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    uint32_t sum = envelope_detect_impl(iq_buf, y_buf, len);
+    return len > 0 && sum >= len ? AMP_TO_DB((float)sum / len) : AMP_TO_DB(1);
+}
+
+float magnitude_est_cu8(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    uint32_t sum = magnitude_est_cu8_impl(iq_buf, y_buf, len);
+    return len > 0 && sum >= len ? MAG_TO_DB((float)sum / len) : MAG_TO_DB(1);
+}
+
+float magnitude_est_cs16(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    uint32_t sum = magnitude_est_cs16_impl(iq_buf, y_buf, len);
+    return len > 0 && sum >= len ? MAG_TO_DB((float)sum / len) : MAG_TO_DB(1);
+}
+
+float magnitude_est_cf32(float const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    uint32_t sum = magnitude_est_cf32_impl(iq_buf, y_buf, len);
+    return len > 0 && sum >= len ? MAG_TO_DB((float)sum / len) : MAG_TO_DB(1);
+}
+
+float baseband_squelch_estimate(void const *iq_buf, int sample_size, int use_mag_est, uint32_t len, float *peak_db)
+{
+    float sub_buf[SQUELCH_BLOCK_LEN / SQUELCH_STRIDE * 2]; // room for CF32, the largest sample
+    uint16_t y_buf[SQUELCH_BLOCK_LEN / SQUELCH_STRIDE];
+    uint8_t const *in = iq_buf;
+    uint8_t *sub      = (uint8_t *)sub_buf;
+    uint64_t sum      = 0;
+    uint32_t n_sub    = 0;
+    uint32_t peak     = 0;
+
+    for (uint32_t pos = 0; pos < len; pos += SQUELCH_BLOCK_LEN) {
+        uint32_t n = len - pos < SQUELCH_BLOCK_LEN ? len - pos : SQUELCH_BLOCK_LEN;
+        uint32_t k = (n + SQUELCH_STRIDE - 1) / SQUELCH_STRIDE;
+        for (uint32_t j = 0; j < k; ++j)
+            memcpy(&sub[j * sample_size], &in[(size_t)(pos + j * SQUELCH_STRIDE) * sample_size], sample_size);
+
+        uint32_t block;
+        if (sample_size == 8)
+            block = magnitude_est_cf32_impl(sub_buf, y_buf, k);
+        else if (sample_size == 4)
+            block = magnitude_est_cs16_impl((int16_t *)sub_buf, y_buf, k);
+        else if (use_mag_est)
+            block = magnitude_est_cu8_impl(sub, y_buf, k);
+        else
+            block = envelope_detect_impl(sub, y_buf, k);
+        sum += block;
+        n_sub += k;
+        // a partial last block is noisier, which only makes the squelch open more often
+        peak = block / k > peak ? block / k : peak;
+    }
+
+    float avg = n_sub > 0 ? (float)sum / n_sub : 0.0f;
+    if (sample_size == 2 && !use_mag_est) {
+        *peak_db = peak >= 1 ? AMP_TO_DB((float)peak) : AMP_TO_DB(1);
+        return avg >= 1.0f ? AMP_TO_DB(avg) : AMP_TO_DB(1);
+    }
+    *peak_db = peak >= 1 ? MAG_TO_DB((float)peak) : MAG_TO_DB(1);
+    return avg >= 1.0f ? MAG_TO_DB(avg) : MAG_TO_DB(1);
+}
+
+void baseband_level_range(int16_t const *buf, uint32_t len, int16_t *min, int16_t *max)
+{
+    uint32_t range = level_range_impl(buf, len);
+    *min = (int16_t)(range & 0xffff);
+    *max = (int16_t)(range >> 16);
+}
+
+/// Check if the CPU supports a SIMD level.
+static int baseband_simd_supported(int level)
+{
+    switch (level) {
+    case BASEBAND_SIMD_NONE:
+        return 1;
+#ifdef BASEBAND_SIMD_X86
+    case BASEBAND_SIMD_SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+    case BASEBAND_SIMD_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+#ifdef BASEBAND_SIMD_NEON
+    case BASEBAND_SIMD_NEON:
+        return 1; // compiled for NEON implies the CPU has it
+#endif
+    default:
+        return 0;
+    }
+}
+
+int baseband_simd_select(int level)
+{
+    // fall back to the best supported level below the requested one
+    while (level > BASEBAND_SIMD_NONE && !baseband_simd_supported(level)) {
+        level--;
+    }
+
+    envelope_detect_impl    = envelope_detect_scalar;
+    magnitude_est_cu8_impl  = magnitude_est_cu8_scalar;
+    magnitude_est_cs16_impl = magnitude_est_cs16_scalar;
+    magnitude_est_cf32_impl = magnitude_est_cf32_scalar;
+    level_range_impl        = level_range_scalar;
+#ifdef BASEBAND_SIMD_X86
+    if (level == BASEBAND_SIMD_SSE2) {
+        envelope_detect_impl    = envelope_detect_sse2;
+        magnitude_est_cu8_impl  = magnitude_est_cu8_sse2;
+        magnitude_est_cs16_impl = magnitude_est_cs16_sse2;
+        magnitude_est_cf32_impl = magnitude_est_cf32_sse2;
+        level_range_impl        = level_range_sse2;
+    }
+    else if (level == BASEBAND_SIMD_AVX2) {
+        envelope_detect_impl    = envelope_detect_avx2;
+        magnitude_est_cu8_impl  = magnitude_est_cu8_avx2;
+        magnitude_est_cs16_impl = magnitude_est_cs16_avx2;
+        magnitude_est_cf32_impl = magnitude_est_cf32_avx2;
+        level_range_impl        = level_range_avx2;
+    }
+#endif
+#ifdef BASEBAND_SIMD_NEON
+    if (level == BASEBAND_SIMD_NEON) {
+        envelope_detect_impl    = envelope_detect_neon;
+        magnitude_est_cu8_impl  = magnitude_est_cu8_neon;
+        magnitude_est_cs16_impl = magnitude_est_cs16_neon;
+        level_range_impl        = level_range_neon;
+    }
+#endif
+    baseband_simd_level = level;
+    fm_disc_update();
+    lp_update();
+    return level;
+}
+
+char const *baseband_simd_name(int level)
+{
+    switch (level) {
+    case BASEBAND_SIMD_SSE2: return "SSE2";
+    case BASEBAND_SIMD_AVX2: return "AVX2";
+    case BASEBAND_SIMD_NEON: return "NEON";
+    default: return "none";
+    }
+}
+
+int baseband_simd_current(void)
+{
+    return baseband_simd_level;
+}
+
 void baseband_low_pass_filter_reset(filter_state_t *lowpass_filter)
 {
     *lowpass_filter = (filter_state_t){0};
@@ -141,8 +816,11 @@ void baseband_low_pass_filter_reset(filter_state_t *lowpass_filter)
     - Q15.14 + Q15.14 + Q15.14 could possibly overflow to 17.14
     - but the b coeffs are small so it won't happen
     - Q15.14>>14 = Q15.0
+
+    @param x1 previous input sample
+    @param y1 previous output sample
 */
-void baseband_low_pass_filter(filter_state_t *state, uint16_t const *x_buf, int16_t *y_buf, uint32_t len)
+static void low_pass_filter_run(int x1, int y1, uint16_t const *x_buf, int16_t *y_buf, uint32_t len)
 {
     ///  [b,a] = butter(1, 0.01) -> 3x tau (95%) ~100 samples
     //static int const a[FILTER_ORDER + 1] = {FIX(1.00000) >> 1, FIX(0.96907) >> 1};
@@ -152,125 +830,340 @@ void baseband_low_pass_filter(filter_state_t *state, uint16_t const *x_buf, int1
     static int const b[FILTER_ORDER + 1] = {FIX(0.07296) >> 1, FIX(0.07296) >> 1};
     // note that coeffs are prescaled by div 2
 
-    // Prevent out of bounds access
-    if (len < FILTER_ORDER) {
-        return;
-    }
-
     // Calculate first sample
-    y_buf[0] = (a[1] * state->y[0] + b[0] * (x_buf[0] + state->x[0])) >> (F_SCALE - 1); // note: prescaled, b[0]==b[1]
+    y_buf[0] = (a[1] * y1 + b[0] * (x_buf[0] + x1)) >> (F_SCALE - 1); // note: prescaled, b[0]==b[1]
     for (unsigned long i = 1; i < len; i++) {
         y_buf[i] = (a[1] * y_buf[i - 1] + b[0] * (x_buf[i] + x_buf[i - 1])) >> (F_SCALE - 1); // note: prescaled, b[0]==b[1]
     }
-
-    // Save last samples
-    memcpy(state->x, &x_buf[len - FILTER_ORDER], FILTER_ORDER * sizeof (int16_t));
-    memcpy(state->y, &y_buf[len - FILTER_ORDER], FILTER_ORDER * sizeof (int16_t));
 }
 
+/* AM low pass filter bank, designed for the sample rate and cutoff. */
 
-/** Integer implementation of atan2() with int16_t normalized output.
+/// Samples per pass of the filter bank, a multiple of LP_BLOCK_LEN.
+#define LP_CHUNK_LEN 1024
+/// Default cutoff of the designed filters, in Hz.
+#define LP_DEFAULT_CUTOFF 10000.0f
 
-    Returns arc tangent of y/x across all quadrants in radians.
-    Error max 0.07 radians.
-    Reference: http://dspguru.com/dsp/tricks/fixed-point-atan2-with-self-normalization
-    @param y Numerator (imaginary value of complex vector)
-    @param x Denominator (real value of complex vector)
-    @return angle in radians (Pi equals INT16_MAX)
+typedef void (*lp_fir_fn)(float const *h, unsigned num_taps, float const *x_buf, float *y_buf, uint32_t len);
+typedef uint32_t (*lp_biquad_fn)(float const *blk, float *st, float *x_buf, uint32_t len);
+
+/// FIR, y[i] = sum h[k] * x[i + k], the taps are symmetric so the window needs no reversal.
+static void lp_fir_scalar(float const *h, unsigned num_taps, float const *x_buf, float *y_buf, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; ++i) {
+        float acc = 0.0f;
+        for (unsigned k = 0; k < num_taps; ++k)
+            acc += h[k] * x_buf[i + k];
+        y_buf[i] = acc;
+    }
+}
+
+/** One biquad section on whole blocks, in place.
+
+    Each output of a block is a fixed linear combination of the two previous outputs,
+    the two previous inputs, and the inputs of the block, see lp_biquad_design().
+    The block outputs don't depend on each other, which is what the SIMD versions use.
+    @param blk block responses, LP_BLOCK_LEN outputs per term
+    @param[in,out] st x[-1], x[-2], y[-1], y[-2]
+    @return the number of samples processed, a multiple of LP_BLOCK_LEN
 */
-static int16_t atan2_int16(int32_t y, int32_t x)
+static uint32_t lp_biquad_scalar(float const *blk, float *st, float *x_buf, uint32_t len)
 {
-    static int32_t const I_PI_4 = INT16_MAX/4;      // M_PI/4
-    static int32_t const I_3_PI_4 = 3*INT16_MAX/4;  // 3*M_PI/4
+    uint32_t i = 0;
+    for (; i + LP_BLOCK_LEN <= len; i += LP_BLOCK_LEN) {
+        float in[LP_BLOCK_LEN + 4] = {st[2], st[3], st[1], st[0]};
+        memcpy(&in[4], &x_buf[i], sizeof(float) * LP_BLOCK_LEN);
+        for (unsigned j = 0; j < LP_BLOCK_LEN; ++j) {
+            float acc = 0.0f;
+            for (unsigned t = 0; t < LP_BLOCK_LEN + 4; ++t)
+                acc += blk[t * LP_BLOCK_LEN + j] * in[t];
+            x_buf[i + j] = acc;
+        }
+        st[0] = in[LP_BLOCK_LEN + 3];
+        st[1] = in[LP_BLOCK_LEN + 2];
+        st[2] = x_buf[i + LP_BLOCK_LEN - 1];
+        st[3] = x_buf[i + LP_BLOCK_LEN - 2];
+    }
+    return i;
+}
 
-    int32_t const abs_y = abs(y);
-    int32_t angle;
+/// One biquad section sample by sample, in place, for the samples after the last whole block.
+static void lp_biquad_tail(float const *c, float *st, float *x_buf, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; ++i) {
+        float x = x_buf[i];
+        float y = c[0] * x + c[1] * st[0] + c[2] * st[1] - c[3] * st[2] - c[4] * st[3];
+        st[1] = st[0];
+        st[0] = x;
+        st[3] = st[2];
+        st[2] = y;
+        x_buf[i] = y;
+    }
+}
 
-    if (!x && !y) return 0; // We would get 8191 with the code below
+#ifdef BASEBAND_SIMD_X86
 
-    if (x >= 0) {    // Quadrant I and IV
-        int32_t denom = (abs_y + x);
-        if (denom == 0) denom = 1;  // Prevent divide by zero
-        angle = I_PI_4 - I_PI_4 * (x - abs_y) / denom;
-    } else {        // Quadrant II and III
-        int32_t denom = (abs_y - x);
-        if (denom == 0) denom = 1;  // Prevent divide by zero
-        angle = I_3_PI_4 - I_PI_4 * (x + abs_y) / denom;
+__attribute__((target("sse2")))
+static void lp_fir_sse2(float const *h, unsigned num_taps, float const *x_buf, float *y_buf, uint32_t len)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        __m128 acc = _mm_setzero_ps();
+        for (unsigned k = 0; k < num_taps; ++k)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(h[k]), _mm_loadu_ps(&x_buf[i + k])));
+        _mm_storeu_ps(&y_buf[i], acc);
     }
-    if (y < 0) angle = -angle;    // Negate if in III or IV
-    return angle;
+    lp_fir_scalar(h, num_taps, &x_buf[i], &y_buf[i], len - i);
 }
 
-void baseband_demod_FM_reset(demodfm_state_t *demod_fm)
+__attribute__((target("sse2")))
+static uint32_t lp_biquad_sse2(float const *blk, float *st, float *x_buf, uint32_t len)
 {
-    *demod_fm = (demodfm_state_t){0};
+    uint32_t i = 0;
+    for (; i + LP_BLOCK_LEN <= len; i += LP_BLOCK_LEN) {
+        float in[LP_BLOCK_LEN + 4] = {st[2], st[3], st[1], st[0]};
+        memcpy(&in[4], &x_buf[i], sizeof(float) * LP_BLOCK_LEN);
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        for (unsigned t = 0; t < LP_BLOCK_LEN + 4; ++t) {
+            __m128 v = _mm_set1_ps(in[t]);
+            acc0     = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(&blk[t * LP_BLOCK_LEN]), v));
+            acc1     = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(&blk[t * LP_BLOCK_LEN + 4]), v));
+        }
+        _mm_storeu_ps(&x_buf[i], acc0);
+        _mm_storeu_ps(&x_buf[i + 4], acc1);
+        st[0] = in[LP_BLOCK_LEN + 3];
+        st[1] = in[LP_BLOCK_LEN + 2];
+        st[2] = x_buf[i + LP_BLOCK_LEN - 1];
+        st[3] = x_buf[i + LP_BLOCK_LEN - 2];
+    }
+    return i;
 }
 
-/// Fast Instantaneous frequency and Low Pass filter, CU8 samples
-void baseband_demod_FM(demodfm_state_t *state, uint8_t const *x_buf, int16_t *y_buf, unsigned long num_samples, uint32_t samp_rate, float low_pass)
+__attribute__((target("avx2")))
+static void lp_fir_avx2(float const *h, unsigned num_taps, float const *x_buf, float *y_buf, uint32_t len)
 {
-    // Select filter coeffs, [b,a] = butter(1, cutoff)
-    // e.g [b,a] = butter(1, 0.1) -> 3x tau (95%) ~10 samples, 250k -> 40us, 1024k -> 10us
-    // a = 1.00000, 0.72654; b = 0.13673, 0.13673;
-    // e.g. [b,a] = butter(1, 0.2) -> 3x tau (95%) ~5 samples, 250k -> 20us, 1024k -> 5us
-    // a = 1.00000, 0.50953; b = 0.24524, 0.24524;
-    if (state->rate != samp_rate) {
-        if (low_pass > 1e4f) {
-            low_pass = low_pass / samp_rate;
-        } else if (low_pass >= 1.0f) {
-            low_pass = 1e6f / low_pass / samp_rate;
+    uint32_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m256 acc = _mm256_setzero_ps();
+        for (unsigned k = 0; k < num_taps; ++k)
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(h[k]), _mm256_loadu_ps(&x_buf[i + k])));
+        _mm256_storeu_ps(&y_buf[i], acc);
+    }
+    lp_fir_scalar(h, num_taps, &x_buf[i], &y_buf[i], len - i);
+}
+
+__attribute__((target("avx2")))
+static uint32_t lp_biquad_avx2(float const *blk, float *st, float *x_buf, uint32_t len)
+{
+    uint32_t i = 0;
+    for (; i + LP_BLOCK_LEN <= len; i += LP_BLOCK_LEN) {
+        float in[LP_BLOCK_LEN + 4] = {st[2], st[3], st[1], st[0]};
+        memcpy(&in[4], &x_buf[i], sizeof(float) * LP_BLOCK_LEN);
+        __m256 acc = _mm256_setzero_ps();
+        for (unsigned t = 0; t < LP_BLOCK_LEN + 4; ++t)
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(&blk[t * LP_BLOCK_LEN]), _mm256_set1_ps(in[t])));
+        _mm256_storeu_ps(&x_buf[i], acc);
+        st[0] = in[LP_BLOCK_LEN + 3];
+        st[1] = in[LP_BLOCK_LEN + 2];
+        st[2] = x_buf[i + LP_BLOCK_LEN - 1];
+        st[3] = x_buf[i + LP_BLOCK_LEN - 2];
+    }
+    return i;
+}
+
+#endif /* BASEBAND_SIMD_X86 */
+
+static lp_fir_fn lp_fir_impl       = lp_fir_scalar;
+static lp_biquad_fn lp_biquad_impl = lp_biquad_scalar;
+
+/// Select the filter bank kernels for the current SIMD level.
+static void lp_update(void)
+{
+    lp_fir_impl    = lp_fir_scalar;
+    lp_biquad_impl = lp_biquad_scalar;
+#ifdef BASEBAND_SIMD_X86
+    if (baseband_simd_level == BASEBAND_SIMD_SSE2) {
+        lp_fir_impl    = lp_fir_sse2;
+        lp_biquad_impl = lp_biquad_sse2;
+    }
+    else if (baseband_simd_level == BASEBAND_SIMD_AVX2) {
+        lp_fir_impl    = lp_fir_avx2;
+        lp_biquad_impl = lp_biquad_avx2;
+    }
+#endif
+}
+
+/// Hamming windowed sinc with unity DC gain, the transition band is about as wide as the cutoff.
+static void lp_fir_design(filter_state_t *state, double fc)
+{
+    unsigned n = (unsigned)ceil(3.3 / fc) | 1;
+    n = n < 3 ? 3 : n > LP_FIR_MAX_TAPS ? LP_FIR_MAX_TAPS : n;
+    double center = (n - 1) / 2.0;
+    double sum    = 0.0;
+    double h[LP_FIR_MAX_TAPS];
+    for (unsigned k = 0; k < n; ++k) {
+        double t = k - center;
+        h[k] = t == 0.0 ? 2.0 * fc : sin(2.0 * M_PI * fc * t) / (M_PI * t);
+        h[k] *= 0.54 - 0.46 * cos(2.0 * M_PI * k / (n - 1));
+        sum += h[k];
+    }
+    for (unsigned k = 0; k < n; ++k) {
+        state->fir_coeffs[k] = (float)(h[k] / sum);
+    }
+    state->num_taps = n;
+}
+
+/// Butterworth cascade of LP_BIQUAD_SECTIONS sections using the bilinear transform, and the block responses of each section.
+static void lp_biquad_design(filter_state_t *state, double fc)
+{
+    double k = tan(M_PI * fc);
+    for (unsigned s = 0; s < LP_BIQUAD_SECTIONS; ++s) {
+        double q    = 1.0 / (2.0 * cos(M_PI * (2 * s + 1) / (4 * LP_BIQUAD_SECTIONS)));
+        double norm = 1.0 / (1.0 + k / q + k * k);
+        double c[5];
+        c[0] = k * k * norm;
+        c[1] = 2.0 * c[0];
+        c[2] = c[0];
+        c[3] = 2.0 * (k * k - 1.0) * norm;
+        c[4] = (1.0 - k / q + k * k) * norm;
+        for (unsigned i = 0; i < 5; ++i)
+            state->bq_coeffs[s][i] = (float)c[i];
+
+        // response of a block to each term alone: y[-1], y[-2], x[-2], x[-1], x[0], ..., x[LP_BLOCK_LEN - 1]
+        for (unsigned t = 0; t < LP_BLOCK_LEN + 4; ++t) {
+            double x[LP_BLOCK_LEN + 2] = {0};
+            double y[LP_BLOCK_LEN + 2] = {0};
+            if (t < 2)
+                y[1 - t] = 1.0;
+            else
+                x[t - 2] = 1.0;
+            for (unsigned j = 0; j < LP_BLOCK_LEN; ++j) {
+                y[j + 2] = c[0] * x[j + 2] + c[1] * x[j + 1] + c[2] * x[j] - c[3] * y[j + 1] - c[4] * y[j];
+                state->bq_block[s][t][j] = (float)y[j + 2];
+            }
         }
-        print_logf(LOG_NOTICE, "Baseband", "low pass filter for %u Hz at cutoff %.0f Hz, %.1f us",
-                samp_rate, samp_rate * low_pass, 1e6 / (samp_rate * low_pass));
-        double ita  = 1.0 / tan(M_PI_2 * low_pass);
-        double gain = 1.0 / (1.0 + ita) / 2; // prescaled by div 2
-        state->alp_16[0] = FIX(1.0);
-        state->alp_16[1] = FIX((ita - 1.0) * gain); // scaled by -1
-        state->blp_16[0] = FIX(gain);
-        state->blp_16[1] = FIX(gain);
-        state->rate      = samp_rate;
     }
-    int32_t const *alp = state->alp_16;
-    int32_t const *blp = state->blp_16;
+}
 
-    // Pre-feed old sample
-    int16_t x0r = state->xr; // IQ sample: x[n], real
-    int16_t x0i = state->xi; // IQ sample: x[n], imag
-    int16_t x0f = state->xf; // Instantaneous frequency
-    int16_t y0f = state->yf; // Instantaneous frequency, low pass filtered
+void baseband_low_pass_filter_setup(filter_state_t *state, int type, uint32_t samp_rate, float cutoff)
+{
+    if (type == state->type && samp_rate == state->rate && cutoff == state->cutoff)
+        return; // unchanged
+    *state = (filter_state_t){0};
+    state->type   = type;
+    state->rate   = samp_rate;
+    state->cutoff = cutoff;
+    if (type != BASEBAND_LP_FIR && type != BASEBAND_LP_BIQUAD) {
+        state->type = BASEBAND_LP_IIR;
+        return; // the fixed filter needs no design
+    }
 
-    for (unsigned n = 0; n < num_samples; n++) {
-        int16_t x1r, x1i; // Old IQ sample: x[n-1]
-        int16_t x1f, y1f; // Instantaneous frequency, old sample
-        int32_t pr, pi;   // Phase difference vector
+    float hz = cutoff > 0.0f ? cutoff : LP_DEFAULT_CUTOFF;
+    double fc = (double)hz / samp_rate;
+    fc = fc < 0.45 ? fc : 0.45;
 
-        // delay old sample
-        x1r = x0r;
-        x1i = x0i;
-        y1f = y0f;
-        x1f = x0f;
-        // get new sample
-        x0r = *x_buf++ - 128;
-        x0i = *x_buf++ - 128;
-        // Calculate phase difference vector: x[n] * conj(x[n-1])
-        pr = x0r * x1r + x0i * x1i; // May exactly overflow an int16_t (-128*-128 + -128*-128)
-        pi = x0i * x1r - x0r * x1i;
-        // xlp = (int16_t)((atan2f(pi, pr) / M_PI) * INT16_MAX); // Floating point implementation
-        x0f = atan2_int16(pi, pr); // Integer implementation
-        // xlp = pi; // Cheat and use only imaginary part (works OK, but is amplitude sensitive)
-        // Low pass filter
-        // y0f      = ((alp[1] * y1f >> 1) + (blp[0] * x0f >> 1) + (blp[1] * x1f >> 1)) >> (F_SCALE - 1);
-        y0f      = (alp[1] * y1f + blp[0] * (x0f + x1f)) >> (F_SCALE - 1); // note: prescaled, blp[0]==blp[1]
-        *y_buf++ = y0f;
+    if (type == BASEBAND_LP_FIR) {
+        lp_fir_design(state, fc);
+        print_logf(LOG_NOTICE, "Baseband", "AM low pass FIR for %u Hz at cutoff %.0f Hz, %u taps",
+                samp_rate, fc * samp_rate, state->num_taps);
+    }
+    else {
+        lp_biquad_design(state, fc);
+        print_logf(LOG_NOTICE, "Baseband", "AM low pass Butterworth order %d for %u Hz at cutoff %.0f Hz",
+                2 * LP_BIQUAD_SECTIONS, samp_rate, fc * samp_rate);
     }
+}
 
-    // Store newest sample for next run
-    state->xr = x0r;
-    state->xi = x0i;
-    state->xf = x0f;
-    state->yf = y0f;
+/// Round and clamp the filter output.
+static void lp_store(float const *x_buf, int16_t *y_buf, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; ++i) {
+        float v = x_buf[i];
+        y_buf[i] = v >= 32767.0f ? INT16_MAX : v <= -32768.0f ? INT16_MIN : (int16_t)lrintf(v);
+    }
+}
+
+/// Run the designed FIR or biquad filter.
+static void lp_bank_run(filter_state_t *state, uint16_t const *x_buf, int16_t *y_buf, uint32_t len)
+{
+    float buf[LP_FIR_MAX_TAPS - 1 + LP_CHUNK_LEN];
+    float out[LP_CHUNK_LEN];
+    unsigned hist = state->type == BASEBAND_LP_FIR ? state->num_taps - 1 : 0;
+
+    memcpy(buf, state->fir_hist, sizeof(float) * hist);
+    for (uint32_t pos = 0; pos < len; pos += LP_CHUNK_LEN) {
+        uint32_t n = len - pos < LP_CHUNK_LEN ? len - pos : LP_CHUNK_LEN;
+        for (uint32_t i = 0; i < n; ++i)
+            buf[hist + i] = x_buf[pos + i];
+
+        if (state->type == BASEBAND_LP_FIR) {
+            lp_fir_impl(state->fir_coeffs, state->num_taps, buf, out, n);
+            lp_store(out, &y_buf[pos], n);
+            // keep the newest samples as history for the next chunk
+            memmove(buf, &buf[n], sizeof(float) * hist);
+        }
+        else {
+            for (unsigned s = 0; s < LP_BIQUAD_SECTIONS; ++s) {
+                uint32_t done = lp_biquad_impl(&state->bq_block[s][0][0], state->bq_state[s], buf, n);
+                lp_biquad_tail(state->bq_coeffs[s], state->bq_state[s], &buf[done], n - done);
+            }
+            lp_store(buf, &y_buf[pos], n);
+        }
+    }
+    memcpy(state->fir_hist, buf, sizeof(float) * hist);
+}
+
+void baseband_low_pass_filter(filter_state_t *state, uint16_t const *x_buf, int16_t *y_buf, uint32_t len)
+{
+    if (state->type != BASEBAND_LP_IIR) {
+        lp_bank_run(state, x_buf, y_buf, len);
+        return;
+    }
+
+    // Prevent out of bounds access
+    if (len < FILTER_ORDER) {
+        return;
+    }
+
+    low_pass_filter_run(state->x[0], state->y[0], x_buf, y_buf, len);
+
+    // Save last samples
+    memcpy(state->x, &x_buf[len - FILTER_ORDER], FILTER_ORDER * sizeof (int16_t));
+    memcpy(state->y, &y_buf[len - FILTER_ORDER], FILTER_ORDER * sizeof (int16_t));
 }
 
+/** Integer implementation of atan2() with int16_t normalized output.
+
+    Returns arc tangent of y/x across all quadrants in radians.
+    Error max 0.07 radians.
+    Reference: http://dspguru.com/dsp/tricks/fixed-point-atan2-with-self-normalization
+    @param y Numerator (imaginary value of complex vector)
+    @param x Denominator (real value of complex vector)
+    @return angle in radians (Pi equals INT16_MAX)
+*/
+static int16_t atan2_int16(int32_t y, int32_t x)
+{
+    static int32_t const I_PI_4 = INT16_MAX/4;      // M_PI/4
+    static int32_t const I_3_PI_4 = 3*INT16_MAX/4;  // 3*M_PI/4
+
+    int32_t const abs_y = abs(y);
+    int32_t angle;
+
+    if (!x && !y) return 0; // We would get 8191 with the code below
+
+    if (x >= 0) {    // Quadrant I and IV
+        int32_t denom = (abs_y + x);
+        if (denom == 0) denom = 1;  // Prevent divide by zero
+        angle = I_PI_4 - I_PI_4 * (x - abs_y) / denom;
+    } else {        // Quadrant II and III
+        int32_t denom = (abs_y - x);
+        if (denom == 0) denom = 1;  // Prevent divide by zero
+        angle = I_3_PI_4 - I_PI_4 * (x + abs_y) / denom;
+    }
+    if (y < 0) angle = -angle;    // Negate if in III or IV
+    return angle;
+}
 
 // Fixed-point arithmetic on Q0.31 (actually Q0.30 to counter 64 signed trouble)
 #define F_SCALE32 30
@@ -299,8 +1192,592 @@ static int32_t atan2_int32(int32_t y, int32_t x)
     return angle;
 }
 
-/// Fast Instantaneous frequency and Low Pass filter, CS16 samples.
-void baseband_demod_FM_cs16(demodfm_state_t *state, int16_t const *x_buf, int16_t *y_buf, unsigned long num_samples, uint32_t samp_rate, float low_pass)
+/// Pi as float for CS16 output, the largest float below 2^31 so rounding can't overflow an int32_t.
+#define FM_PI_INT32 2147483520.0f
+
+// Odd polynomial for atan() on [0, 1], error max 1e-5 radians (Abramowitz and Stegun 4.4.49)
+#define ATAN_A1 0.9998660f
+#define ATAN_A3 -0.3302995f
+#define ATAN_A5 0.1801410f
+#define ATAN_A7 -0.0851330f
+#define ATAN_A9 0.0208351f
+
+/** Branchless polynomial approximation of atan2().
+
+    Error max 1e-5 radians before rounding the output, vectorizes without any branches.
+    The SIMD versions below use the same operations in the same order.
+    @param y Numerator (imaginary value of complex vector)
+    @param x Denominator (real value of complex vector)
+    @param pi_scaled the output value for Pi
+    @return angle scaled to pi_scaled
+*/
+static inline float atan2_poly(float y, float x, float pi_scaled)
+{
+    float ax = fabsf(x);
+    float ay = fabsf(y);
+    float mx = ax > ay ? ax : ay;
+    float mn = ax < ay ? ax : ay;
+    float z  = mn / (mx > FLT_MIN ? mx : FLT_MIN); // mn is 0 if mx is 0
+    float z2 = z * z;
+    float p  = (((ATAN_A9 * z2 + ATAN_A7) * z2 + ATAN_A5) * z2 + ATAN_A3) * z2 + ATAN_A1;
+    float a  = z * p * (pi_scaled / (float)M_PI);
+    a = ay > ax ? pi_scaled * 0.5f - a : a; // Octant swap
+    a = x < 0.0f ? pi_scaled - a : a;       // Quadrant II and III
+    return y < 0.0f ? -a : a;               // Negate if in III or IV
+}
+
+/** Conjugate product discriminator, the normalized imaginary part sin(dphi) without any atan.
+
+    Error is dphi - sin(dphi), below dphi^3 / 6, i.e. 0.02 radians at +-0.5 radians (+-0.08 fs),
+    and the output folds back beyond +-Pi/2.
+    @param y Numerator (imaginary value of complex vector)
+    @param x Denominator (real value of complex vector)
+    @param pi_scaled the output value for Pi
+    @return angle scaled to pi_scaled
+*/
+static inline float fm_conj(float y, float x, float pi_scaled)
+{
+    float m = sqrtf(x * x + y * y);
+    return y / (m > FLT_MIN ? m : FLT_MIN) * (pi_scaled / (float)M_PI);
+}
+
+/* FM discriminators, each writes the phase difference of x[n] * conj(x[n-1]) for every sample. */
+
+/// CU8 discriminators output Pi as INT16_MAX, the state holds the previous sample.
+typedef void (*fm_disc_cu8_fn)(demodfm_state_t *state, uint8_t const *x_buf, int16_t *f_buf, uint32_t len);
+/// CS16 discriminators output Pi as INT32_MAX, the state holds the previous sample.
+typedef void (*fm_disc_cs16_fn)(demodfm_state_t *state, int16_t const *x_buf, int32_t *f_buf, uint32_t len);
+/// CF32 discriminators output Pi as INT32_MAX, the state holds the previous sample.
+typedef void (*fm_disc_cf32_fn)(demodfm_state_t *state, float const *x_buf, int32_t *f_buf, uint32_t len);
+
+static inline void fm_disc_cu8_scalar(demodfm_state_t *state, uint8_t const *x_buf, int16_t *f_buf, uint32_t len, int disc)
+{
+    int16_t x0r = state->xr; // IQ sample: x[n], real
+    int16_t x0i = state->xi; // IQ sample: x[n], imag
+
+    for (uint32_t n = 0; n < len; n++) {
+        // delay old sample
+        int16_t x1r = x0r;
+        int16_t x1i = x0i;
+        // get new sample
+        x0r = *x_buf++ - 128;
+        x0i = *x_buf++ - 128;
+        // Calculate phase difference vector: x[n] * conj(x[n-1])
+        int32_t pr = x0r * x1r + x0i * x1i; // May exactly overflow an int16_t (-128*-128 + -128*-128)
+        int32_t pi = x0i * x1r - x0r * x1i;
+        if (disc == BASEBAND_FM_POLY)
+            f_buf[n] = (int16_t)lrintf(atan2_poly(pi, pr, INT16_MAX));
+        else if (disc == BASEBAND_FM_CONJ)
+            f_buf[n] = (int16_t)lrintf(fm_conj(pi, pr, INT16_MAX));
+        else {
+            // f = (int16_t)((atan2f(pi, pr) / M_PI) * INT16_MAX); // Floating point implementation
+            f_buf[n] = atan2_int16(pi, pr); // Integer implementation
+            // f = pi; // Cheat and use only imaginary part (works OK, but is amplitude sensitive)
+        }
+    }
+
+    // Store newest sample for next run
+    state->xr = x0r;
+    state->xi = x0i;
+}
+
+static void fm_atan2_cu8_scalar(demodfm_state_t *state, uint8_t const *x_buf, int16_t *f_buf, uint32_t len)
+{
+    fm_disc_cu8_scalar(state, x_buf, f_buf, len, BASEBAND_FM_ATAN2);
+}
+
+static void fm_poly_cu8_scalar(demodfm_state_t *state, uint8_t const *x_buf, int16_t *f_buf, uint32_t len)
+{
+    fm_disc_cu8_scalar(state, x_buf, f_buf, len, BASEBAND_FM_POLY);
+}
+
+static void fm_conj_cu8_scalar(demodfm_state_t *state, uint8_t const *x_buf, int16_t *f_buf, uint32_t len)
+{
+    fm_disc_cu8_scalar(state, x_buf, f_buf, len, BASEBAND_FM_CONJ);
+}
+
+static inline void fm_disc_cs16_scalar(demodfm_state_t *state, int16_t const *x_buf, int32_t *f_buf, uint32_t len, int disc)
+{
+    int32_t x0r = state->xr; // IQ sample: x[n], real
+    int32_t x0i = state->xi; // IQ sample: x[n], imag
+
+    for (uint32_t n = 0; n < len; n++) {
+        // delay old sample
+        int32_t x1r = x0r;
+        int32_t x1i = x0i;
+        // get new sample
+        x0r = *x_buf++;
+        x0i = *x_buf++;
+        // Calculate phase difference vector: x[n] * conj(x[n-1])
+        int64_t pr = (int64_t)x0r * x1r + (int64_t)x0i * x1i; // May exactly overflow an int32_t (-32768*-32768 + -32768*-32768)
+        int64_t pi = (int64_t)x0i * x1r - (int64_t)x0r * x1i;
+        if (disc == BASEBAND_FM_POLY)
+            f_buf[n] = (int32_t)lrintf(atan2_poly(pi, pr, FM_PI_INT32));
+        else if (disc == BASEBAND_FM_CONJ)
+            f_buf[n] = (int32_t)lrintf(fm_conj(pi, pr, FM_PI_INT32));
+        else {
+            // f = (int32_t)((atan2f(pi, pr) / M_PI) * INT32_MAX); // Floating point implementation
+            f_buf[n] = atan2_int32(pi, pr); // Integer implementation
+            // f = atan2_int16(pi >> 16, pr >> 16) << 16; // Integer implementation, truncated
+        }
+    }
+
+    // Store newest sample for next run
+    state->xr = x0r;
+    state->xi = x0i;
+}
+
+static void fm_atan2_cs16_scalar(demodfm_state_t *state, int16_t const *x_buf, int32_t *f_buf, uint32_t len)
+{
+    fm_disc_cs16_scalar(state, x_buf, f_buf, len, BASEBAND_FM_ATAN2);
+}
+
+static void fm_poly_cs16_scalar(demodfm_state_t *state, int16_t const *x_buf, int32_t *f_buf, uint32_t len)
+{
+    fm_disc_cs16_scalar(state, x_buf, f_buf, len, BASEBAND_FM_POLY);
+}
+
+static void fm_conj_cs16_scalar(demodfm_state_t *state, int16_t const *x_buf, int32_t *f_buf, uint32_t len)
+{
+    fm_disc_cs16_scalar(state, x_buf, f_buf, len, BASEBAND_FM_CONJ);
+}
+
+static inline void fm_disc_cf32_scalar(demodfm_state_t *state, float const *x_buf, int32_t *f_buf, uint32_t len, int disc)
+{
+    float x0r = state->xr_f; // IQ sample: x[n], real
+    float x0i = state->xi_f; // IQ sample: x[n], imag
+
+    for (uint32_t n = 0; n < len; n++) {
+        // delay old sample
+        float x1r = x0r;
+        float x1i = x0i;
+        // get new sample
+        x0r = *x_buf++;
+        x0i = *x_buf++;
+        // Calculate phase difference vector: x[n] * conj(x[n-1])
+        float pr = x0r * x1r + x0i * x1i;
+        float pi = x0i * x1r - x0r * x1i;
+        if (disc == BASEBAND_FM_POLY)
+            f_buf[n] = (int32_t)lrintf(atan2_poly(pi, pr, FM_PI_INT32));
+        else if (disc == BASEBAND_FM_CONJ)
+            f_buf[n] = (int32_t)lrintf(fm_conj(pi, pr, FM_PI_INT32));
+        else
+            f_buf[n] = (int32_t)lrintf(atan2f(pi, pr) * (FM_PI_INT32 / (float)M_PI)); // Floating point implementation
+    }
+
+    // Store newest sample for next run
+    state->xr_f = x0r;
+    state->xi_f = x0i;
+}
+
+static void fm_atan2_cf32_scalar(demodfm_state_t *state, float const *x_buf, int32_t *f_buf, uint32_t len)
+{
+    fm_disc_cf32_scalar(state, x_buf, f_buf, len, BASEBAND_FM_ATAN2);
+}
+
+static void fm_poly_cf32_scalar(demodfm_state_t *state, float const *x_buf, int32_t *f_buf, uint32_t len)
+{
+    fm_disc_cf32_scalar(state, x_buf, f_buf, len, BASEBAND_FM_POLY);
+}
+
+static void fm_conj_cf32_scalar(demodfm_state_t *state, float const *x_buf, int32_t *f_buf, uint32_t len)
+{
+    fm_disc_cf32_scalar(state, x_buf, f_buf, len, BASEBAND_FM_CONJ);
+}
+
+#ifdef BASEBAND_SIMD_X86
+
+__attribute__((target("sse2")))
+static inline __m128 select_ps_sse2(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/// Four atan2_poly() at once.
+__attribute__((target("sse2")))
+static inline __m128 atan2_poly_sse2(__m128 y, __m128 x, float pi_scaled)
+{
+    __m128 const abs_mask  = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 const sign_mask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+    __m128 const zero      = _mm_setzero_ps();
+
+    __m128 ax = _mm_and_ps(x, abs_mask);
+    __m128 ay = _mm_and_ps(y, abs_mask);
+    __m128 mx = _mm_max_ps(ax, ay);
+    __m128 mn = _mm_min_ps(ax, ay);
+    __m128 z  = _mm_div_ps(mn, _mm_max_ps(mx, _mm_set1_ps(FLT_MIN)));
+    __m128 z2 = _mm_mul_ps(z, z);
+    __m128 p  = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ATAN_A9), z2), _mm_set1_ps(ATAN_A7));
+    p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(ATAN_A5));
+    p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(ATAN_A3));
+    p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(ATAN_A1));
+    __m128 a = _mm_mul_ps(_mm_mul_ps(z, p), _mm_set1_ps(pi_scaled / (float)M_PI));
+    a = select_ps_sse2(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(pi_scaled * 0.5f), a), a);
+    a = select_ps_sse2(_mm_cmplt_ps(x, zero), _mm_sub_ps(_mm_set1_ps(pi_scaled), a), a);
+    return _mm_xor_ps(a, _mm_and_ps(_mm_cmplt_ps(y, zero), sign_mask));
+}
+
+/// Four fm_conj() at once.
+__attribute__((target("sse2")))
+static inline __m128 fm_conj_sse2(__m128 y, __m128 x, float pi_scaled)
+{
+    __m128 m = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+    __m128 a = _mm_div_ps(y, _mm_max_ps(m, _mm_set1_ps(FLT_MIN)));
+    return _mm_mul_ps(a, _mm_set1_ps(pi_scaled / (float)M_PI));
+}
+
+__attribute__((target("sse2")))
+static inline void fm_disc_cu8_sse2(demodfm_state_t *state, uint8_t const *x_buf, int16_t *f_buf, uint32_t len, int disc)
+{
+    __m128i const zero      = _mm_setzero_si128();
+    __m128i const bias      = _mm_set1_epi16(128);
+    __m128i const conj_sign = _mm_set_epi16(-1, 1, -1, 1, -1, 1, -1, 1);
+
+    if (len < 1)
+        return;
+    // the first sample pairs with the last sample of the previous run
+    fm_disc_cu8_scalar(state, x_buf, f_buf, 1, disc);
+
+    uint32_t n = 1;
+    for (; n + 4 <= len; n += 4) {
+        __m128i x0 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const *)&x_buf[2 * n]), zero), bias);
+        __m128i x1 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const *)&x_buf[2 * n - 2]), zero), bias);
+        // x0r * x1r + x0i * x1i, x0i * x1r - x0r * x1i
+        __m128i x0s = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x0, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+        __m128 pr   = _mm_cvtepi32_ps(_mm_madd_epi16(x0, x1));
+        __m128 pi   = _mm_cvtepi32_ps(_mm_madd_epi16(x0s, _mm_mullo_epi16(x1, conj_sign)));
+        __m128 a    = disc == BASEBAND_FM_CONJ ? fm_conj_sse2(pi, pr, INT16_MAX) : atan2_poly_sse2(pi, pr, INT16_MAX);
+        __m128i v   = _mm_cvtps_epi32(a);
+        _mm_storel_epi64((__m128i *)&f_buf[n], _mm_packs_epi32(v, v));
+    }
+
+    state->xr = x_buf[2 * n - 2] - 128;
+    state->xi = x_buf[2 * n - 1] - 128;
+    fm_disc_cu8_scalar(state, &x_buf[2 * n], &f_buf[n], len - n, disc);
+}
+
+__attribute__((target("sse2")))
+static void fm_poly_cu8_sse2(demodfm_state_t *state, uint8_t const *x_buf, int16_t *f_buf, uint32_t len)
+{
+    fm_disc_cu8_sse2(state, x_buf, f_buf, len, BASEBAND_FM_POLY);
+}
+
+__attribute__((target("sse2")))
+static void fm_conj_cu8_sse2(demodfm_state_t *state, uint8_t const *x_buf, int16_t *f_buf, uint32_t len)
+{
+    fm_disc_cu8_sse2(state, x_buf, f_buf, len, BASEBAND_FM_CONJ);
+}
+
+__attribute__((target("sse2")))
+static inline void fm_disc_cf32_sse2(demodfm_state_t *state, float const *x_buf, int32_t *f_buf, uint32_t len, int disc)
+{
+    if (len < 1)
+        return;
+    // the first sample pairs with the last sample of the previous run
+    fm_disc_cf32_scalar(state, x_buf, f_buf, 1, disc);
+
+    uint32_t n = 1;
+    for (; n + 4 <= len; n += 4) {
+        __m128 a0  = _mm_loadu_ps(&x_buf[2 * n]);
+        __m128 a1  = _mm_loadu_ps(&x_buf[2 * n + 4]);
+        __m128 b0  = _mm_loadu_ps(&x_buf[2 * n - 2]);
+        __m128 b1  = _mm_loadu_ps(&x_buf[2 * n + 2]);
+        __m128 x0r = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 x0i = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 x1r = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 x1i = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 pr  = _mm_add_ps(_mm_mul_ps(x0r, x1r), _mm_mul_ps(x0i, x1i));
+        __m128 pi  = _mm_sub_ps(_mm_mul_ps(x0i, x1r), _mm_mul_ps(x0r, x1i));
+        __m128 a   = disc == BASEBAND_FM_CONJ ? fm_conj_sse2(pi, pr, FM_PI_INT32) : atan2_poly_sse2(pi, pr, FM_PI_INT32);
+        _mm_storeu_si128((__m128i *)&f_buf[n], _mm_cvtps_epi32(a));
+    }
+
+    state->xr_f = x_buf[2 * n - 2];
+    state->xi_f = x_buf[2 * n - 1];
+    fm_disc_cf32_scalar(state, &x_buf[2 * n], &f_buf[n], len - n, disc);
+}
+
+__attribute__((target("sse2")))
+static void fm_poly_cf32_sse2(demodfm_state_t *state, float const *x_buf, int32_t *f_buf, uint32_t len)
+{
+    fm_disc_cf32_sse2(state, x_buf, f_buf, len, BASEBAND_FM_POLY);
+}
+
+__attribute__((target("sse2")))
+static void fm_conj_cf32_sse2(demodfm_state_t *state, float const *x_buf, int32_t *f_buf, uint32_t len)
+{
+    fm_disc_cf32_sse2(state, x_buf, f_buf, len, BASEBAND_FM_CONJ);
+}
+
+/// Eight atan2_poly() at once.
+__attribute__((target("avx2")))
+static inline __m256 atan2_poly_avx2(__m256 y, __m256 x, float pi_scaled)
+{
+    __m256 const abs_mask  = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 const sign_mask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+    __m256 const zero      = _mm256_setzero_ps();
+
+    __m256 ax = _mm256_and_ps(x, abs_mask);
+    __m256 ay = _mm256_and_ps(y, abs_mask);
+    __m256 mx = _mm256_max_ps(ax, ay);
+    __m256 mn = _mm256_min_ps(ax, ay);
+    __m256 z  = _mm256_div_ps(mn, _mm256_max_ps(mx, _mm256_set1_ps(FLT_MIN)));
+    __m256 z2 = _mm256_mul_ps(z, z);
+    __m256 p  = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(ATAN_A9), z2), _mm256_set1_ps(ATAN_A7));
+    p = _mm256_add_ps(_mm256_mul_ps(p, z2), _mm256_set1_ps(ATAN_A5));
+    p = _mm256_add_ps(_mm256_mul_ps(p, z2), _mm256_set1_ps(ATAN_A3));
+    p = _mm256_add_ps(_mm256_mul_ps(p, z2), _mm256_set1_ps(ATAN_A1));
+    __m256 a = _mm256_mul_ps(_mm256_mul_ps(z, p), _mm256_set1_ps(pi_scaled / (float)M_PI));
+    a = _mm256_blendv_ps(a, _mm256_sub_ps(_mm256_set1_ps(pi_scaled * 0.5f), a), _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+    a = _mm256_blendv_ps(a, _mm256_sub_ps(_mm256_set1_ps(pi_scaled), a), _mm256_cmp_ps(x, zero, _CMP_LT_OQ));
+    return _mm256_xor_ps(a, _mm256_and_ps(_mm256_cmp_ps(y, zero, _CMP_LT_OQ), sign_mask));
+}
+
+/// Eight fm_conj() at once.
+__attribute__((target("avx2")))
+static inline __m256 fm_conj_avx2(__m256 y, __m256 x, float pi_scaled)
+{
+    __m256 m = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)));
+    __m256 a = _mm256_div_ps(y, _mm256_max_ps(m, _mm256_set1_ps(FLT_MIN)));
+    return _mm256_mul_ps(a, _mm256_set1_ps(pi_scaled / (float)M_PI));
+}
+
+__attribute__((target("avx2")))
+static inline void fm_disc_cu8_avx2(demodfm_state_t *state, uint8_t const *x_buf, int16_t *f_buf, uint32_t len, int disc)
+{
+    __m256i const bias      = _mm256_set1_epi16(128);
+    __m256i const conj_sign = _mm256_set_epi16(-1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1);
+
+    if (len < 1)
+        return;
+    // the first sample pairs with the last sample of the previous run
+    fm_disc_cu8_scalar(state, x_buf, f_buf, 1, disc);
+
+    uint32_t n = 1;
+    for (; n + 8 <= len; n += 8) {
+        __m256i x0 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)&x_buf[2 * n])), bias);
+        __m256i x1 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)&x_buf[2 * n - 2])), bias);
+        // x0r * x1r + x0i * x1i, x0i * x1r - x0r * x1i
+        __m256i x0s = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x0, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+        __m256 pr   = _mm256_cvtepi32_ps(_mm256_madd_epi16(x0, x1));
+        __m256 pi   = _mm256_cvtepi32_ps(_mm256_madd_epi16(x0s, _mm256_mullo_epi16(x1, conj_sign)));
+        __m256 a    = disc == BASEBAND_FM_CONJ ? fm_conj_avx2(pi, pr, INT16_MAX) : atan2_poly_avx2(pi, pr, INT16_MAX);
+        __m256i v   = _mm256_cvtps_epi32(a);
+        __m128i v16 = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        _mm_storeu_si128((__m128i *)&f_buf[n], v16);
+    }
+
+    state->xr = x_buf[2 * n - 2] - 128;
+    state->xi = x_buf[2 * n - 1] - 128;
+    fm_disc_cu8_scalar(state, &x_buf[2 * n], &f_buf[n], len - n, disc);
+}
+
+__attribute__((target("avx2")))
+static void fm_poly_cu8_avx2(demodfm_state_t *state, uint8_t const *x_buf, int16_t *f_buf, uint32_t len)
+{
+    fm_disc_cu8_avx2(state, x_buf, f_buf, len, BASEBAND_FM_POLY);
+}
+
+__attribute__((target("avx2")))
+static void fm_conj_cu8_avx2(demodfm_state_t *state, uint8_t const *x_buf, int16_t *f_buf, uint32_t len)
+{
+    fm_disc_cu8_avx2(state, x_buf, f_buf, len, BASEBAND_FM_CONJ);
+}
+
+__attribute__((target("avx2")))
+static inline void fm_disc_cf32_avx2(demodfm_state_t *state, float const *x_buf, int32_t *f_buf, uint32_t len, int disc)
+{
+    if (len < 1)
+        return;
+    // the first sample pairs with the last sample of the previous run
+    fm_disc_cf32_scalar(state, x_buf, f_buf, 1, disc);
+
+    uint32_t n = 1;
+    for (; n + 8 <= len; n += 8) {
+        __m256 a0  = _mm256_loadu_ps(&x_buf[2 * n]);
+        __m256 a1  = _mm256_loadu_ps(&x_buf[2 * n + 8]);
+        __m256 b0  = _mm256_loadu_ps(&x_buf[2 * n - 2]);
+        __m256 b1  = _mm256_loadu_ps(&x_buf[2 * n + 6]);
+        // shuffle works per 128-bit lane, the samples are in the order 0, 1, 4, 5, 2, 3, 6, 7
+        __m256 x0r = _mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 x0i = _mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1));
+        __m256 x1r = _mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 x1i = _mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1));
+        __m256 pr  = _mm256_add_ps(_mm256_mul_ps(x0r, x1r), _mm256_mul_ps(x0i, x1i));
+        __m256 pi  = _mm256_sub_ps(_mm256_mul_ps(x0i, x1r), _mm256_mul_ps(x0r, x1i));
+        __m256 a   = disc == BASEBAND_FM_CONJ ? fm_conj_avx2(pi, pr, FM_PI_INT32) : atan2_poly_avx2(pi, pr, FM_PI_INT32);
+        __m256i v  = _mm256_permute4x64_epi64(_mm256_cvtps_epi32(a), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i *)&f_buf[n], v);
+    }
+
+    state->xr_f = x_buf[2 * n - 2];
+    state->xi_f = x_buf[2 * n - 1];
+    fm_disc_cf32_scalar(state, &x_buf[2 * n], &f_buf[n], len - n, disc);
+}
+
+__attribute__((target("avx2")))
+static void fm_poly_cf32_avx2(demodfm_state_t *state, float const *x_buf, int32_t *f_buf, uint32_t len)
+{
+    fm_disc_cf32_avx2(state, x_buf, f_buf, len, BASEBAND_FM_POLY);
+}
+
+__attribute__((target("avx2")))
+static void fm_conj_cf32_avx2(demodfm_state_t *state, float const *x_buf, int32_t *f_buf, uint32_t len)
+{
+    fm_disc_cf32_avx2(state, x_buf, f_buf, len, BASEBAND_FM_CONJ);
+}
+
+#endif /* BASEBAND_SIMD_X86 */
+
+static fm_disc_cu8_fn fm_disc_cu8_impl   = fm_atan2_cu8_scalar;
+static fm_disc_cs16_fn fm_disc_cs16_impl = fm_atan2_cs16_scalar;
+static fm_disc_cf32_fn fm_disc_cf32_impl = fm_atan2_cf32_scalar;
+static int baseband_fm_disc;
+
+/// Select the discriminator kernels for the current discriminator and SIMD level.
+static void fm_disc_update(void)
+{
+    if (baseband_fm_disc == BASEBAND_FM_POLY) {
+        fm_disc_cu8_impl  = fm_poly_cu8_scalar;
+        fm_disc_cs16_impl = fm_poly_cs16_scalar;
+        fm_disc_cf32_impl = fm_poly_cf32_scalar;
+#ifdef BASEBAND_SIMD_X86
+        if (baseband_simd_level == BASEBAND_SIMD_SSE2) {
+            fm_disc_cu8_impl  = fm_poly_cu8_sse2;
+            fm_disc_cf32_impl = fm_poly_cf32_sse2;
+        }
+        else if (baseband_simd_level == BASEBAND_SIMD_AVX2) {
+            fm_disc_cu8_impl  = fm_poly_cu8_avx2;
+            fm_disc_cf32_impl = fm_poly_cf32_avx2;
+        }
+#endif
+    }
+    else if (baseband_fm_disc == BASEBAND_FM_CONJ) {
+        fm_disc_cu8_impl  = fm_conj_cu8_scalar;
+        fm_disc_cs16_impl = fm_conj_cs16_scalar;
+        fm_disc_cf32_impl = fm_conj_cf32_scalar;
+#ifdef BASEBAND_SIMD_X86
+        if (baseband_simd_level == BASEBAND_SIMD_SSE2) {
+            fm_disc_cu8_impl  = fm_conj_cu8_sse2;
+            fm_disc_cf32_impl = fm_conj_cf32_sse2;
+        }
+        else if (baseband_simd_level == BASEBAND_SIMD_AVX2) {
+            fm_disc_cu8_impl  = fm_conj_cu8_avx2;
+            fm_disc_cf32_impl = fm_conj_cf32_avx2;
+        }
+#endif
+    }
+    else {
+        fm_disc_cu8_impl  = fm_atan2_cu8_scalar;
+        fm_disc_cs16_impl = fm_atan2_cs16_scalar;
+        fm_disc_cf32_impl = fm_atan2_cf32_scalar;
+    }
+}
+
+int baseband_fm_disc_select(int disc)
+{
+    if (disc < BASEBAND_FM_ATAN2 || disc > BASEBAND_FM_CONJ)
+        disc = BASEBAND_FM_ATAN2;
+    baseband_fm_disc = disc;
+    fm_disc_update();
+    return disc;
+}
+
+int baseband_fm_disc_current(void)
+{
+    return baseband_fm_disc;
+}
+
+char const *baseband_fm_disc_name(int disc)
+{
+    switch (disc) {
+    case BASEBAND_FM_POLY: return "poly";
+    case BASEBAND_FM_CONJ: return "conj";
+    default: return "atan2";
+    }
+}
+
+void baseband_fm_discriminate(demodfm_state_t *state, uint8_t const *x_buf, int16_t *f_buf, uint32_t len)
+{
+    fm_disc_cu8_impl(state, x_buf, f_buf, len);
+}
+
+void baseband_fm_discriminate_cs16(demodfm_state_t *state, int16_t const *x_buf, int32_t *f_buf, uint32_t len)
+{
+    fm_disc_cs16_impl(state, x_buf, f_buf, len);
+}
+
+void baseband_fm_discriminate_cf32(demodfm_state_t *state, float const *x_buf, int32_t *f_buf, uint32_t len)
+{
+    fm_disc_cf32_impl(state, x_buf, f_buf, len);
+}
+
+void baseband_demod_FM_reset(demodfm_state_t *demod_fm)
+{
+    *demod_fm = (demodfm_state_t){0};
+}
+
+/// Samples per discriminator pass, the instantaneous frequency buffer lives on the stack.
+#define FM_CHUNK_LEN 1024
+
+/// Fast Instantaneous frequency and Low Pass filter, CU8 samples
+void baseband_demod_FM(demodfm_state_t *state, uint8_t const *x_buf, int16_t *y_buf, unsigned long num_samples, uint32_t samp_rate, float low_pass)
+{
+    // Select filter coeffs, [b,a] = butter(1, cutoff)
+    // e.g [b,a] = butter(1, 0.1) -> 3x tau (95%) ~10 samples, 250k -> 40us, 1024k -> 10us
+    // a = 1.00000, 0.72654; b = 0.13673, 0.13673;
+    // e.g. [b,a] = butter(1, 0.2) -> 3x tau (95%) ~5 samples, 250k -> 20us, 1024k -> 5us
+    // a = 1.00000, 0.50953; b = 0.24524, 0.24524;
+    if (state->rate != samp_rate) {
+        if (low_pass > 1e4f) {
+            low_pass = low_pass / samp_rate;
+        } else if (low_pass >= 1.0f) {
+            low_pass = 1e6f / low_pass / samp_rate;
+        }
+        print_logf(LOG_NOTICE, "Baseband", "low pass filter for %u Hz at cutoff %.0f Hz, %.1f us",
+                samp_rate, samp_rate * low_pass, 1e6 / (samp_rate * low_pass));
+        double ita  = 1.0 / tan(M_PI_2 * low_pass);
+        double gain = 1.0 / (1.0 + ita) / 2; // prescaled by div 2
+        state->alp_16[0] = FIX(1.0);
+        state->alp_16[1] = FIX((ita - 1.0) * gain); // scaled by -1
+        state->blp_16[0] = FIX(gain);
+        state->blp_16[1] = FIX(gain);
+        state->rate      = samp_rate;
+    }
+    int32_t const *alp = state->alp_16;
+    int32_t const *blp = state->blp_16;
+    int16_t f_buf[FM_CHUNK_LEN]; // Instantaneous frequency
+
+    // Pre-feed old sample
+    int16_t x0f = state->xf; // Instantaneous frequency
+    int16_t y0f = state->yf; // Instantaneous frequency, low pass filtered
+
+    for (unsigned long pos = 0; pos < num_samples; pos += FM_CHUNK_LEN) {
+        uint32_t len = num_samples - pos < FM_CHUNK_LEN ? num_samples - pos : FM_CHUNK_LEN;
+        fm_disc_cu8_impl(state, &x_buf[2 * pos], f_buf, len);
+
+        for (uint32_t n = 0; n < len; n++) {
+            int16_t x1f, y1f; // Instantaneous frequency, old sample
+
+            // delay old sample
+            y1f = y0f;
+            x1f = x0f;
+            // get new sample
+            x0f = f_buf[n];
+            // Low pass filter
+            // y0f      = ((alp[1] * y1f >> 1) + (blp[0] * x0f >> 1) + (blp[1] * x1f >> 1)) >> (F_SCALE - 1);
+            y0f      = (alp[1] * y1f + blp[0] * (x0f + x1f)) >> (F_SCALE - 1); // note: prescaled, blp[0]==blp[1]
+            *y_buf++ = y0f;
+        }
+    }
+
+    // Store newest sample for next run
+    state->xf = x0f;
+    state->yf = y0f;
+}
+
+/// Set up the 32 bit low pass filter of the CS16 and CF32 FM demodulators.
+static void demod_FM_setup_32(demodfm_state_t *state, uint32_t samp_rate, float low_pass)
 {
     // Select filter coeffs, [b,a] = butter(1, cutoff)
     // e.g [b,a] = butter(1, 0.1) -> 3x tau (95%) ~10 samples, 250k -> 40us, 1024k -> 10us
@@ -323,35 +1800,26 @@ void baseband_demod_FM_cs16(demodfm_state_t *state, int16_t const *x_buf, int16_
         state->blp_32[1] = FIX32(gain);
         state->rate      = samp_rate;
     }
+}
+
+/// Low pass filter a chunk of 32 bit instantaneous frequency.
+static void demod_FM_low_pass_32(demodfm_state_t *state, int32_t const *f_buf, int16_t *y_buf, uint32_t len)
+{
     int64_t const *alp = state->alp_32;
     int64_t const *blp = state->blp_32;
 
     // Pre-feed old sample
-    int32_t x0r = state->xr; // IQ sample: x[n], real
-    int32_t x0i = state->xi; // IQ sample: x[n], imag
     int32_t x0f = state->xf; // Instantaneous frequency
     int32_t y0f = state->yf; // Instantaneous frequency, low pass filtered
 
-    for (unsigned n = 0; n < num_samples; n++) {
-        int32_t x1r, x1i; // Old IQ sample: x[n-1]
+    for (uint32_t n = 0; n < len; n++) {
         int32_t x1f, y1f; // Instantaneous frequency, old sample
-        int64_t pr, pi;   // Phase difference vector
 
         // delay old sample
-        x1r = x0r;
-        x1i = x0i;
         y1f = y0f;
         x1f = x0f;
         // get new sample
-        x0r = *x_buf++;
-        x0i = *x_buf++;
-        // Calculate phase difference vector: x[n] * conj(x[n-1])
-        pr = (int64_t)x0r * x1r + (int64_t)x0i * x1i; // May exactly overflow an int32_t (-32768*-32768 + -32768*-32768)
-        pi = (int64_t)x0i * x1r - (int64_t)x0r * x1i;
-        // xlp = (int32_t)((atan2f(pi, pr) / M_PI) * INT32_MAX); // Floating point implementation
-        x0f = atan2_int32(pi, pr); // Integer implementation
-        // xlp = atan2_int16(pi >> 16, pr >> 16) << 16; // Integer implementation, truncated
-        // xlp = pi; // Cheat and use only imaginary part (works OK, but is amplitude sensitive)
+        x0f = f_buf[n];
         // Low pass filter
         // y0f      = (alp[1] * y1f + blp[0] * x0f + blp[1] * x1f) >> F_SCALE32;
         y0f      = (alp[1] * y1f + blp[0] * ((int64_t)x0f + x1f)) >> F_SCALE32; // note: blp[0]==blp[1]
@@ -359,13 +1827,227 @@ void baseband_demod_FM_cs16(demodfm_state_t *state, int16_t const *x_buf, int16_
     }
 
     // Store newest sample for next run
-    state->xr = x0r;
-    state->xi = x0i;
     state->xf = x0f;
     state->yf = y0f;
 }
 
+/// Fast Instantaneous frequency and Low Pass filter, CS16 samples.
+void baseband_demod_FM_cs16(demodfm_state_t *state, int16_t const *x_buf, int16_t *y_buf, unsigned long num_samples, uint32_t samp_rate, float low_pass)
+{
+    int32_t f_buf[FM_CHUNK_LEN]; // Instantaneous frequency
+
+    demod_FM_setup_32(state, samp_rate, low_pass);
+    for (unsigned long pos = 0; pos < num_samples; pos += FM_CHUNK_LEN) {
+        uint32_t len = num_samples - pos < FM_CHUNK_LEN ? num_samples - pos : FM_CHUNK_LEN;
+        fm_disc_cs16_impl(state, &x_buf[2 * pos], f_buf, len);
+        demod_FM_low_pass_32(state, f_buf, &y_buf[pos], len);
+    }
+}
+
+/// Fast Instantaneous frequency and Low Pass filter, CF32 samples.
+void baseband_demod_FM_cf32(demodfm_state_t *state, float const *x_buf, int16_t *y_buf, unsigned long num_samples, uint32_t samp_rate, float low_pass)
+{
+    int32_t f_buf[FM_CHUNK_LEN]; // Instantaneous frequency
+
+    demod_FM_setup_32(state, samp_rate, low_pass);
+    for (unsigned long pos = 0; pos < num_samples; pos += FM_CHUNK_LEN) {
+        uint32_t len = num_samples - pos < FM_CHUNK_LEN ? num_samples - pos : FM_CHUNK_LEN;
+        fm_disc_cf32_impl(state, &x_buf[2 * pos], f_buf, len);
+        demod_FM_low_pass_32(state, f_buf, &y_buf[pos], len);
+    }
+}
+
+/// Samples per fused chunk, the chunk's IQ, envelope, and outputs should stay in L1 cache.
+#define FUSED_CHUNK_LEN 2048
+
+/// AM envelope, low pass and FM for one chunk at a time, the state is carried exactly as with separate calls.
+static uint32_t demod_AM_FM_chunked(filter_state_t *lp_state, demodfm_state_t *fm_state, void const *iq_buf, int sample_size, int use_mag_est, int16_t *am_buf, int16_t *fm_buf, uint32_t len, uint32_t samp_rate, float low_pass)
+{
+    uint8_t const *cu8_buf  = iq_buf;
+    int16_t const *cs16_buf = iq_buf;
+    float const *cf32_buf   = iq_buf;
+    uint16_t env_buf[FUSED_CHUNK_LEN];
+    uint32_t sum = 0;
+    // the previous input sample is only truncated to int16 when stored in the state
+    int x1 = lp_state->x[0];
+    int y1 = lp_state->y[0];
+
+    for (uint32_t pos = 0; pos < len; pos += FUSED_CHUNK_LEN) {
+        uint32_t n = len - pos < FUSED_CHUNK_LEN ? len - pos : FUSED_CHUNK_LEN;
+
+        if (sample_size == 8)
+            sum += magnitude_est_cf32_impl(&cf32_buf[2 * pos], env_buf, n);
+        else if (sample_size == 4)
+            sum += magnitude_est_cs16_impl(&cs16_buf[2 * pos], env_buf, n);
+        else if (use_mag_est)
+            sum += magnitude_est_cu8_impl(&cu8_buf[2 * pos], env_buf, n);
+        else
+            sum += envelope_detect_impl(&cu8_buf[2 * pos], env_buf, n);
+
+        if (lp_state->type == BASEBAND_LP_IIR) {
+            low_pass_filter_run(x1, y1, env_buf, &am_buf[pos], n);
+            x1 = env_buf[n - 1];
+            y1 = am_buf[pos + n - 1];
+        }
+        else {
+            lp_bank_run(lp_state, env_buf, &am_buf[pos], n);
+        }
+
+        if (fm_buf && sample_size == 8)
+            baseband_demod_FM_cf32(fm_state, &cf32_buf[2 * pos], &fm_buf[pos], n, samp_rate, low_pass);
+        else if (fm_buf && sample_size == 4)
+            baseband_demod_FM_cs16(fm_state, &cs16_buf[2 * pos], &fm_buf[pos], n, samp_rate, low_pass);
+        else if (fm_buf)
+            baseband_demod_FM(fm_state, &cu8_buf[2 * pos], &fm_buf[pos], n, samp_rate, low_pass);
+    }
+
+    if (lp_state->type == BASEBAND_LP_IIR && len >= FILTER_ORDER) {
+        lp_state->x[0] = (int16_t)x1;
+        lp_state->y[0] = (int16_t)y1;
+    }
+    return sum;
+}
+
+float baseband_demod_AM_FM(filter_state_t *lp_state, demodfm_state_t *fm_state, uint8_t const *iq_buf, int use_mag_est, int16_t *am_buf, int16_t *fm_buf, uint32_t len, uint32_t samp_rate, float low_pass)
+{
+    uint32_t sum = demod_AM_FM_chunked(lp_state, fm_state, iq_buf, 2, use_mag_est, am_buf, fm_buf, len, samp_rate, low_pass);
+    if (use_mag_est)
+        return len > 0 && sum >= len ? MAG_TO_DB((float)sum / len) : MAG_TO_DB(1);
+    else
+        return len > 0 && sum >= len ? AMP_TO_DB((float)sum / len) : AMP_TO_DB(1);
+}
+
+float baseband_demod_AM_FM_cs16(filter_state_t *lp_state, demodfm_state_t *fm_state, int16_t const *iq_buf, int16_t *am_buf, int16_t *fm_buf, uint32_t len, uint32_t samp_rate, float low_pass)
+{
+    uint32_t sum = demod_AM_FM_chunked(lp_state, fm_state, iq_buf, 4, 1, am_buf, fm_buf, len, samp_rate, low_pass);
+    return len > 0 && sum >= len ? MAG_TO_DB((float)sum / len) : MAG_TO_DB(1);
+}
+
+float baseband_demod_AM_FM_cf32(filter_state_t *lp_state, demodfm_state_t *fm_state, float const *iq_buf, int16_t *am_buf, int16_t *fm_buf, uint32_t len, uint32_t samp_rate, float low_pass)
+{
+    uint32_t sum = demod_AM_FM_chunked(lp_state, fm_state, iq_buf, 8, 1, am_buf, fm_buf, len, samp_rate, low_pass);
+    return len > 0 && sum >= len ? MAG_TO_DB((float)sum / len) : MAG_TO_DB(1);
+}
+
+void baseband_decimator_setup(decimator_state_t *state, unsigned factor)
+{
+    if (factor < 1)
+        factor = 1;
+    if (factor > DECIMATOR_MAX_FACTOR)
+        factor = DECIMATOR_MAX_FACTOR;
+    state->factor   = factor;
+    state->num_taps = factor * DECIMATOR_PHASE_TAPS;
+
+    // Hamming windowed sinc, cutoff at the output Nyquist frequency
+    unsigned n    = state->num_taps;
+    double fc     = 0.5 / factor;
+    double center = (n - 1) / 2.0;
+    int sum       = 0;
+    for (unsigned k = 0; k < n; ++k) {
+        double t = k - center;
+        double h = sin(2.0 * M_PI * fc * t) / (M_PI * t); // t is never 0 with an even number of taps
+        h *= 0.54 - 0.46 * cos(2.0 * M_PI * k / (n - 1));
+        state->coeffs[k] = (int16_t)lround(h * (1 << 15));
+        sum += state->coeffs[k];
+    }
+    // exact unity DC gain, spread the rounding error on the two center taps
+    int err = (1 << 15) - sum;
+    state->coeffs[n / 2 - 1] += err / 2;
+    state->coeffs[n / 2] += err - err / 2;
+
+    baseband_decimator_reset(state);
+}
+
+void baseband_decimator_reset(decimator_state_t *state)
+{
+    state->skip = 0;
+    memset(state->i_buf, 0, sizeof(state->i_buf));
+    memset(state->q_buf, 0, sizeof(state->q_buf));
+}
+
+static inline int16_t decimator_dot(int16_t const *coeffs, int16_t const *x, unsigned num_taps)
+{
+    int32_t acc = 1 << 14; // round
+    for (unsigned k = 0; k < num_taps; ++k)
+        acc += coeffs[k] * x[k];
+    acc >>= 15;
+    return acc > INT16_MAX ? INT16_MAX : acc < INT16_MIN ? INT16_MIN : (int16_t)acc;
+}
+
+/// Filter the chunk already placed after the history, the coefficients are symmetric so the window needs no reversal.
+static uint32_t decimator_run_chunk(decimator_state_t *state, int16_t *y_buf, uint32_t n)
+{
+    unsigned hist   = state->num_taps - 1;
+    unsigned factor = state->factor;
+    uint32_t n_out  = 0;
+
+    uint32_t pos = state->skip; // window start, the newest sample is at pos + hist
+    for (; pos < n; pos += factor) {
+        y_buf[n_out * 2]     = decimator_dot(state->coeffs, &state->i_buf[pos], state->num_taps);
+        y_buf[n_out * 2 + 1] = decimator_dot(state->coeffs, &state->q_buf[pos], state->num_taps);
+        n_out++;
+    }
+    state->skip = pos - n;
+
+    // keep the newest samples as history for the next chunk
+    memmove(state->i_buf, &state->i_buf[n], hist * sizeof(int16_t));
+    memmove(state->q_buf, &state->q_buf[n], hist * sizeof(int16_t));
+    return n_out;
+}
+
+uint32_t baseband_decimate_cu8(decimator_state_t *state, uint8_t const *iq_buf, int16_t *y_buf, uint32_t len)
+{
+    unsigned hist  = state->num_taps - 1;
+    uint32_t n_out = 0;
+
+    for (uint32_t pos = 0; pos < len; pos += DECIMATOR_CHUNK_LEN) {
+        uint32_t n = len - pos < DECIMATOR_CHUNK_LEN ? len - pos : DECIMATOR_CHUNK_LEN;
+        for (uint32_t i = 0; i < n; ++i) {
+            state->i_buf[hist + i] = (iq_buf[2 * (pos + i)] - 128) * 256; // scale Q0.7 to Q0.15
+            state->q_buf[hist + i] = (iq_buf[2 * (pos + i) + 1] - 128) * 256;
+        }
+        n_out += decimator_run_chunk(state, &y_buf[n_out * 2], n);
+    }
+    return n_out;
+}
+
+uint32_t baseband_decimate_cs16(decimator_state_t *state, int16_t const *iq_buf, int16_t *y_buf, uint32_t len)
+{
+    unsigned hist  = state->num_taps - 1;
+    uint32_t n_out = 0;
+
+    for (uint32_t pos = 0; pos < len; pos += DECIMATOR_CHUNK_LEN) {
+        uint32_t n = len - pos < DECIMATOR_CHUNK_LEN ? len - pos : DECIMATOR_CHUNK_LEN;
+        for (uint32_t i = 0; i < n; ++i) {
+            state->i_buf[hist + i] = iq_buf[2 * (pos + i)];
+            state->q_buf[hist + i] = iq_buf[2 * (pos + i) + 1];
+        }
+        n_out += decimator_run_chunk(state, &y_buf[n_out * 2], n);
+    }
+    return n_out;
+}
+
+uint32_t baseband_decimate_cf32(decimator_state_t *state, float const *iq_buf, int16_t *y_buf, uint32_t len)
+{
+    unsigned hist  = state->num_taps - 1;
+    uint32_t n_out = 0;
+
+    for (uint32_t pos = 0; pos < len; pos += DECIMATOR_CHUNK_LEN) {
+        uint32_t n = len - pos < DECIMATOR_CHUNK_LEN ? len - pos : DECIMATOR_CHUNK_LEN;
+        for (uint32_t i = 0; i < 2 * n; i += 2) {
+            // clamp float to [-1,1] and scale to Q0.15
+            float x = iq_buf[2 * pos + i] * INT16_MAX;
+            float y = iq_buf[2 * pos + i + 1] * INT16_MAX;
+            state->i_buf[hist + i / 2] = x < -INT16_MAX ? -INT16_MAX : x > INT16_MAX ? INT16_MAX : (int16_t)x;
+            state->q_buf[hist + i / 2] = y < -INT16_MAX ? -INT16_MAX : y > INT16_MAX ? INT16_MAX : (int16_t)y;
+        }
+        n_out += decimator_run_chunk(state, &y_buf[n_out * 2], n);
+    }
+    return n_out;
+}
+
 void baseband_init(void)
 {
     calc_squares();
+    baseband_simd_select(BASEBAND_SIMD_BEST);
 }
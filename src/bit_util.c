@@ -10,6 +10,7 @@
 */
 
 #include "bit_util.h"
+#include "compat_pthread.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -82,6 +83,120 @@ inline uint32_t keeloq_common_decrypt(const uint32_t data, const uint64_t key) {
     return block;
 }
 
+/// Transpose a 64x64 bit matrix, mirrored: bit b of row r moves to bit 63 - r of row 63 - b.
+static void transpose64(uint64_t a[64])
+{
+    uint64_t m = 0x00000000ffffffffULL;
+    for (unsigned j = 32; j != 0; j >>= 1, m ^= m << j) {
+        for (unsigned k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            uint64_t t = (a[k] ^ (a[k | j] >> j)) & m;
+            a[k] ^= t;
+            a[k | j] ^= t << j;
+        }
+    }
+}
+
+/// Run 64 Keeloq decryptions at once, block[j] and key[b] hold bit j and bit b of each lane.
+static void keeloq_decrypt_sliced(uint64_t block[32], uint64_t const key[64])
+{
+    for (unsigned r = 0; r < 528; ++r) {
+        // bit j of the block is at (j - r) & 31 as the block shifts left, the key rotates left
+        uint64_t x0  = block[(0 - r) & 31];
+        uint64_t x8  = block[(8 - r) & 31];
+        uint64_t x19 = block[(19 - r) & 31];
+        uint64_t x25 = block[(25 - r) & 31];
+        uint64_t x30 = block[(30 - r) & 31];
+        // algebraic normal form of the 0x3A5C742E lookup
+        uint64_t a   = x0 ^ x8 ^ (x0 & x8) ^ (x8 & x19) ^ (x0 & x25) ^ (x19 & x25);
+        uint64_t b   = x0 ^ x19 ^ (x0 & x8) ^ (x0 & x19) ^ (x8 & x25) ^ (x19 & x25);
+        uint64_t nlf = a ^ (x30 & b);
+        // the new lsb replaces bit 31
+        block[(31 - r) & 31] ^= block[(15 - r) & 31] ^ nlf ^ key[(15 - r) & 63];
+    }
+}
+
+/// Batches smaller than this are decrypted one at a time, a sliced batch costs less than two single decryptions.
+#define KEELOQ_MIN_SLICED 2
+
+void keeloq_common_decrypt_keys(uint32_t data, uint64_t const keys[], unsigned num_keys, uint32_t out[])
+{
+    for (unsigned base = 0; base < num_keys; base += 64) {
+        unsigned lanes = num_keys - base < 64 ? num_keys - base : 64;
+        if (lanes < KEELOQ_MIN_SLICED) {
+            for (unsigned l = 0; l < lanes; ++l) {
+                out[base + l] = keeloq_common_decrypt(data, keys[base + l]);
+            }
+            break;
+        }
+
+        uint64_t key[64] = {0};
+        for (unsigned l = 0; l < lanes; ++l) {
+            key[l] = keys[base + l];
+        }
+        transpose64(key);
+        // key bit b of lane l is now bit 63 - l of key[63 - b], reverse to index by bit
+        for (unsigned b = 0; b < 32; ++b) {
+            uint64_t t  = key[b];
+            key[b]      = key[63 - b];
+            key[63 - b] = t;
+        }
+
+        uint64_t block[32];
+        for (unsigned j = 0; j < 32; ++j) {
+            block[j] = (data >> j) & 1 ? ~(uint64_t)0 : 0;
+        }
+        keeloq_decrypt_sliced(block, key);
+
+        // after 528 rounds bit j is at (j - 16) & 31
+        uint64_t res[64] = {0};
+        for (unsigned j = 0; j < 32; ++j) {
+            res[63 - j] = block[(j - 16) & 31];
+        }
+        transpose64(res);
+        for (unsigned l = 0; l < lanes; ++l) {
+            out[base + l] = (uint32_t)res[l];
+        }
+    }
+}
+
+void keeloq_common_decrypt_blocks(uint32_t const data[], unsigned num_blocks, uint64_t key, uint32_t out[])
+{
+    uint64_t key_bits[64];
+    for (unsigned b = 0; b < 64; ++b) {
+        key_bits[b] = (key >> b) & 1 ? ~(uint64_t)0 : 0;
+    }
+
+    for (unsigned base = 0; base < num_blocks; base += 64) {
+        unsigned lanes = num_blocks - base < 64 ? num_blocks - base : 64;
+        if (lanes < KEELOQ_MIN_SLICED) {
+            for (unsigned l = 0; l < lanes; ++l) {
+                out[base + l] = keeloq_common_decrypt(data[base + l], key);
+            }
+            break;
+        }
+
+        uint64_t a[64] = {0};
+        for (unsigned l = 0; l < lanes; ++l) {
+            a[l] = data[base + l];
+        }
+        transpose64(a);
+        uint64_t block[32];
+        for (unsigned j = 0; j < 32; ++j) {
+            block[j] = a[63 - j];
+        }
+        keeloq_decrypt_sliced(block, key_bits);
+
+        uint64_t res[64] = {0};
+        for (unsigned j = 0; j < 32; ++j) {
+            res[63 - j] = block[(j - 16) & 31];
+        }
+        transpose64(res);
+        for (unsigned l = 0; l < lanes; ++l) {
+            out[base + l] = (uint32_t)res[l];
+        }
+    }
+}
+
 //modified from Flipper Zero Unleashed (I don't include btn in
 //in the serial)
 inline uint64_t normal(uint32_t data, const uint64_t key) {
@@ -213,213 +328,342 @@ unsigned extract_bits_symbols(uint8_t const *message, unsigned offset_bits, unsi
     return dst_len;
 }
 
-uint8_t crc4(uint8_t const message[], unsigned nBytes, uint8_t polynomial, uint8_t init)
+/* table driven CRC */
+
+/// CRC register variants, the register is 8 or 16 bits wide and narrower CRCs are left aligned.
+enum crc_kind {
+    CRC_MSB8,
+    CRC_LSB8,
+    CRC_MSB16,
+    CRC_LSB16,
+};
+
+/// Number of polynomials each thread keeps tables for.
+#define CRC_CACHE_SLOTS 16
+
+/// Lookup tables for one polynomial, table[k][b] is the register b (in the top byte) advanced by k+1 zero bytes.
+typedef struct crc_tables {
+    unsigned kind;
+    unsigned poly;
+    uint16_t table[4][256];
+} crc_tables_t;
+
+// decoders may run on several threads, each keeps its own tables
+static THREAD_LOCAL crc_tables_t crc_cache[CRC_CACHE_SLOTS];
+static THREAD_LOCAL unsigned crc_cache_used; ///< Slots with tables
+static THREAD_LOCAL unsigned crc_cache_last; ///< Slot of the last lookup
+static THREAD_LOCAL unsigned crc_cache_next; ///< Slot to replace next once all are used
+
+/// Advance the register by one zero byte with the first table.
+static unsigned crc_advance(crc_tables_t const *t, unsigned r)
 {
-    unsigned remainder = init << 4; // LSBs are unused
-    unsigned poly = polynomial << 4;
-    unsigned bit;
+    switch (t->kind) {
+    case CRC_MSB16:
+        return (r << 8 ^ t->table[0][r >> 8]) & 0xffff;
+    case CRC_LSB16:
+        return r >> 8 ^ t->table[0][r & 0xff];
+    default:
+        return t->table[0][r];
+    }
+}
 
-    while (nBytes--) {
-        remainder ^= *message++;
-        for (bit = 0; bit < 8; bit++) {
-            if (remainder & 0x80) {
-                remainder = (remainder << 1) ^ poly;
-            } else {
-                remainder = (remainder << 1);
+static void crc_build(crc_tables_t *t, unsigned kind, unsigned poly)
+{
+    t->kind = kind;
+    t->poly = poly;
+    for (unsigned b = 0; b < 256; ++b) {
+        unsigned r = kind == CRC_MSB16 ? b << 8 : b;
+        for (unsigned bit = 0; bit < 8; ++bit) {
+            switch (kind) {
+            case CRC_MSB8:
+                r = (r & 0x80 ? r << 1 ^ poly : r << 1) & 0xff;
+                break;
+            case CRC_MSB16:
+                r = (r & 0x8000 ? r << 1 ^ poly : r << 1) & 0xffff;
+                break;
+            default:
+                r = r & 1 ? r >> 1 ^ poly : r >> 1;
+                break;
             }
         }
+        t->table[0][b] = (uint16_t)r;
+    }
+    for (unsigned k = 1; k < 4; ++k) {
+        for (unsigned b = 0; b < 256; ++b) {
+            t->table[k][b] = (uint16_t)crc_advance(t, t->table[k - 1][b]);
+        }
     }
-    return remainder >> 4 & 0x0f; // discard the LSBs
 }
 
-uint8_t crc7(uint8_t const message[], unsigned nBytes, uint8_t polynomial, uint8_t init)
+/// The tables for a polynomial, built on first use.
+static crc_tables_t const *crc_tables(unsigned kind, unsigned poly)
 {
-    unsigned remainder = init << 1; // LSB is unused
-    unsigned poly = polynomial << 1;
-    unsigned byte, bit;
-
-    for (byte = 0; byte < nBytes; ++byte) {
-        remainder ^= message[byte];
-        for (bit = 0; bit < 8; ++bit) {
-            if (remainder & 0x80) {
-                remainder = (remainder << 1) ^ poly;
-            } else {
-                remainder = (remainder << 1);
-            }
+    crc_tables_t *t = &crc_cache[crc_cache_last];
+    if (crc_cache_used && t->kind == kind && t->poly == poly)
+        return t;
+
+    for (unsigned i = 0; i < crc_cache_used; ++i) {
+        if (crc_cache[i].kind == kind && crc_cache[i].poly == poly) {
+            crc_cache_last = i;
+            return &crc_cache[i];
         }
     }
-    return remainder >> 1 & 0x7f; // discard the LSB
+
+    unsigned slot;
+    if (crc_cache_used < CRC_CACHE_SLOTS) {
+        slot = crc_cache_used++;
+    }
+    else {
+        slot = crc_cache_next;
+        crc_cache_next = (crc_cache_next + 1) % CRC_CACHE_SLOTS;
+    }
+    crc_build(&crc_cache[slot], kind, poly);
+    crc_cache_last = slot;
+    return &crc_cache[slot];
 }
 
-uint8_t crc8(uint8_t const message[], unsigned nBytes, uint8_t polynomial, uint8_t init)
+/// Run the message through the register four bytes at a time (slicing-by-4), then byte by byte.
+static unsigned crc_update(crc_tables_t const *t, unsigned r, uint8_t const message[], unsigned nBytes)
 {
-    uint8_t remainder = init;
-    unsigned byte, bit;
+    uint16_t const *t0 = t->table[0];
+    uint16_t const *t1 = t->table[1];
+    uint16_t const *t2 = t->table[2];
+    uint16_t const *t3 = t->table[3];
+
+    switch (t->kind) {
+    case CRC_MSB16:
+        for (; nBytes >= 4; nBytes -= 4, message += 4) {
+            r ^= (unsigned)message[0] << 8 | message[1];
+            r = t3[r >> 8] ^ t2[r & 0xff] ^ t1[message[2]] ^ t0[message[3]];
+        }
+        break;
+    case CRC_LSB16:
+        for (; nBytes >= 4; nBytes -= 4, message += 4) {
+            r ^= message[0] | (unsigned)message[1] << 8;
+            r = t3[r & 0xff] ^ t2[r >> 8] ^ t1[message[2]] ^ t0[message[3]];
+        }
+        break;
+    default:
+        for (; nBytes >= 4; nBytes -= 4, message += 4) {
+            r = t3[r ^ message[0]] ^ t2[message[1]] ^ t1[message[2]] ^ t0[message[3]];
+        }
+        break;
+    }
 
-    for (byte = 0; byte < nBytes; ++byte) {
-        remainder ^= message[byte];
-        for (bit = 0; bit < 8; ++bit) {
-            if (remainder & 0x80) {
-                remainder = (remainder << 1) ^ polynomial;
-            } else {
-                remainder = (remainder << 1);
-            }
+    while (nBytes--) {
+        switch (t->kind) {
+        case CRC_MSB16:
+            r = (r << 8 ^ t0[(r >> 8) ^ *message++]) & 0xffff;
+            break;
+        case CRC_LSB16:
+            r = r >> 8 ^ t0[(r ^ *message++) & 0xff];
+            break;
+        default:
+            r = t0[r ^ *message++];
+            break;
         }
     }
-    return remainder;
+    return r;
 }
 
-uint8_t crc8le(uint8_t const message[], unsigned nBytes, uint8_t polynomial, uint8_t init)
+uint8_t crc4(uint8_t const message[], unsigned nBytes, uint8_t polynomial, uint8_t init)
 {
-    uint8_t remainder = reverse8(init);
-    unsigned byte, bit;
-    polynomial = reverse8(polynomial);
+    crc_tables_t const *t = crc_tables(CRC_MSB8, polynomial << 4 & 0xf0); // LSBs are unused
+    return crc_update(t, init << 4 & 0xf0, message, nBytes) >> 4; // discard the LSBs
+}
 
-    for (byte = 0; byte < nBytes; ++byte) {
-        remainder ^= message[byte];
-        for (bit = 0; bit < 8; ++bit) {
-            if (remainder & 1) {
-                remainder = (remainder >> 1) ^ polynomial;
-            } else {
-                remainder = (remainder >> 1);
-            }
-        }
-    }
-    return remainder;
+uint8_t crc7(uint8_t const message[], unsigned nBytes, uint8_t polynomial, uint8_t init)
+{
+    crc_tables_t const *t = crc_tables(CRC_MSB8, polynomial << 1 & 0xfe); // LSB is unused
+    return crc_update(t, init << 1 & 0xfe, message, nBytes) >> 1; // discard the LSB
 }
 
-uint16_t crc16lsb(uint8_t const message[], unsigned nBytes, uint16_t polynomial, uint16_t init)
+uint8_t crc8(uint8_t const message[], unsigned nBytes, uint8_t polynomial, uint8_t init)
 {
-    uint16_t remainder = init;
-    unsigned byte, bit;
+    crc_tables_t const *t = crc_tables(CRC_MSB8, polynomial);
+    return crc_update(t, init, message, nBytes);
+}
 
-    for (byte = 0; byte < nBytes; ++byte) {
-        remainder ^= message[byte];
-        for (bit = 0; bit < 8; ++bit) {
-            if (remainder & 1) {
-                remainder = (remainder >> 1) ^ polynomial;
-            }
-            else {
-                remainder = (remainder >> 1);
-            }
-        }
-    }
-    return remainder;
+uint8_t crc8le(uint8_t const message[], unsigned nBytes, uint8_t polynomial, uint8_t init)
+{
+    crc_tables_t const *t = crc_tables(CRC_LSB8, reverse8(polynomial));
+    return crc_update(t, reverse8(init), message, nBytes);
+}
+
+uint16_t crc16lsb(uint8_t const message[], unsigned nBytes, uint16_t polynomial, uint16_t init)
+{
+    crc_tables_t const *t = crc_tables(CRC_LSB16, polynomial);
+    return crc_update(t, init, message, nBytes);
 }
 
 uint16_t crc16(uint8_t const message[], unsigned nBytes, uint16_t polynomial, uint16_t init)
 {
-    uint16_t remainder = init;
-    unsigned byte, bit;
+    crc_tables_t const *t = crc_tables(CRC_MSB16, polynomial);
+    return crc_update(t, init, message, nBytes);
+}
+
+/* table driven LFSR digest */
+
+/// Key roll variants, right for the MSB first digests, left for the reflected digest.
+enum lfsr_kind {
+    LFSR_RIGHT8,
+    LFSR_LEFT8,
+    LFSR_RIGHT16,
+};
+
+/// Number of (generator, key) pairs each thread keeps tables for, well above the pairs the decoders use.
+#define LFSR_CACHE_SLOTS 64
+/// Message bytes covered by the tables, longer messages continue bit by bit.
+#define LFSR_CACHE_BYTES 32
+
+/// Digest of each message byte at each position, the digest of a byte is hi[data >> 4] ^ lo[data & 0xf].
+typedef struct lfsr_tables {
+    unsigned kind;
+    unsigned gen;
+    unsigned key;
+    unsigned built;    ///< Positions with tables
+    unsigned next_key; ///< Key at the first position without tables
+    uint16_t hi[LFSR_CACHE_BYTES][16];
+    uint16_t lo[LFSR_CACHE_BYTES][16];
+} lfsr_tables_t;
+
+static THREAD_LOCAL lfsr_tables_t lfsr_cache[LFSR_CACHE_SLOTS];
+static THREAD_LOCAL unsigned lfsr_cache_used; ///< Slots in use
+static THREAD_LOCAL unsigned lfsr_cache_last; ///< Slot of the last lookup
+static THREAD_LOCAL unsigned lfsr_cache_next; ///< Slot to replace next once all are used
+
+static unsigned lfsr_roll(unsigned kind, unsigned gen, unsigned key)
+{
+    if (kind == LFSR_LEFT8)
+        // roll the key left and apply the gen (needs to include the dropped msb as lsb)
+        return (key & 0x80 ? key << 1 ^ gen : key << 1) & 0xff;
+    // roll the key right and apply the gen (needs to include the dropped lsb as msb)
+    return key & 1 ? key >> 1 ^ gen : key >> 1;
+}
+
+/// Message bit used at step 0 to 7 of a byte, MSB to LSB except for the reflected digest.
+static inline unsigned lfsr_bit(unsigned kind, unsigned step)
+{
+    return kind == LFSR_LEFT8 ? step : 7 - step;
+}
 
-    for (byte = 0; byte < nBytes; ++byte) {
-        remainder ^= message[byte] << 8;
-        for (bit = 0; bit < 8; ++bit) {
-            if (remainder & 0x8000) {
-                remainder = (remainder << 1) ^ polynomial;
+/// Digest bytes bit by bit, returns the key after the last byte.
+static unsigned lfsr_digest_bits(unsigned kind, unsigned gen, unsigned key, unsigned data, unsigned *sum)
+{
+    for (unsigned step = 0; step < 8; ++step) {
+        // XOR key into sum if data bit is set
+        if ((data >> lfsr_bit(kind, step)) & 1)
+            *sum ^= key;
+        key = lfsr_roll(kind, gen, key);
+    }
+    return key;
+}
+
+/// The tables for a generator and key, built for at least the first bytes positions (up to LFSR_CACHE_BYTES).
+/// A pair seen for the first time only gets a slot without tables, a one-off key is digested bit by bit.
+static lfsr_tables_t const *lfsr_tables(unsigned kind, unsigned gen, unsigned key, unsigned bytes)
+{
+    lfsr_tables_t *t = &lfsr_cache[lfsr_cache_last];
+    if (!lfsr_cache_used || t->kind != kind || t->gen != gen || t->key != key) {
+        t = NULL;
+        for (unsigned i = 0; i < lfsr_cache_used; ++i) {
+            if (lfsr_cache[i].kind == kind && lfsr_cache[i].gen == gen && lfsr_cache[i].key == key) {
+                lfsr_cache_last = i;
+                t = &lfsr_cache[i];
+                break;
             }
-            else {
-                remainder = (remainder << 1);
+        }
+    }
+    if (!t) {
+        unsigned slot;
+        if (lfsr_cache_used < LFSR_CACHE_SLOTS) {
+            slot = lfsr_cache_used++;
+        }
+        else {
+            slot = lfsr_cache_next;
+            lfsr_cache_next = (lfsr_cache_next + 1) % LFSR_CACHE_SLOTS;
+        }
+        lfsr_cache_last = slot;
+        t = &lfsr_cache[slot];
+        t->kind     = kind;
+        t->gen      = gen;
+        t->key      = key;
+        t->built    = 0;
+        t->next_key = key;
+        return t;
+    }
+
+    if (bytes > LFSR_CACHE_BYTES)
+        bytes = LFSR_CACHE_BYTES;
+    for (; t->built < bytes; t->built++) {
+        unsigned keys[8];
+        unsigned k = t->next_key;
+        for (unsigned step = 0; step < 8; ++step) {
+            keys[7 - lfsr_bit(kind, step)] = k; // by bit from the MSB
+            k = lfsr_roll(kind, gen, k);
+        }
+        t->next_key = k;
+
+        // each nibble bit doubles the entries, adding its key to the ones without it
+        uint16_t *hi = t->hi[t->built];
+        uint16_t *lo = t->lo[t->built];
+        hi[0] = 0;
+        lo[0] = 0;
+        for (unsigned i = 0; i < 4; ++i) {
+            unsigned b = 1u << i;
+            for (unsigned n = 0; n < b; ++n) {
+                hi[b | n] = hi[n] ^ keys[3 - i];
+                lo[b | n] = lo[n] ^ keys[7 - i];
             }
         }
     }
-    return remainder;
+    return t;
 }
 
-uint8_t lfsr_digest8(uint8_t const message[], unsigned bytes, uint8_t gen, uint8_t key)
+/// Digest the message bytes in order, or from last to first if reverse is set.
+static unsigned lfsr_digest(unsigned kind, uint8_t const message[], unsigned bytes, int reverse, unsigned gen, unsigned key)
 {
-    uint8_t sum = 0;
-    // Process message from first byte to last byte
-    for (unsigned k = 0; k < bytes; ++k) {
-        uint8_t data = message[k];
-        // Process individual bits of each byte (MSB to LSB)
-        for (int i = 7; i >= 0; --i) {
-            // fprintf(stderr, "key at %d.%d : %02x\n", k, i, key);
-            // XOR key into sum if data bit is set
-            if ((data >> i) & 1)
-                sum ^= key;
-
-            // roll the key right (actually the lsb is dropped here)
-            // and apply the gen (needs to include the dropped lsb as msb)
-            if (key & 1)
-                key = (key >> 1) ^ gen;
-            else
-                key = (key >> 1);
-        }
+    lfsr_tables_t const *t = lfsr_tables(kind, gen, key, bytes);
+    unsigned sum = 0;
+    unsigned pos = 0;
+    for (; pos < bytes && pos < t->built; ++pos) {
+        uint8_t data = reverse ? message[bytes - 1 - pos] : message[pos];
+        sum ^= t->hi[pos][data >> 4] ^ t->lo[pos][data & 0xf];
+    }
+    // continue bit by bit past the tables
+    key = t->next_key;
+    for (; pos < bytes; ++pos) {
+        uint8_t data = reverse ? message[bytes - 1 - pos] : message[pos];
+        key = lfsr_digest_bits(kind, gen, key, data, &sum);
     }
     return sum;
 }
 
-uint8_t lfsr_digest8_reverse(uint8_t const *message, int bytes, uint8_t gen, uint8_t key)
+uint8_t lfsr_digest8(uint8_t const message[], unsigned bytes, uint8_t gen, uint8_t key)
 {
-    uint8_t sum = 0;
-    // Process message from last byte to first byte (reflected)
-    for (int k = bytes - 1; k >= 0; --k) {
-        uint8_t data = message[k];
-        // Process individual bits of each byte (MSB to LSB)
-        for (int i = 7; i >= 0; --i) {
-            // fprintf(stderr, "key at %d.%d : %02x\n", k, i, key);
-            // XOR key into sum if data bit is set
-            if ((data >> i) & 1) {
-                sum ^= key;
-            }
+    // Process message from first byte to last byte, bits MSB to LSB
+    return lfsr_digest(LFSR_RIGHT8, message, bytes, 0, gen, key);
+}
 
-            // roll the key right (actually the lsb is dropped here)
-            // and apply the gen (needs to include the dropped lsb as msb)
-            if (key & 1)
-                key = (key >> 1) ^ gen;
-            else
-                key = (key >> 1);
-        }
-    }
-    return sum;
+uint8_t lfsr_digest8_reverse(uint8_t const *message, int bytes, uint8_t gen, uint8_t key)
+{
+    if (bytes <= 0)
+        return 0;
+    // Process message from last byte to first byte (reflected), bits MSB to LSB
+    return lfsr_digest(LFSR_RIGHT8, message, bytes, 1, gen, key);
 }
 
 uint8_t lfsr_digest8_reflect(uint8_t const message[], int bytes, uint8_t gen, uint8_t key)
 {
-    uint8_t sum = 0;
-    // Process message from last byte to first byte (reflected)
-    for (int k = bytes - 1; k >= 0; --k) {
-        uint8_t data = message[k];
-        // Process individual bits of each byte (reflected)
-        for (int i = 0; i < 8; ++i) {
-            // fprintf(stderr, "key at %d.%d : %02x\n", k, i, key);
-            // XOR key into sum if data bit is set
-            if ((data >> i) & 1) {
-                sum ^= key;
-            }
-
-            // roll the key left (actually the msb is dropped here)
-            // and apply the gen (needs to include the dropped msb as lsb)
-            if (key & 0x80)
-                key = (key << 1) ^ gen;
-            else
-                key = (key << 1);
-        }
-    }
-    return sum;
+    if (bytes <= 0)
+        return 0;
+    // Process message from last byte to first byte (reflected), bits LSB to MSB
+    return lfsr_digest(LFSR_LEFT8, message, bytes, 1, gen, key);
 }
 
 uint16_t lfsr_digest16(uint8_t const message[], unsigned bytes, uint16_t gen, uint16_t key)
 {
-    uint16_t sum = 0;
-    for (unsigned k = 0; k < bytes; ++k) {
-        uint8_t data = message[k];
-        for (int i = 7; i >= 0; --i) {
-            // fprintf(stderr, "key at bit %d : %04x\n", i, key);
-            // if data bit is set then xor with key
-            if ((data >> i) & 1)
-                sum ^= key;
-
-            // roll the key right (actually the lsb is dropped here)
-            // and apply the gen (needs to include the dropped lsb as msb)
-            if (key & 1)
-                key = (key >> 1) ^ gen;
-            else
-                key = (key >> 1);
-        }
-    }
-    return sum;
+    return lfsr_digest(LFSR_RIGHT16, message, bytes, 0, gen, key);
 }
 
 // The CCITT data whitening process is built around a 9-bit Linear Feedback Shift Register (LFSR).
@@ -573,6 +817,54 @@ int add_nibbles(uint8_t const message[], unsigned num_bytes)
         } \
     } while (0)
 
+/// Bit by bit MSB first CRC with a register of 8 or 16 bits, the reference for the table driven CRCs.
+static unsigned crc_bitwise_msb(uint8_t const message[], unsigned nBytes, unsigned width, unsigned polynomial, unsigned init)
+{
+    unsigned top  = 1u << (width - 1);
+    unsigned mask = (top << 1) - 1;
+    unsigned remainder = init;
+
+    for (unsigned byte = 0; byte < nBytes; ++byte) {
+        remainder ^= message[byte] << (width - 8);
+        for (unsigned bit = 0; bit < 8; ++bit) {
+            remainder = (remainder & top ? remainder << 1 ^ polynomial : remainder << 1) & mask;
+        }
+    }
+    return remainder;
+}
+
+/// Bit by bit LSB first CRC, the reference for the table driven CRCs.
+static unsigned crc_bitwise_lsb(uint8_t const message[], unsigned nBytes, unsigned polynomial, unsigned init)
+{
+    unsigned remainder = init;
+
+    for (unsigned byte = 0; byte < nBytes; ++byte) {
+        remainder ^= message[byte];
+        for (unsigned bit = 0; bit < 8; ++bit) {
+            remainder = remainder & 1 ? remainder >> 1 ^ polynomial : remainder >> 1;
+        }
+    }
+    return remainder;
+}
+
+/// Bit by bit LFSR digest, the reference for the table driven digests.
+static unsigned lfsr_bitwise(uint8_t const message[], unsigned bytes, int reverse, int reflect, unsigned gen, unsigned key, unsigned mask)
+{
+    unsigned sum = 0;
+    for (unsigned k = 0; k < bytes; ++k) {
+        uint8_t data = reverse ? message[bytes - 1 - k] : message[k];
+        for (int i = 0; i < 8; ++i) {
+            if ((data >> (reflect ? i : 7 - i)) & 1)
+                sum ^= key;
+            if (reflect)
+                key = (key & 0x80 ? key << 1 ^ gen : key << 1) & mask;
+            else
+                key = key & 1 ? key >> 1 ^ gen : key >> 1;
+        }
+    }
+    return sum;
+}
+
 int main(void) {
     unsigned passed = 0;
     unsigned failed = 0;
@@ -618,6 +910,78 @@ int main(void) {
     ibm_whitening(buf2, sizeof(buf2)) ;
     ASSERT_MATCH(buf2, chk2, sizeof(buf2));
 
+    fprintf(stderr, "util::crc*(): against bitwise CRCs\n");
+    unsigned crc_mismatch = 0;
+    uint8_t rnd[40];
+    srand(1);
+    for (unsigned i = 0; i < 4000; ++i) {
+        // more polynomials than the tables are cached for
+        uint16_t poly = rand() & 0xffff;
+        uint16_t init = rand() & 0xffff;
+        unsigned len  = rand() % sizeof(rnd);
+        for (unsigned j = 0; j < len; ++j) {
+            rnd[j] = rand() & 0xff;
+        }
+        crc_mismatch += crc4(rnd, len, poly & 0xff, init & 0xff) != crc_bitwise_msb(rnd, len, 8, poly << 4 & 0xf0, init << 4 & 0xf0) >> 4;
+        crc_mismatch += crc7(rnd, len, poly & 0xff, init & 0xff) != crc_bitwise_msb(rnd, len, 8, poly << 1 & 0xfe, init << 1 & 0xfe) >> 1;
+        crc_mismatch += crc8(rnd, len, poly & 0xff, init & 0xff) != crc_bitwise_msb(rnd, len, 8, poly & 0xff, init & 0xff);
+        crc_mismatch += crc8le(rnd, len, poly & 0xff, init & 0xff) != crc_bitwise_lsb(rnd, len, reverse8(poly & 0xff), reverse8(init & 0xff));
+        crc_mismatch += crc16lsb(rnd, len, poly, init) != crc_bitwise_lsb(rnd, len, poly, init);
+        crc_mismatch += crc16(rnd, len, poly, init) != crc_bitwise_msb(rnd, len, 16, poly, init);
+    }
+    ASSERT_EQUALS(crc_mismatch, 0);
+
+    fprintf(stderr, "util::crc16(): CRC-16/CCITT-FALSE check value\n");
+    uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    ASSERT_EQUALS(crc16(check, sizeof(check), 0x1021, 0xffff), 0x29b1);
+    fprintf(stderr, "util::crc16lsb(): CRC-16/KERMIT check value\n");
+    ASSERT_EQUALS(crc16lsb(check, sizeof(check), 0x8408, 0x0000), 0x2189);
+    fprintf(stderr, "util::crc8(): CRC-8/SMBUS check value\n");
+    ASSERT_EQUALS(crc8(check, sizeof(check), 0x07, 0x00), 0xf4);
+
+    fprintf(stderr, "util::lfsr_digest*(): against bitwise digests\n");
+    unsigned lfsr_mismatch = 0;
+    uint8_t rnd_long[80];
+    for (unsigned i = 0; i < 4000; ++i) {
+        // some messages are longer than the tables
+        uint16_t gen  = i % 2 ? 0x98 : rand() & 0xffff;
+        uint16_t key  = i % 2 ? 0x3e : rand() & 0xffff;
+        unsigned len  = rand() % sizeof(rnd_long);
+        for (unsigned j = 0; j < len; ++j) {
+            rnd_long[j] = rand() & 0xff;
+        }
+        lfsr_mismatch += lfsr_digest8(rnd_long, len, gen & 0xff, key & 0xff) != lfsr_bitwise(rnd_long, len, 0, 0, gen & 0xff, key & 0xff, 0xff);
+        lfsr_mismatch += lfsr_digest8_reverse(rnd_long, len, gen & 0xff, key & 0xff) != lfsr_bitwise(rnd_long, len, 1, 0, gen & 0xff, key & 0xff, 0xff);
+        lfsr_mismatch += lfsr_digest8_reflect(rnd_long, len, gen & 0xff, key & 0xff) != lfsr_bitwise(rnd_long, len, 1, 1, gen & 0xff, key & 0xff, 0xff);
+        lfsr_mismatch += lfsr_digest16(rnd_long, len, gen, key) != lfsr_bitwise(rnd_long, len, 0, 0, gen, key, 0xffff);
+    }
+    ASSERT_EQUALS(lfsr_mismatch, 0);
+
+    fprintf(stderr, "util::keeloq_common_decrypt_keys(): against single decryptions\n");
+    uint64_t kl_keys[150];
+    uint32_t kl_data[150];
+    uint32_t kl_out[150];
+    unsigned kl_mismatch = 0;
+    for (unsigned i = 0; i < 150; ++i) {
+        kl_keys[i] = (uint64_t)rand() << 40 ^ (uint64_t)rand() << 20 ^ rand();
+        kl_data[i] = (uint32_t)rand() << 16 ^ rand();
+    }
+    // two full batches and a partial batch
+    keeloq_common_decrypt_keys(kl_data[0], kl_keys, 150, kl_out);
+    for (unsigned i = 0; i < 150; ++i) {
+        kl_mismatch += kl_out[i] != keeloq_common_decrypt(kl_data[0], kl_keys[i]);
+    }
+    ASSERT_EQUALS(kl_mismatch, 0);
+
+    fprintf(stderr, "util::keeloq_common_decrypt_blocks(): against single decryptions\n");
+    kl_mismatch = 0;
+    // two full batches and a single decryption
+    keeloq_common_decrypt_blocks(kl_data, 129, kl_keys[0], kl_out);
+    for (unsigned i = 0; i < 129; ++i) {
+        kl_mismatch += kl_out[i] != keeloq_common_decrypt(kl_data[i], kl_keys[0]);
+    }
+    ASSERT_EQUALS(kl_mismatch, 0);
+
     // ------------- add test above this line -----------------------------------------------------
     // Show result of the tests, this line must stay the last line before return failed;
     fprintf(stderr, "util:: test (%u/%u) passed, (%u) failed.\n", passed, passed + failed, failed);
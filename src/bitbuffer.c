@@ -14,9 +14,78 @@
 #include <stdlib.h>
 #include <string.h>
 
+/// Rows and bytes per row that may hold set bits, the written extent and the bits of each row.
+static void bitbuffer_extent(bitbuffer_t const *bits, unsigned *rows, unsigned *cols)
+{
+    unsigned r = bits->dirty_rows;
+    unsigned c = bits->dirty_cols;
+    for (unsigned row = 0; row < bits->num_rows && row < BITBUF_ROWS; ++row) {
+        unsigned bytes = (bits->bits_per_row[row] + 7) / 8;
+        if (!bytes)
+            continue;
+        unsigned end = row + (bytes + BITBUF_COLS - 1) / BITBUF_COLS; // long rows spill into the next rows
+        if (end > r)
+            r = end;
+        if (bytes > c)
+            c = bytes;
+    }
+    *rows = r < BITBUF_ROWS ? r : BITBUF_ROWS;
+    *cols = c < BITBUF_COLS ? c : BITBUF_COLS;
+}
+
+/// Note that a byte was written, col may reach into the next rows.
+static inline void bitbuffer_mark_dirty(bitbuffer_t *bits, unsigned row, unsigned col)
+{
+    row += col / BITBUF_COLS;
+    col = col < BITBUF_COLS ? col + 1 : BITBUF_COLS;
+    if (row >= bits->dirty_rows)
+        bits->dirty_rows = row + 1;
+    if (col > bits->dirty_cols)
+        bits->dirty_cols = col;
+}
+
 void bitbuffer_clear(bitbuffer_t *bits)
 {
-    memset(bits, 0, sizeof(*bits));
+    unsigned rows;
+    unsigned cols;
+    bitbuffer_extent(bits, &rows, &cols);
+    if (cols == BITBUF_COLS) {
+        memset(bits->bb, 0, rows * BITBUF_COLS);
+    }
+    else {
+        for (unsigned row = 0; row < rows; ++row) {
+            memset(bits->bb[row], 0, cols);
+        }
+    }
+    bits->num_rows   = 0;
+    bits->free_row   = 0;
+    bits->dirty_rows = 0;
+    bits->dirty_cols = 0;
+    memset(bits->bits_per_row, 0, sizeof(bits->bits_per_row));
+    memset(bits->syncs_before_row, 0, sizeof(bits->syncs_before_row));
+}
+
+void bitbuffer_copy(bitbuffer_t *dst, bitbuffer_t const *src)
+{
+    bitbuffer_clear(dst);
+
+    unsigned rows;
+    unsigned cols;
+    bitbuffer_extent(src, &rows, &cols);
+    if (cols == BITBUF_COLS) {
+        memcpy(dst->bb, src->bb, rows * BITBUF_COLS);
+    }
+    else {
+        for (unsigned row = 0; row < rows; ++row) {
+            memcpy(dst->bb[row], src->bb[row], cols);
+        }
+    }
+    dst->num_rows   = src->num_rows;
+    dst->free_row   = src->free_row;
+    dst->dirty_rows = (uint16_t)rows;
+    dst->dirty_cols = (uint16_t)cols;
+    memcpy(dst->bits_per_row, src->bits_per_row, sizeof(dst->bits_per_row));
+    memcpy(dst->syncs_before_row, src->syncs_before_row, sizeof(dst->syncs_before_row));
 }
 
 void bitbuffer_add_bit(bitbuffer_t *bits, int bit)
@@ -52,7 +121,14 @@ void bitbuffer_add_bit(bitbuffer_t *bits, int bit)
         }
     }
     uint8_t *b = bits->bb[bits->num_rows - 1];
-    b[col_index] |= (bit << (7 - bit_index));
+    if (bit_index == 0) {
+        // first bit of a byte, set the whole byte in case it is not cleared
+        b[col_index] = (uint8_t)(bit << 7);
+        bitbuffer_mark_dirty(bits, bits->num_rows - 1, col_index);
+    }
+    else {
+        b[col_index] |= (bit << (7 - bit_index));
+    }
     bits->bits_per_row[bits->num_rows - 1]++;
 
 /*
@@ -101,6 +177,96 @@ static void bitbuffer_set_width(bitbuffer_t *bits, uint16_t width)
     bits->free_row = bits->num_rows + extra_rows;
 }
 
+/// Bits that can be appended to the last row at once, 0 if bitbuffer_add_bit() needs to handle a spill or the length limit.
+static unsigned bitbuffer_room(bitbuffer_t *bits)
+{
+    if (bits->num_rows == 0)
+        bits->free_row = bits->num_rows = 1; // Add first row automatically
+
+    unsigned len   = bits->bits_per_row[bits->num_rows - 1];
+    unsigned spill = len % (BITBUF_COLS * 8);
+    if (len >= UINT16_MAX - 1 || (len > 0 && spill == 0))
+        return 0;
+
+    unsigned room  = BITBUF_COLS * 8 - spill;
+    unsigned limit = UINT16_MAX - 1 - len;
+    return room < limit ? room : limit;
+}
+
+void bitbuffer_add_bits(bitbuffer_t *bits, int value, unsigned count)
+{
+    uint8_t const fill = value ? 0xff : 0x00;
+
+    while (count > 0) {
+        unsigned room = bitbuffer_room(bits);
+        if (!room) {
+            unsigned len = bits->bits_per_row[bits->num_rows - 1];
+            bitbuffer_add_bit(bits, value);
+            if (bits->bits_per_row[bits->num_rows - 1] == len)
+                return; // no more room
+            count--;
+            continue;
+        }
+
+        unsigned n     = count < room ? count : room;
+        unsigned row   = bits->num_rows - 1;
+        unsigned len   = bits->bits_per_row[row];
+        unsigned end   = len + n;
+        unsigned col   = len / 8;
+        unsigned shift = len % 8;
+        uint8_t *b     = bits->bb[row];
+        if (shift) {
+            // fill up the current byte
+            unsigned k = n < 8 - shift ? n : 8 - shift;
+            b[col] |= fill & (0xff >> shift) & (0xff << (8 - shift - k));
+            col++;
+        }
+        unsigned last = (end + 7) / 8;
+        if (col < last) {
+            // set whole bytes in case they are not cleared
+            memset(&b[col], fill, last - col);
+            if (end % 8)
+                b[last - 1] &= 0xff << (8 - end % 8);
+            bitbuffer_mark_dirty(bits, row, last - 1);
+        }
+        bits->bits_per_row[row] = (uint16_t)end;
+        count -= n;
+    }
+}
+
+void bitbuffer_add_word(bitbuffer_t *bits, uint32_t word, unsigned nbits)
+{
+    if (nbits == 0)
+        return;
+    if (nbits > 32)
+        nbits = 32;
+
+    unsigned room = bitbuffer_room(bits);
+    if (room < nbits) {
+        for (unsigned i = nbits; i > 0; --i) {
+            bitbuffer_add_bit(bits, (word >> (i - 1)) & 1);
+        }
+        return;
+    }
+
+    unsigned row   = bits->num_rows - 1;
+    unsigned len   = bits->bits_per_row[row];
+    unsigned shift = len % 8;
+    uint8_t *b     = bits->bb[row] + len / 8; // long rows spill into the next rows
+    // align the word to the first free bit, this also drops the bits above nbits
+    uint64_t v     = ((uint64_t)word << (64 - nbits)) >> shift;
+    unsigned bytes = (shift + nbits + 7) / 8;
+    if (shift)
+        b[0] |= (uint8_t)(v >> 56);
+    else
+        b[0] = (uint8_t)(v >> 56);
+    for (unsigned i = 1; i < bytes; ++i) {
+        b[i] = (uint8_t)(v >> (56 - 8 * i));
+    }
+    bitbuffer_mark_dirty(bits, row, len / 8 + bytes - 1);
+    bits->bits_per_row[row] = (uint16_t)(len + nbits);
+}
+
 void bitbuffer_add_row(bitbuffer_t *bits)
 {
     if (bits->num_rows == 0)
@@ -219,25 +385,55 @@ static inline uint8_t bit_at(const uint8_t *bytes, unsigned bit)
     return (uint8_t)(bytes[bit >> 3] >> (7 - (bit & 7)) & 1);
 }
 
-unsigned bitbuffer_search(bitbuffer_t *bitbuffer, unsigned row, unsigned start,
-        const uint8_t *pattern, unsigned pattern_bits_len)
+/// Bits of a pattern compared word-wise, a window of 64 bits covers them at eight bit offsets.
+#define PATTERN_HEAD_BITS 56
+
+void bitbuffer_pattern_compile(bitbuffer_pattern_t *compiled, const uint8_t *pattern, unsigned pattern_bits_len)
 {
-    uint8_t *bits = bitbuffer->bb[row];
-    unsigned len  = bitbuffer->bits_per_row[row];
-    unsigned ipos = start;
-    unsigned ppos = 0; // cursor on init pattern
+    unsigned head_bits = pattern_bits_len < PATTERN_HEAD_BITS ? pattern_bits_len : PATTERN_HEAD_BITS;
+    uint64_t head      = 0;
+    for (unsigned i = 0; i < (head_bits + 7) / 8; ++i) {
+        head |= (uint64_t)pattern[i] << (56 - 8 * i);
+    }
+    compiled->head_mask = head_bits ? ~(uint64_t)0 << (64 - head_bits) : 0;
+    compiled->head      = head & compiled->head_mask;
+    compiled->bits      = pattern;
+    compiled->len       = pattern_bits_len;
+}
 
-    while (ipos < len && ppos < pattern_bits_len) {
-        if (bit_at(bits, ipos) == bit_at(pattern, ppos)) {
-            ppos++;
-            ipos++;
-            if (ppos == pattern_bits_len)
-                return ipos - pattern_bits_len;
-        }
-        else {
-            ipos -= ppos;
-            ipos++;
-            ppos = 0;
+unsigned bitbuffer_search_compiled(bitbuffer_t *bitbuffer, unsigned row, unsigned start,
+        bitbuffer_pattern_t const *pattern)
+{
+    uint8_t const *bits = bitbuffer->bb[row];
+    unsigned len        = bitbuffer->bits_per_row[row];
+    unsigned plen       = pattern->len;
+
+    if (!plen || start >= len || len - start < plen)
+        return len; // Not found
+
+    unsigned last   = len - plen; // last position a match can start at
+    unsigned nbytes = (len + 7) / 8;
+    unsigned col    = start / 8;
+    unsigned shift  = start % 8;
+
+    // window holds the 64 bits starting at byte col, bytes past the row read as zero
+    uint64_t window = 0;
+    for (unsigned i = 0; i < 7; ++i) {
+        window = (window << 8) | (col + i < nbytes ? bits[col + i] : 0);
+    }
+    for (; col * 8 <= last; ++col, shift = 0) {
+        window = (window << 8) | (col + 7 < nbytes ? bits[col + 7] : 0);
+
+        unsigned end = last - col * 8 < 7 ? last - col * 8 : 7;
+        for (; shift <= end; ++shift) {
+            if (((window << shift) & pattern->head_mask) != pattern->head)
+                continue;
+            unsigned pos = col * 8 + shift;
+            unsigned ppos = PATTERN_HEAD_BITS;
+            while (ppos < plen && bit_at(bits, pos + ppos) == bit_at(pattern->bits, ppos))
+                ppos++;
+            if (ppos >= plen)
+                return pos;
         }
     }
 
@@ -245,6 +441,75 @@ unsigned bitbuffer_search(bitbuffer_t *bitbuffer, unsigned row, unsigned start,
     return len;
 }
 
+unsigned bitbuffer_search(bitbuffer_t *bitbuffer, unsigned row, unsigned start,
+        const uint8_t *pattern, unsigned pattern_bits_len)
+{
+    bitbuffer_pattern_t compiled;
+    bitbuffer_pattern_compile(&compiled, pattern, pattern_bits_len);
+    return bitbuffer_search_compiled(bitbuffer, row, start, &compiled);
+}
+
+/// Manchester decoded bits of a byte in the low nibble, pairs without a transition in the high nibble.
+static uint8_t const manchester_lut[256] = {
+        0xf0, 0xe1, 0xe0, 0xf1, 0xd2, 0xc3, 0xc2, 0xd3, 0xd0, 0xc1, 0xc0, 0xd1, 0xf2, 0xe3, 0xe2, 0xf3,
+        0xb4, 0xa5, 0xa4, 0xb5, 0x96, 0x87, 0x86, 0x97, 0x94, 0x85, 0x84, 0x95, 0xb6, 0xa7, 0xa6, 0xb7,
+        0xb0, 0xa1, 0xa0, 0xb1, 0x92, 0x83, 0x82, 0x93, 0x90, 0x81, 0x80, 0x91, 0xb2, 0xa3, 0xa2, 0xb3,
+        0xf4, 0xe5, 0xe4, 0xf5, 0xd6, 0xc7, 0xc6, 0xd7, 0xd4, 0xc5, 0xc4, 0xd5, 0xf6, 0xe7, 0xe6, 0xf7,
+        0x78, 0x69, 0x68, 0x79, 0x5a, 0x4b, 0x4a, 0x5b, 0x58, 0x49, 0x48, 0x59, 0x7a, 0x6b, 0x6a, 0x7b,
+        0x3c, 0x2d, 0x2c, 0x3d, 0x1e, 0x0f, 0x0e, 0x1f, 0x1c, 0x0d, 0x0c, 0x1d, 0x3e, 0x2f, 0x2e, 0x3f,
+        0x38, 0x29, 0x28, 0x39, 0x1a, 0x0b, 0x0a, 0x1b, 0x18, 0x09, 0x08, 0x19, 0x3a, 0x2b, 0x2a, 0x3b,
+        0x7c, 0x6d, 0x6c, 0x7d, 0x5e, 0x4f, 0x4e, 0x5f, 0x5c, 0x4d, 0x4c, 0x5d, 0x7e, 0x6f, 0x6e, 0x7f,
+        0x70, 0x61, 0x60, 0x71, 0x52, 0x43, 0x42, 0x53, 0x50, 0x41, 0x40, 0x51, 0x72, 0x63, 0x62, 0x73,
+        0x34, 0x25, 0x24, 0x35, 0x16, 0x07, 0x06, 0x17, 0x14, 0x05, 0x04, 0x15, 0x36, 0x27, 0x26, 0x37,
+        0x30, 0x21, 0x20, 0x31, 0x12, 0x03, 0x02, 0x13, 0x10, 0x01, 0x00, 0x11, 0x32, 0x23, 0x22, 0x33,
+        0x74, 0x65, 0x64, 0x75, 0x56, 0x47, 0x46, 0x57, 0x54, 0x45, 0x44, 0x55, 0x76, 0x67, 0x66, 0x77,
+        0xf8, 0xe9, 0xe8, 0xf9, 0xda, 0xcb, 0xca, 0xdb, 0xd8, 0xc9, 0xc8, 0xd9, 0xfa, 0xeb, 0xea, 0xfb,
+        0xbc, 0xad, 0xac, 0xbd, 0x9e, 0x8f, 0x8e, 0x9f, 0x9c, 0x8d, 0x8c, 0x9d, 0xbe, 0xaf, 0xae, 0xbf,
+        0xb8, 0xa9, 0xa8, 0xb9, 0x9a, 0x8b, 0x8a, 0x9b, 0x98, 0x89, 0x88, 0x99, 0xba, 0xab, 0xaa, 0xbb,
+        0xfc, 0xed, 0xec, 0xfd, 0xde, 0xcf, 0xce, 0xdf, 0xdc, 0xcd, 0xcc, 0xdd, 0xfe, 0xef, 0xee, 0xff,
+};
+
+/// Differential Manchester decoded bits of a byte in the low nibble, missing clock transitions
+/// before the last three pairs in the high nibble.
+static uint8_t const dmc_lut[256] = {
+        0x7f, 0x7e, 0x6e, 0x6f, 0x6d, 0x6c, 0x7c, 0x7d, 0x5d, 0x5c, 0x4c, 0x4d, 0x4f, 0x4e, 0x5e, 0x5f,
+        0x5b, 0x5a, 0x4a, 0x4b, 0x49, 0x48, 0x58, 0x59, 0x79, 0x78, 0x68, 0x69, 0x6b, 0x6a, 0x7a, 0x7b,
+        0x3b, 0x3a, 0x2a, 0x2b, 0x29, 0x28, 0x38, 0x39, 0x19, 0x18, 0x08, 0x09, 0x0b, 0x0a, 0x1a, 0x1b,
+        0x1f, 0x1e, 0x0e, 0x0f, 0x0d, 0x0c, 0x1c, 0x1d, 0x3d, 0x3c, 0x2c, 0x2d, 0x2f, 0x2e, 0x3e, 0x3f,
+        0x37, 0x36, 0x26, 0x27, 0x25, 0x24, 0x34, 0x35, 0x15, 0x14, 0x04, 0x05, 0x07, 0x06, 0x16, 0x17,
+        0x13, 0x12, 0x02, 0x03, 0x01, 0x00, 0x10, 0x11, 0x31, 0x30, 0x20, 0x21, 0x23, 0x22, 0x32, 0x33,
+        0x73, 0x72, 0x62, 0x63, 0x61, 0x60, 0x70, 0x71, 0x51, 0x50, 0x40, 0x41, 0x43, 0x42, 0x52, 0x53,
+        0x57, 0x56, 0x46, 0x47, 0x45, 0x44, 0x54, 0x55, 0x75, 0x74, 0x64, 0x65, 0x67, 0x66, 0x76, 0x77,
+        0x77, 0x76, 0x66, 0x67, 0x65, 0x64, 0x74, 0x75, 0x55, 0x54, 0x44, 0x45, 0x47, 0x46, 0x56, 0x57,
+        0x53, 0x52, 0x42, 0x43, 0x41, 0x40, 0x50, 0x51, 0x71, 0x70, 0x60, 0x61, 0x63, 0x62, 0x72, 0x73,
+        0x33, 0x32, 0x22, 0x23, 0x21, 0x20, 0x30, 0x31, 0x11, 0x10, 0x00, 0x01, 0x03, 0x02, 0x12, 0x13,
+        0x17, 0x16, 0x06, 0x07, 0x05, 0x04, 0x14, 0x15, 0x35, 0x34, 0x24, 0x25, 0x27, 0x26, 0x36, 0x37,
+        0x3f, 0x3e, 0x2e, 0x2f, 0x2d, 0x2c, 0x3c, 0x3d, 0x1d, 0x1c, 0x0c, 0x0d, 0x0f, 0x0e, 0x1e, 0x1f,
+        0x1b, 0x1a, 0x0a, 0x0b, 0x09, 0x08, 0x18, 0x19, 0x39, 0x38, 0x28, 0x29, 0x2b, 0x2a, 0x3a, 0x3b,
+        0x7b, 0x7a, 0x6a, 0x6b, 0x69, 0x68, 0x78, 0x79, 0x59, 0x58, 0x48, 0x49, 0x4b, 0x4a, 0x5a, 0x5b,
+        0x5f, 0x5e, 0x4e, 0x4f, 0x4d, 0x4c, 0x5c, 0x5d, 0x7d, 0x7c, 0x6c, 0x6d, 0x6f, 0x6e, 0x7e, 0x7f,
+};
+
+/// The 16 bits at bit position pos, the bits need to be within the row.
+static inline unsigned bits16_at(const uint8_t *bytes, unsigned pos)
+{
+    const uint8_t *b = &bytes[pos >> 3];
+    unsigned shift   = pos & 7;
+    unsigned word    = (unsigned)b[0] << 8 | b[1];
+    if (shift)
+        word = (word << shift | b[2] >> (8 - shift)) & 0xffff;
+    return word;
+}
+
+/// Number of leading pairs before the first pair flagged in an 8 bit mask (MSB first).
+static inline unsigned first_flagged(unsigned mask)
+{
+    unsigned k = 0;
+    while (!(mask & (0x80 >> k)))
+        k++;
+    return k;
+}
+
 unsigned bitbuffer_manchester_decode(bitbuffer_t *inbuf, unsigned row, unsigned start,
         bitbuffer_t *outbuf, unsigned max)
 {
@@ -255,6 +520,23 @@ unsigned bitbuffer_manchester_decode(bitbuffer_t *inbuf, unsigned row, unsigned
     if (max && len > start + (max * 2))
         len = start + (max * 2);
 
+    // decode 16 bits to 8 bits at a time while they are all within the row
+    while (ipos + 16 <= len) {
+        unsigned word = bits16_at(bits, ipos);
+        unsigned hi   = manchester_lut[word >> 8];
+        unsigned lo   = manchester_lut[word & 0xff];
+        unsigned data = (hi & 0x0f) << 4 | (lo & 0x0f);
+        unsigned err  = (hi & 0xf0) | lo >> 4;
+        if (err) {
+            // stop after the first pair without a transition
+            unsigned k = first_flagged(err);
+            bitbuffer_add_word(outbuf, data >> (8 - k), k);
+            return ipos + 2 * k + 2;
+        }
+        bitbuffer_add_word(outbuf, data, 8);
+        ipos += 16;
+    }
+
     while (ipos < len) {
         uint8_t bit1, bit2;
 
@@ -305,6 +587,27 @@ unsigned bitbuffer_differential_manchester_decode(bitbuffer_t *inbuf, unsigned r
         }
     }
 
+    // decode 16 bits to 8 bits at a time while they are all within the row
+    while (ipos + 16 <= len) {
+        unsigned word = bits16_at(bits, ipos);
+        unsigned hi   = dmc_lut[word >> 8];
+        unsigned lo   = dmc_lut[word & 0xff];
+        unsigned data = (hi & 0x0f) << 4 | (lo & 0x0f);
+        unsigned err  = (hi & 0xf0) | lo >> 4;
+        // clock transitions before the first pair of each byte
+        err |= ((word >> 15) == bit2) << 7;
+        err |= ((word >> 7 & 1) == (word >> 8 & 1)) << 3;
+        if (err) {
+            // stop after the first bit of the pair that misses the clock
+            unsigned k = first_flagged(err);
+            bitbuffer_add_word(outbuf, data >> (8 - k), k);
+            return ipos + 2 * k + 1;
+        }
+        bitbuffer_add_word(outbuf, data, 8);
+        bit2 = word & 1;
+        ipos += 16;
+    }
+
     while (ipos < len) {
         bit1 = bit_at(bits, ipos++);
         if (bit1 == bit2)
@@ -453,10 +756,7 @@ void bitbuffer_parse(bitbuffer_t *bits, const char *code)
         else if (*c >= 'a' && *c <= 'f') {
             data = *c - 'a' + 10;
         }
-        bitbuffer_add_bit(bits, data >> 3 & 0x01);
-        bitbuffer_add_bit(bits, data >> 2 & 0x01);
-        bitbuffer_add_bit(bits, data >> 1 & 0x01);
-        bitbuffer_add_bit(bits, data >> 0 & 0x01);
+        bitbuffer_add_word(bits, data, 4);
     }
     if (width >= 0) {
         bitbuffer_set_width(bits, width);
@@ -518,6 +818,22 @@ int bitbuffer_find_repeated_prefix(bitbuffer_t *bits, unsigned min_repeats, unsi
 // Unit testing
 #ifdef _TEST
 
+/// Bit by bit search to check bitbuffer_search() against.
+static unsigned search_bitwise(bitbuffer_t *bitbuffer, unsigned row, unsigned start,
+        const uint8_t *pattern, unsigned pattern_bits_len)
+{
+    uint8_t *bits = bitbuffer->bb[row];
+    unsigned len  = bitbuffer->bits_per_row[row];
+    for (unsigned pos = start; pattern_bits_len && pos + pattern_bits_len <= len; ++pos) {
+        unsigned ppos = 0;
+        while (ppos < pattern_bits_len && bit_at(bits, pos + ppos) == bit_at(pattern, ppos))
+            ppos++;
+        if (ppos == pattern_bits_len)
+            return pos;
+    }
+    return len;
+}
+
 #define ASSERT(expr) \
     do { \
         if (expr) { \
@@ -592,6 +908,100 @@ int main(void)
     bitbuffer_add_bit(&bits, 1);
     bitbuffer_print(&bits);
 
+    fprintf(stderr, "TEST: bitbuffer:: Add runs and words\n");
+    static bitbuffer_t ref = {0};
+    static bitbuffer_t run = {0};
+    memset(run.bb, 0xff, sizeof(run.bb)); // stale bits need to be overwritten
+    bitbuffer_clear(&ref);
+    bitbuffer_clear(&run);
+    unsigned lens[] = {1, 3, 0, 7, 8, 9, 17, 2, 64, 5, BITBUF_COLS * 8, 11, BITBUF_COLS * 8 + 13, 4};
+    for (unsigned i = 0; i < sizeof(lens) / sizeof(*lens); ++i) {
+        for (unsigned j = 0; j < lens[i]; ++j) {
+            bitbuffer_add_bit(&ref, i % 2);
+        }
+        bitbuffer_add_bits(&run, i % 2, lens[i]);
+        for (unsigned j = 32; j > 0; --j) {
+            bitbuffer_add_bit(&ref, (0xdeadbeef >> (j - 1)) & 1);
+        }
+        bitbuffer_add_word(&run, 0xdeadbeef, 32);
+        for (unsigned j = 5; j > 0; --j) {
+            bitbuffer_add_bit(&ref, (0xfff5 >> (j - 1)) & 1);
+        }
+        bitbuffer_add_word(&run, 0xfff5, 5); // upper bits are ignored
+        if (i == 5) {
+            bitbuffer_add_row(&ref);
+            bitbuffer_add_row(&run);
+        }
+    }
+    ASSERT(run.num_rows == ref.num_rows);
+    ASSERT(run.free_row == ref.free_row);
+    ASSERT(!memcmp(run.bits_per_row, ref.bits_per_row, sizeof(ref.bits_per_row)));
+    for (unsigned r = 0; r < ref.num_rows; ++r) {
+        // long rows spill into the storage of the next rows
+        ASSERT(!memcmp(run.bb[r], ref.bb[r], (ref.bits_per_row[r] + 7) / 8));
+    }
+
+    fprintf(stderr, "TEST: bitbuffer:: Clear after runs\n");
+    bitbuffer_clear(&run);
+    bitbuffer_add_bits(&run, 1, 0);
+    ASSERT(run.num_rows == 0);
+    bitbuffer_add_bits(&run, 0, 3);
+    ASSERT(run.num_rows == 1);
+    ASSERT(run.bits_per_row[0] == 3);
+    ASSERT(run.bb[0][0] == 0);
+    bitbuffer_add_word(&run, 0x3, 2);
+    ASSERT(run.bb[0][0] == 0x18);
+
+    fprintf(stderr, "TEST: bitbuffer:: Add runs up to the row length limit\n");
+    bitbuffer_clear(&run);
+    bitbuffer_add_bits(&run, 1, BITBUF_MAX_ROW_BITS + 100);
+    ASSERT(run.bits_per_row[0] == BITBUF_MAX_ROW_BITS);
+
+    fprintf(stderr, "TEST: bitbuffer:: Search\n");
+    uint8_t pattern[12];
+    unsigned mismatches = 0;
+    srand(1);
+    for (unsigned t = 0; t < 2000; ++t) {
+        // few distinct bits so that partial matches are common
+        bitbuffer_clear(&run);
+        unsigned len = rand() % 300;
+        for (unsigned i = 0; i < len; ++i) {
+            bitbuffer_add_bit(&run, rand() % 5 == 0);
+        }
+        unsigned plen = rand() % 90;
+        for (unsigned i = 0; i < sizeof(pattern); ++i) {
+            pattern[i] = rand() % 3 ? 0 : 1 << (rand() % 8);
+        }
+        if (len > plen && rand() % 2) {
+            // plant the pattern at a random position
+            unsigned pos = rand() % (len - plen + 1);
+            bitbuffer_extract_bytes(&run, 0, pos, pattern, plen);
+        }
+        unsigned start = rand() % 4 ? 0 : rand() % (len + 2);
+        unsigned want  = search_bitwise(&run, 0, start, pattern, plen);
+        mismatches += bitbuffer_search(&run, 0, start, pattern, plen) != want;
+    }
+    ASSERT(mismatches == 0);
+
+    fprintf(stderr, "TEST: bitbuffer:: Search a spilled row\n");
+    bitbuffer_clear(&run);
+    bitbuffer_add_bits(&run, 0, BITBUF_COLS * 8 * 2 + 3);
+    bitbuffer_add_word(&run, 0x2dd4, 16);
+    uint8_t const sync[] = {0x2d, 0xd4, 0x00};
+    ASSERT(bitbuffer_search(&run, 0, 0, sync, 16) == BITBUF_COLS * 8 * 2 + 3);
+    ASSERT(bitbuffer_search(&run, 0, 0, sync, 17) == run.bits_per_row[0]);
+
+    fprintf(stderr, "TEST: bitbuffer:: Manchester decode\n");
+    bitbuffer_parse(&ref, "{24}5a9603");
+    bitbuffer_clear(&run);
+    ASSERT(bitbuffer_manchester_decode(&ref, 0, 0, &run, 0) == 18);
+    ASSERT(run.bits_per_row[0] == 8);
+    ASSERT(run.bb[0][0] == 0xc6);
+    bitbuffer_clear(&run);
+    ASSERT(bitbuffer_manchester_decode(&ref, 0, 2, &run, 3) == 8);
+    ASSERT(run.bits_per_row[0] == 3);
+    ASSERT(run.bb[0][0] == 0x80);
+
     fprintf(stderr, "bitbuffer:: test (%u/%u) passed, (%u) failed.\n", passed, passed + failed, failed);
 
     return failed > 0 ? 1 : 0;
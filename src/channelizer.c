@@ -0,0 +1,277 @@
+/** @file
+    FFT-based polyphase channelizer.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "channelizer.h"
+#include "fatal.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/// Input samples converted per pass, a multiple of every channel count.
+#define CHANNELIZER_CHUNK_LEN 4096
+
+struct channelizer {
+    unsigned num_channels; ///< Number of channels and the decimation factor
+    unsigned num_taps;     ///< Prototype filter length, num_channels * CHANNELIZER_PHASE_TAPS
+    unsigned next;         ///< Position in the next chunk of the newest sample for the next output
+    float *coeffs;         ///< Prototype low pass, unity DC gain
+    float *x_re;           ///< Input history and current chunk, I
+    float *x_im;           ///< Input history and current chunk, Q
+    float *fft_re;         ///< FFT work buffer, real part
+    float *fft_im;         ///< FFT work buffer, imag part
+    float *tw_re;          ///< FFT twiddles exp(+2 pi i k / n), real part
+    float *tw_im;          ///< FFT twiddles exp(+2 pi i k / n), imag part
+    unsigned *bitrev;      ///< FFT bit reversal permutation
+};
+
+channelizer_t *channelizer_create(unsigned num_channels)
+{
+    if (num_channels < 2 || num_channels > CHANNELIZER_MAX_CHANNELS || (num_channels & (num_channels - 1)))
+        return NULL; // not a power of two in range
+
+    channelizer_t *ch = calloc(1, sizeof(*ch));
+    if (!ch) {
+        WARN_CALLOC("channelizer_create()");
+        return NULL; // NOTE: returns NULL on alloc failure.
+    }
+    unsigned n = num_channels;
+    unsigned l = n * CHANNELIZER_PHASE_TAPS;
+    ch->num_channels = n;
+    ch->num_taps     = l;
+    ch->coeffs = calloc(l, sizeof(float));
+    if (!ch->coeffs)
+        goto alloc_error;
+    ch->x_re = calloc(l + CHANNELIZER_CHUNK_LEN, sizeof(float));
+    if (!ch->x_re)
+        goto alloc_error;
+    ch->x_im = calloc(l + CHANNELIZER_CHUNK_LEN, sizeof(float));
+    if (!ch->x_im)
+        goto alloc_error;
+    ch->fft_re = calloc(n, sizeof(float));
+    if (!ch->fft_re)
+        goto alloc_error;
+    ch->fft_im = calloc(n, sizeof(float));
+    if (!ch->fft_im)
+        goto alloc_error;
+    ch->tw_re = calloc(n, sizeof(float));
+    if (!ch->tw_re)
+        goto alloc_error;
+    ch->tw_im = calloc(n, sizeof(float));
+    if (!ch->tw_im)
+        goto alloc_error;
+    ch->bitrev = calloc(n, sizeof(unsigned));
+    if (!ch->bitrev)
+        goto alloc_error;
+
+    // Hamming windowed sinc prototype, cutoff at half the channel spacing
+    double fc     = 0.5 / n;
+    double center = (l - 1) / 2.0;
+    double sum    = 0.0;
+    for (unsigned k = 0; k < l; ++k) {
+        double t = k - center; // never 0 with an even number of taps
+        double h = sin(2.0 * M_PI * fc * t) / (M_PI * t);
+        h *= 0.54 - 0.46 * cos(2.0 * M_PI * k / (l - 1));
+        ch->coeffs[k] = (float)h;
+        sum += h;
+    }
+    for (unsigned k = 0; k < l; ++k) {
+        ch->coeffs[k] /= (float)sum;
+    }
+
+    unsigned bits = 0;
+    while ((1u << bits) < n)
+        bits++;
+    for (unsigned k = 0; k < n; ++k) {
+        ch->tw_re[k] = (float)cos(2.0 * M_PI * k / n);
+        ch->tw_im[k] = (float)sin(2.0 * M_PI * k / n);
+        unsigned r = 0;
+        for (unsigned b = 0; b < bits; ++b)
+            r |= ((k >> b) & 1) << (bits - 1 - b);
+        ch->bitrev[k] = r;
+    }
+
+    channelizer_reset(ch);
+    return ch;
+
+alloc_error:
+    WARN_CALLOC("channelizer_create()");
+    channelizer_free(ch);
+    return NULL; // NOTE: returns NULL on alloc failure.
+}
+
+void channelizer_free(channelizer_t *ch)
+{
+    if (!ch)
+        return;
+    free(ch->coeffs);
+    free(ch->x_re);
+    free(ch->x_im);
+    free(ch->fft_re);
+    free(ch->fft_im);
+    free(ch->tw_re);
+    free(ch->tw_im);
+    free(ch->bitrev);
+    free(ch);
+}
+
+void channelizer_reset(channelizer_t *ch)
+{
+    ch->next = ch->num_channels - 1;
+    memset(ch->x_re, 0, (ch->num_taps + CHANNELIZER_CHUNK_LEN) * sizeof(float));
+    memset(ch->x_im, 0, (ch->num_taps + CHANNELIZER_CHUNK_LEN) * sizeof(float));
+}
+
+unsigned channelizer_num_channels(channelizer_t const *ch)
+{
+    return ch->num_channels;
+}
+
+int channelizer_channel_offset(channelizer_t const *ch, unsigned channel, uint32_t samp_rate)
+{
+    int k = channel < ch->num_channels / 2 ? (int)channel : (int)channel - (int)ch->num_channels;
+    return (int)((int64_t)k * samp_rate / ch->num_channels);
+}
+
+/// In-place radix-2 FFT with positive exponent (unscaled inverse DFT).
+static void channelizer_fft(channelizer_t *ch)
+{
+    unsigned n = ch->num_channels;
+    float *re  = ch->fft_re;
+    float *im  = ch->fft_im;
+
+    for (unsigned k = 0; k < n; ++k) {
+        unsigned r = ch->bitrev[k];
+        if (r > k) {
+            float t = re[k];
+            re[k]   = re[r];
+            re[r]   = t;
+            t       = im[k];
+            im[k]   = im[r];
+            im[r]   = t;
+        }
+    }
+    for (unsigned len = 2; len <= n; len <<= 1) {
+        unsigned half = len / 2;
+        unsigned step = n / len;
+        for (unsigned i = 0; i < n; i += len) {
+            for (unsigned j = 0; j < half; ++j) {
+                float wr = ch->tw_re[j * step];
+                float wi = ch->tw_im[j * step];
+                unsigned a = i + j;
+                unsigned b = a + half;
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+                re[b]    = re[a] - tr;
+                im[b]    = im[a] - ti;
+                re[a]    = re[a] + tr;
+                im[a]    = im[a] + ti;
+            }
+        }
+    }
+}
+
+static inline int16_t channelizer_clamp(float v)
+{
+    v *= 32768.0f; // scale to Q0.15
+    return v >= 32767.0f ? INT16_MAX : v <= -32768.0f ? INT16_MIN : (int16_t)lrintf(v);
+}
+
+/// Filter and split the chunk already placed after the history.
+static uint32_t channelizer_run_chunk(channelizer_t *ch, uint32_t n, int16_t **out_bufs, uint32_t out_pos)
+{
+    unsigned num    = ch->num_channels;
+    unsigned phases = CHANNELIZER_PHASE_TAPS;
+    unsigned hist   = ch->num_taps - 1;
+    uint32_t n_out  = 0;
+
+    uint32_t pos = ch->next;
+    for (; pos < n; pos += num) {
+        // polyphase branch sums, u[p] = sum_q h[q * num + p] * x[newest - q * num - p]
+        float const *x_re = &ch->x_re[hist + pos];
+        float const *x_im = &ch->x_im[hist + pos];
+        for (unsigned p = 0; p < num; ++p) {
+            float u_re = 0.0f;
+            float u_im = 0.0f;
+            for (unsigned q = 0; q < phases; ++q) {
+                unsigned i = q * num + p;
+                float h = ch->coeffs[i];
+                u_re += h * x_re[-(int)i];
+                u_im += h * x_im[-(int)i];
+            }
+            ch->fft_re[p] = u_re;
+            ch->fft_im[p] = u_im;
+        }
+        // mix each channel down to baseband, the constant phase offset per channel is ignored
+        channelizer_fft(ch);
+        for (unsigned k = 0; k < num; ++k) {
+            out_bufs[k][(out_pos + n_out) * 2]     = channelizer_clamp(ch->fft_re[k]);
+            out_bufs[k][(out_pos + n_out) * 2 + 1] = channelizer_clamp(ch->fft_im[k]);
+        }
+        n_out++;
+    }
+    ch->next = pos - n;
+
+    // keep the newest samples as history for the next chunk
+    memmove(ch->x_re, &ch->x_re[n], hist * sizeof(float));
+    memmove(ch->x_im, &ch->x_im[n], hist * sizeof(float));
+    return n_out;
+}
+
+uint32_t channelizer_process_cu8(channelizer_t *ch, uint8_t const *iq_buf, uint32_t len, int16_t **out_bufs)
+{
+    unsigned hist  = ch->num_taps - 1;
+    uint32_t n_out = 0;
+
+    for (uint32_t pos = 0; pos < len; pos += CHANNELIZER_CHUNK_LEN) {
+        uint32_t n = len - pos < CHANNELIZER_CHUNK_LEN ? len - pos : CHANNELIZER_CHUNK_LEN;
+        for (uint32_t i = 0; i < n; ++i) {
+            ch->x_re[hist + i] = (iq_buf[2 * (pos + i)] - 128) * (1.0f / 128);
+            ch->x_im[hist + i] = (iq_buf[2 * (pos + i) + 1] - 128) * (1.0f / 128);
+        }
+        n_out += channelizer_run_chunk(ch, n, out_bufs, n_out);
+    }
+    return n_out;
+}
+
+uint32_t channelizer_process_cs16(channelizer_t *ch, int16_t const *iq_buf, uint32_t len, int16_t **out_bufs)
+{
+    unsigned hist  = ch->num_taps - 1;
+    uint32_t n_out = 0;
+
+    for (uint32_t pos = 0; pos < len; pos += CHANNELIZER_CHUNK_LEN) {
+        uint32_t n = len - pos < CHANNELIZER_CHUNK_LEN ? len - pos : CHANNELIZER_CHUNK_LEN;
+        for (uint32_t i = 0; i < n; ++i) {
+            ch->x_re[hist + i] = iq_buf[2 * (pos + i)] * (1.0f / 32768);
+            ch->x_im[hist + i] = iq_buf[2 * (pos + i) + 1] * (1.0f / 32768);
+        }
+        n_out += channelizer_run_chunk(ch, n, out_bufs, n_out);
+    }
+    return n_out;
+}
+
+uint32_t channelizer_process_cf32(channelizer_t *ch, float const *iq_buf, uint32_t len, int16_t **out_bufs)
+{
+    unsigned hist  = ch->num_taps - 1;
+    uint32_t n_out = 0;
+
+    for (uint32_t pos = 0; pos < len; pos += CHANNELIZER_CHUNK_LEN) {
+        uint32_t n = len - pos < CHANNELIZER_CHUNK_LEN ? len - pos : CHANNELIZER_CHUNK_LEN;
+        for (uint32_t i = 0; i < n; ++i) {
+            ch->x_re[hist + i] = iq_buf[2 * (pos + i)];
+            ch->x_im[hist + i] = iq_buf[2 * (pos + i) + 1];
+        }
+        n_out += channelizer_run_chunk(ch, n, out_bufs, n_out);
+    }
+    return n_out;
+}
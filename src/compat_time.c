@@ -5,6 +5,10 @@
 
 #include "compat_time.h"
 
+#ifndef _WIN32
+#include <time.h>
+#endif
+
 #ifdef _WIN32
 
 #include <stdbool.h>
@@ -33,6 +37,27 @@ int gettimeofday(struct timeval *tv, void *tz)
     return 0;
 }
 
+uint64_t monotonic_ns(void)
+{
+    static LARGE_INTEGER freq;
+    if (!freq.QuadPart)
+        QueryPerformanceFrequency(&freq); // fixed at boot, racing here is harmless
+    LARGE_INTEGER count;
+    QueryPerformanceCounter(&count);
+    uint64_t sec = (uint64_t)count.QuadPart / (uint64_t)freq.QuadPart;
+    uint64_t rem = (uint64_t)count.QuadPart % (uint64_t)freq.QuadPart;
+    return sec * 1000000000ULL + rem * 1000000000ULL / (uint64_t)freq.QuadPart;
+}
+
+#else
+
+uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
 #endif // _WIN32
 
 int timeval_subtract(struct timeval *result, struct timeval const *x, struct timeval const *y)
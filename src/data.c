@@ -14,6 +14,7 @@
 
 #include "abuf.h"
 #include "fatal.h"
+#include "compat_pthread.h"
 
 #include <stdarg.h>
 #include <assert.h>
@@ -76,12 +77,12 @@ static data_meta_type_t dmt[DATA_COUNT] = {
       .array_element_release    = NULL,
       .value_release            = NULL },
 
-    //  DATA_STRING
+    //  DATA_STRING, values are in the arena of the element
     { .array_element_size       = sizeof(char*),
       .array_is_boxed           = true,
       .array_elementwise_import = (array_elementwise_import_fn) strdup,
       .array_element_release    = (array_element_release_fn) free,
-      .value_release            = (value_release_fn) free },
+      .value_release            = NULL },
 
     //  DATA_ARRAY
     { .array_element_size       = sizeof(data_array_t*),
@@ -115,6 +116,123 @@ static bool import_values(void *dst, void const *src, int num_values, data_type_
     return true; // error is returned early
 }
 
+/* arena */
+
+#define ARENA_BLOCK_SIZE 1024 ///< first block of an arena, enough for a typical event
+#define ARENA_ALIGN 8         ///< alignment of the allocations, enough for data_t
+
+/** Memory for the elements and strings of an event.
+
+    More blocks are chained to the first when it runs full, all blocks are
+    freed with the last element using the arena.
+*/
+struct data_arena {
+    struct data_arena *next; ///< next block
+    struct data_arena *tail; ///< block to allocate from, first block only
+    unsigned elements;       ///< elements using the arena, first block only
+    size_t size;             ///< bytes after the header
+    size_t used;             ///< bytes used after the header
+};
+
+#define ARENA_HEADER_SIZE ((sizeof(struct data_arena) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static struct data_arena *arena_block(size_t size)
+{
+    if (size < ARENA_BLOCK_SIZE)
+        size = ARENA_BLOCK_SIZE;
+    struct data_arena *block = malloc(ARENA_HEADER_SIZE + size);
+    if (!block) {
+        WARN_MALLOC("arena_block()");
+        return NULL; // NOTE: returns NULL on alloc failure.
+    }
+    block->next     = NULL;
+    block->tail     = block;
+    block->elements = 0;
+    block->size     = size;
+    block->used     = 0;
+    return block;
+}
+
+/// Take size bytes from the arena, chains a new block if needed.
+static void *arena_take(struct data_arena *arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    struct data_arena *block = arena->tail;
+    if (block->size - block->used < size) {
+        block = arena_block(size);
+        if (!block)
+            return NULL; // NOTE: returns NULL on alloc failure.
+        arena->tail->next = block;
+        arena->tail       = block;
+    }
+    void *mem = (char *)block + ARENA_HEADER_SIZE + block->used;
+    block->used += size;
+    return mem;
+}
+
+/// Drop an element from the arena, frees the arena with the last element.
+static void arena_release(struct data_arena *arena)
+{
+    if (--arena->elements)
+        return;
+    while (arena) {
+        struct data_arena *next = arena->next;
+        free(arena);
+        arena = next;
+    }
+}
+
+/* interned keys */
+
+#define INTERN_SLOTS 512  ///< hash slots, a power of two
+#define INTERN_MAX 256    ///< keys interned per thread, at most half the slots
+#define INTERN_POOL 8192  ///< bytes for the interned strings per thread
+
+/// Keys and pretty keys a thread has used, these are a small set of mostly string literals.
+typedef struct intern_table {
+    char const *slot[INTERN_SLOTS];
+    unsigned count;
+    size_t used;
+    char pool[INTERN_POOL];
+} intern_table_t;
+
+// never freed, elements may outlive the thread that made them
+static THREAD_LOCAL intern_table_t *interned;
+
+/// Find or add the interned copy of a string, NULL if the table is full.
+static char const *intern(char const *str)
+{
+    if (!interned) {
+        interned = calloc(1, sizeof(*interned));
+        if (!interned) {
+            WARN_CALLOC("intern()");
+            return NULL; // NOTE: the strings go to the arena on alloc failure.
+        }
+    }
+
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    size_t len    = 0;
+    for (; str[len]; ++len) {
+        hash = (hash ^ (uint8_t)str[len]) * 16777619u;
+    }
+    unsigned i = hash & (INTERN_SLOTS - 1);
+    while (interned->slot[i]) {
+        if (!strcmp(interned->slot[i], str))
+            return interned->slot[i];
+        i = (i + 1) & (INTERN_SLOTS - 1);
+    }
+
+    if (interned->count >= INTERN_MAX || interned->used + len + 1 > INTERN_POOL)
+        return NULL;
+    char *copy = &interned->pool[interned->used];
+    memcpy(copy, str, len + 1);
+    interned->used += len + 1;
+    interned->count += 1;
+    interned->slot[i] = copy;
+    return copy;
+}
+
 /* data */
 
 R_API data_array_t *data_array(int num_values, data_type_t type, void const *values)
@@ -162,7 +280,7 @@ static data_t *vdata_make(data_t *first, const char *key, const char *pretty_key
     data_t *prev = first;
     while (prev && prev->next)
         prev = prev->next;
-    char *format = NULL;
+    char const *format = NULL;
     int skip = 0; // skip the data item if this is set
     type = va_arg(ap, data_type_t);
     do {
@@ -181,14 +299,7 @@ static data_t *vdata_make(data_t *first, const char *key, const char *pretty_key
                 fprintf(stderr, "vdata_make() format type used twice\n");
                 goto alloc_error;
             }
-            format = va_arg(ap, char *);
-            if (format) {
-                format = strdup(format);
-                if (!format) {
-                    WARN_STRDUP("vdata_make()");
-                    goto alloc_error;
-                }
-            }
+            format = va_arg(ap, char const *); // copied with the element
             type = va_arg(ap, data_type_t);
             continue;
         case DATA_COUNT:
@@ -205,10 +316,7 @@ static data_t *vdata_make(data_t *first, const char *key, const char *pretty_key
             value.v_dbl = va_arg(ap, double);
             break;
         case DATA_STRING:
-            value_release = (value_release_fn)free; // appease CSA checker
-            value.v_ptr = strdup(va_arg(ap, char const *));
-            if (!value.v_ptr)
-                WARN_STRDUP("vdata_make()");
+            value.v_ptr = (void *)va_arg(ap, char const *); // copied with the element
             break;
         case DATA_ARRAY:
             value_release = (value_release_fn)data_array_free; // appease CSA checker
@@ -222,40 +330,64 @@ static data_t *vdata_make(data_t *first, const char *key, const char *pretty_key
         if (skip) {
             if (value_release) // could use dmt[type].value_release
                 value_release(value.v_ptr);
-            free(format);
             format = NULL;
             skip = 0;
         }
         else {
-            current = calloc(1, sizeof(*current));
+            // the element and the strings not interned are one allocation from the arena
+            char const *ikey    = intern(key);
+            char const *ipretty = pretty_key ? intern(pretty_key) : ikey;
+            size_t key_size     = ikey ? 0 : strlen(key) + 1;
+            size_t pretty_size  = ipretty ? 0 : strlen(pretty_key ? pretty_key : key) + 1;
+            size_t format_size  = format ? strlen(format) + 1 : 0;
+            size_t value_size   = type == DATA_STRING ? strlen(value.v_ptr) + 1 : 0;
+
+            struct data_arena *arena = prev ? prev->arena : arena_block(0);
+            current = NULL;
+            if (arena)
+                current = arena_take(arena, sizeof(*current) + key_size + pretty_size + format_size + value_size);
             if (!current) {
-                WARN_CALLOC("vdata_make()");
+                WARN_MALLOC("vdata_make()");
+                if (arena && !arena->elements)
+                    free(arena); // new and unused
                 if (value_release) // could use dmt[type].value_release
                     value_release(value.v_ptr);
                 goto alloc_error;
             }
-            current->type   = type;
-            current->format = format;
-            format          = NULL; // consumed
-            current->value  = value;
-            current->next   = NULL;
+            arena->elements += 1;
+
+            char *str = (char *)(current + 1);
+            if (!ikey) {
+                ikey = memcpy(str, key, key_size);
+                str += key_size;
+            }
+            if (!ipretty) {
+                ipretty = memcpy(str, pretty_key ? pretty_key : key, pretty_size);
+                str += pretty_size;
+            }
+            if (format) {
+                format = memcpy(str, format, format_size);
+                str += format_size;
+            }
+            if (value_size) {
+                value.v_ptr = memcpy(str, value.v_ptr, value_size);
+            }
+
+            current->next       = NULL;
+            current->key        = ikey;
+            current->pretty_key = ipretty;
+            current->format     = (char *)format;
+            format              = NULL; // consumed
+            current->value      = value;
+            current->type       = type;
+            current->retain     = 0;
+            current->arena      = arena;
 
             if (prev)
                 prev->next = current;
             prev = current;
             if (!first)
                 first = current;
-
-            current->key = strdup(key);
-            if (!current->key) {
-                WARN_STRDUP("vdata_make()");
-                goto alloc_error;
-            }
-            current->pretty_key = strdup(pretty_key ? pretty_key : key);
-            if (!current->pretty_key) {
-                WARN_STRDUP("vdata_make()");
-                goto alloc_error;
-            }
         }
 
         // next args
@@ -273,7 +405,6 @@ static data_t *vdata_make(data_t *first, const char *key, const char *pretty_key
     return first;
 
 alloc_error:
-    free(format); // if not consumed
     data_free(first);
     return NULL;
 }
@@ -380,12 +511,36 @@ R_API void data_free(data_t *data)
         data_t *prev_data = data;
         if (dmt[data->type].value_release)
             dmt[data->type].value_release(data->value.v_ptr);
-        free(data->format);
-        free(data->pretty_key);
-        free(data->key);
         data = data->next;
-        free(prev_data);
+        arena_release(prev_data->arena);
+    }
+}
+
+R_API int data_rename(data_t *data, char const *key, char const *format)
+{
+    char const *ikey   = key ? intern(key) : data->key;
+    size_t key_size    = ikey ? 0 : strlen(key) + 1;
+    size_t format_size = format && format != data->format ? strlen(format) + 1 : 0;
+
+    char *str = NULL;
+    if (key_size + format_size) {
+        str = arena_take(data->arena, key_size + format_size);
+        if (!str) {
+            WARN_MALLOC("data_rename()");
+            return -1;
+        }
     }
+    if (!ikey) {
+        ikey = memcpy(str, key, key_size);
+        str += key_size;
+    }
+    if (format_size) {
+        format = memcpy(str, format, format_size);
+    }
+
+    data->key    = ikey;
+    data->format = (char *)format;
+    return 0;
 }
 
 #pragma GCC diagnostic pop
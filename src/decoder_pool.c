@@ -0,0 +1,199 @@
+/** @file
+    Worker pool to run the decoders of a package in parallel.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#include "decoder_pool.h"
+#include "logger.h"
+#include "fatal.h"
+#include "compat_pthread.h"
+
+#include <stdlib.h>
+#include <signal.h>
+
+#ifdef THREADS
+
+typedef struct worker_arg {
+    struct decoder_pool *pool;
+    unsigned worker;
+} worker_arg_t;
+
+struct decoder_pool {
+    unsigned num_threads;     ///< threads including the calling thread
+    unsigned num_started;     ///< worker threads started
+    pthread_t threads[DECODER_POOL_MAX_THREADS];
+    worker_arg_t args[DECODER_POOL_MAX_THREADS];
+    pthread_mutex_t lock;     ///< lock for all fields below
+    pthread_cond_t start_cond; ///< wait for a new run
+    pthread_cond_t done_cond; ///< wait for the workers to finish a run
+    unsigned generation;      ///< incremented on every run
+    int quit;
+    unsigned busy;            ///< workers not done with the current run
+    decoder_pool_job_fn job_fn;
+    void *ctx;
+    unsigned num_jobs;
+    unsigned next_job;
+};
+
+/// Take jobs until there are none left, the lock is held on entry and exit.
+static void run_jobs(decoder_pool_t *pool, unsigned worker)
+{
+    while (pool->next_job < pool->num_jobs) {
+        unsigned job = pool->next_job++;
+        pthread_mutex_unlock(&pool->lock);
+        pool->job_fn(pool->ctx, job, worker);
+        pthread_mutex_lock(&pool->lock);
+    }
+}
+
+static THREAD_RETURN THREAD_CALL pool_worker(void *arg)
+{
+    worker_arg_t *worker_arg = arg;
+    decoder_pool_t *pool     = worker_arg->pool;
+    unsigned worker          = worker_arg->worker;
+
+    pthread_mutex_lock(&pool->lock);
+    unsigned seen = 0; // the threads start before the first run
+    for (;;) {
+        while (!pool->quit && pool->generation == seen) {
+            pthread_cond_wait(&pool->start_cond, &pool->lock);
+        }
+        if (pool->quit)
+            break;
+        seen = pool->generation;
+
+        run_jobs(pool, worker);
+
+        pool->busy -= 1;
+        if (!pool->busy)
+            pthread_cond_signal(&pool->done_cond);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return (THREAD_RETURN)0;
+}
+
+decoder_pool_t *decoder_pool_create(unsigned num_threads)
+{
+    if (num_threads < 2 || num_threads > DECODER_POOL_MAX_THREADS)
+        return NULL;
+
+    decoder_pool_t *pool = calloc(1, sizeof(*pool));
+    if (!pool) {
+        WARN_CALLOC("decoder_pool_create()");
+        return NULL;
+    }
+    pool->num_threads = num_threads;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+#ifndef _WIN32
+    // Block all signals from the worker threads
+    sigset_t sigset;
+    sigset_t oldset;
+    sigfillset(&sigset);
+    pthread_sigmask(SIG_SETMASK, &sigset, &oldset);
+#endif
+    for (unsigned i = 1; i < num_threads; ++i) {
+        pool->args[i] = (worker_arg_t){.pool = pool, .worker = i};
+        if (pthread_create(&pool->threads[i], NULL, pool_worker, &pool->args[i])) {
+            print_logf(LOG_WARNING, __func__, "Only %u of %u decoder threads started", i, num_threads);
+            break;
+        }
+        pool->num_started = i;
+    }
+#ifndef _WIN32
+    pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+#endif
+
+    if (!pool->num_started) {
+        decoder_pool_free(pool);
+        return NULL;
+    }
+    pool->num_threads = pool->num_started + 1;
+    return pool;
+}
+
+void decoder_pool_free(decoder_pool_t *pool)
+{
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->start_cond);
+    pthread_mutex_unlock(&pool->lock);
+    for (unsigned i = 1; i <= pool->num_started; ++i) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    free(pool);
+}
+
+unsigned decoder_pool_num_threads(decoder_pool_t const *pool)
+{
+    return pool ? pool->num_threads : 1;
+}
+
+void decoder_pool_run(decoder_pool_t *pool, unsigned num_jobs, decoder_pool_job_fn job_fn, void *ctx)
+{
+    if (!pool || num_jobs < 2) {
+        for (unsigned job = 0; job < num_jobs; ++job) {
+            job_fn(ctx, job, 0);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->job_fn   = job_fn;
+    pool->ctx      = ctx;
+    pool->num_jobs = num_jobs;
+    pool->next_job = 0;
+    pool->busy     = pool->num_started;
+    pool->generation += 1;
+    pthread_cond_broadcast(&pool->start_cond);
+
+    run_jobs(pool, 0);
+
+    while (pool->busy) {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+#else
+
+decoder_pool_t *decoder_pool_create(unsigned num_threads)
+{
+    (void)num_threads;
+    return NULL;
+}
+
+void decoder_pool_free(decoder_pool_t *pool)
+{
+    (void)pool;
+}
+
+unsigned decoder_pool_num_threads(decoder_pool_t const *pool)
+{
+    (void)pool;
+    return 1;
+}
+
+void decoder_pool_run(decoder_pool_t *pool, unsigned num_jobs, decoder_pool_job_fn job_fn, void *ctx)
+{
+    (void)pool;
+    for (unsigned job = 0; job < num_jobs; ++job) {
+        job_fn(ctx, job, 0);
+    }
+}
+
+#endif
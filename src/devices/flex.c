@@ -64,6 +64,7 @@ struct flex_map {
 };
 
 #define GETTER_MAP_SLOTS 16
+#define GETTER_RUN_SLOTS 16 // alternating mask bits below bit 31
 
 struct flex_get {
     unsigned bit_offset;
@@ -72,8 +73,78 @@ struct flex_get {
     const char *name;
     struct flex_map map[GETTER_MAP_SLOTS];
     const char *format;
+    // the plan from compile_getter(), num_bytes is 0 if the getter needs the generic extract
+    unsigned byte_pos;  ///< first byte of the value
+    unsigned num_bytes; ///< bytes to load as big endian number, up to 8
+    unsigned shr;       ///< shift right of the loaded number to align the value
+    uint64_t keep;      ///< mask of the value bits after the shift
+    unsigned num_runs;  ///< runs of consecutive mask bits, 0 without a mask
+    uint8_t run_shift[GETTER_RUN_SLOTS]; ///< shift right to move a run to its compacted place
+    uint64_t run_mask[GETTER_RUN_SLOTS]; ///< compacted bits of a run
 };
 
+/** Precompute the loads, shifts and masks of a getter.
+
+    The result needs to be identical to extract_number() or, with a mask, compact_number().
+    The latter only works for masks below bit 31, larger masks and values spanning more
+    than 8 bytes are left to the generic functions.
+*/
+static void compile_getter(struct flex_get *getter)
+{
+    unsigned count = getter->bit_count;
+    if (getter->mask) {
+        // compact_number() reads up to the top mask bit
+        count = 0;
+        for (unsigned long m = getter->mask; m; m >>= 1)
+            count++;
+        if (count > 31)
+            return;
+    }
+    unsigned shl = getter->bit_offset % 8;
+    if (!count || shl + count > 64)
+        return;
+
+    getter->byte_pos  = getter->bit_offset / 8;
+    getter->num_bytes = (shl + count + 7) / 8;
+    getter->shr       = getter->num_bytes * 8 - shl - count;
+    getter->keep      = count < 64 ? ((uint64_t)1 << count) - 1 : ~(uint64_t)0;
+
+    // each run of mask bits moves down by the number of unmasked bits below it
+    unsigned below = 0; // mask bits below the current bit
+    for (unsigned b = 0; b < count;) {
+        if (!(getter->mask >> b & 1)) {
+            b++;
+            continue;
+        }
+        unsigned lo = b;
+        while (b < count && getter->mask >> b & 1)
+            b++;
+        unsigned width = b - lo;
+        getter->run_shift[getter->num_runs] = (uint8_t)(lo - below);
+        getter->run_mask[getter->num_runs]  = (((uint64_t)1 << width) - 1) << below;
+        getter->num_runs++;
+        below += width;
+    }
+}
+
+/// extract a getter value with the plan from compile_getter()
+static unsigned long planned_number(uint8_t const *data, struct flex_get const *getter)
+{
+    uint64_t raw = 0;
+    for (unsigned i = 0; i < getter->num_bytes; ++i) {
+        raw = raw << 8 | data[getter->byte_pos + i];
+    }
+    raw = raw >> getter->shr & getter->keep;
+    if (!getter->num_runs)
+        return (unsigned long)raw;
+
+    uint64_t val = 0;
+    for (unsigned i = 0; i < getter->num_runs; ++i) {
+        val |= raw >> getter->run_shift[i] & getter->run_mask[i];
+    }
+    return (unsigned long)val;
+}
+
 #define GETTER_SLOTS 12
 
 struct flex_params {
@@ -90,8 +161,10 @@ struct flex_params {
     unsigned count_only;
     unsigned match_len;
     uint8_t match_bits[128];
+    bitbuffer_pattern_t match_pattern;
     unsigned preamble_len;
     uint8_t preamble_bits[128];
+    bitbuffer_pattern_t preamble_pattern;
     uint32_t symbol_zero;
     uint32_t symbol_one;
     uint32_t symbol_sync;
@@ -100,14 +173,18 @@ struct flex_params {
     unsigned decode_dm;
     unsigned decode_mc;
     char const *fields[7 + GETTER_SLOTS + 1]; // NOTE: needs to match output_fields
+    bitbuffer_t decoded; // scratch for the row decoders, only the rows used are cleared
 };
 
 static void print_row_bytes(char *row_bytes, uint8_t *bits, int num_bits)
 {
+    static char const hex[] = "0123456789abcdef";
     row_bytes[0] = '\0';
     // print byte-wide
     for (int col = 0; col < (num_bits + 7) / 8; ++col) {
-        sprintf(&row_bytes[2 * col], "%02x", bits[col]);
+        row_bytes[2 * col]     = hex[bits[col] >> 4];
+        row_bytes[2 * col + 1] = hex[bits[col] & 0xf];
+        row_bytes[2 * col + 2] = '\0';
     }
     // remove last nibble if needed
     row_bytes[2 * (num_bits + 3) / 8] = '\0';
@@ -119,7 +196,9 @@ static void render_getters(data_t *data, uint8_t *bits, struct flex_params *para
     for (int g = 0; g < GETTER_SLOTS && params->getter[g].bit_count > 0; ++g) {
         struct flex_get *getter = &params->getter[g];
         unsigned long val;
-        if (getter->mask)
+        if (getter->num_bytes)
+            val = planned_number(bits, getter);
+        else if (getter->mask)
             val = compact_number(bits, getter->bit_offset, getter->mask);
         else
             val = extract_number(bits, getter->bit_offset, getter->bit_count);
@@ -155,17 +234,23 @@ static int flex_callback(r_device *decoder, bitbuffer_t *bitbuffer)
             || (params->max_rows && bitbuffer->num_rows > params->max_rows))
         return DECODE_ABORT_LENGTH;
 
+    int r = -1; // first row with min_bits
     for (i = 0; i < bitbuffer->num_rows; i++) {
-        if ((bitbuffer->bits_per_row[i] >= params->min_bits)
-                && (!params->max_bits || bitbuffer->bits_per_row[i] <= params->max_bits))
-            match_count++;
+        if (bitbuffer->bits_per_row[i] >= params->min_bits) {
+            if (r < 0)
+                r = i;
+            if (!params->max_bits || bitbuffer->bits_per_row[i] <= params->max_bits)
+                match_count++;
+        }
     }
     if (!match_count)
         return DECODE_ABORT_LENGTH;
 
     // discard unless min_repeats, min_bits
     // TODO: check max_repeats, max_bits
-    int r = bitbuffer_find_repeated_row(bitbuffer, params->min_repeats, params->min_bits);
+    // every row is a repeat of itself, only search with more repeats
+    if (params->min_repeats > 1)
+        r = bitbuffer_find_repeated_row(bitbuffer, params->min_repeats, params->min_bits);
     if (r < 0)
         return DECODE_ABORT_EARLY;
     // TODO: set match_count to count of repeated rows
@@ -186,7 +271,7 @@ static int flex_callback(r_device *decoder, bitbuffer_t *bitbuffer)
         r = -1;
         match_count = 0;
         for (i = 0; i < bitbuffer->num_rows; i++) {
-            if (bitbuffer_search(bitbuffer, i, 0, params->match_bits, params->match_len) < bitbuffer->bits_per_row[i]) {
+            if (bitbuffer_search_compiled(bitbuffer, i, 0, &params->match_pattern) < bitbuffer->bits_per_row[i]) {
                 if (r < 0)
                     r = i;
                 match_count++;
@@ -201,7 +286,7 @@ static int flex_callback(r_device *decoder, bitbuffer_t *bitbuffer)
         r = -1;
         match_count = 0;
         for (i = 0; i < bitbuffer->num_rows; i++) {
-            unsigned pos = bitbuffer_search(bitbuffer, i, 0, params->preamble_bits, params->preamble_len);
+            unsigned pos = bitbuffer_search_compiled(bitbuffer, i, 0, &params->preamble_pattern);
             if (pos < bitbuffer->bits_per_row[i]) {
                 if (r < 0)
                     r = i;
@@ -209,9 +294,9 @@ static int flex_callback(r_device *decoder, bitbuffer_t *bitbuffer)
                 pos += params->preamble_len;
                 // TODO: refactor to bitbuffer_shift_row()
                 unsigned len = bitbuffer->bits_per_row[i] - pos;
-                bitbuffer_t tmp = {0};
-                bitbuffer_extract_bytes(bitbuffer, i, pos, tmp.bb[0], len);
-                memcpy(bitbuffer->bb[i], tmp.bb[0], (len + 7) / 8);
+                uint8_t tmp[BITBUF_ROWS * BITBUF_COLS]; // no need to clear, every byte is written
+                bitbuffer_extract_bytes(bitbuffer, i, pos, tmp, len);
+                memcpy(bitbuffer->bb[i], tmp, (len + 7) / 8);
                 bitbuffer->bits_per_row[i] = len;
             }
         }
@@ -226,10 +311,12 @@ static int flex_callback(r_device *decoder, bitbuffer_t *bitbuffer)
 
         for (i = 0; i < bitbuffer->num_rows; i++) {
             // TODO: refactor to bitbuffer_decode_symbol_row()
-            unsigned len    = bitbuffer->bits_per_row[i];
-            bitbuffer_t tmp = {0};
-            len             = extract_bits_symbols(bitbuffer->bb[i], 0, len, zero, one, sync, tmp.bb[0]);
-            memcpy(bitbuffer->bb[i], tmp.bb[0], len); // safe to write over: can only be shorter
+            unsigned len = bitbuffer->bits_per_row[i];
+            uint8_t tmp[BITBUF_ROWS * BITBUF_COLS];
+            // only the ones are set, this also clears the row tail with the len bytes copied below
+            memset(tmp, 0, len < sizeof(tmp) ? len : sizeof(tmp));
+            len = extract_bits_symbols(bitbuffer->bb[i], 0, len, zero, one, sync, tmp);
+            memcpy(bitbuffer->bb[i], tmp, len); // safe to write over: can only be shorter
             bitbuffer->bits_per_row[i] = len;
         }
         // TODO: apply min_bits, max_bits check
@@ -239,9 +326,9 @@ static int flex_callback(r_device *decoder, bitbuffer_t *bitbuffer)
         for (i = 0; i < bitbuffer->num_rows; i++) {
             // TODO: refactor to bitbuffer_decode_uart_row()
             unsigned len = bitbuffer->bits_per_row[i];
-            bitbuffer_t tmp = {0};
-            len = extract_bytes_uart(bitbuffer->bb[i], 0, len, tmp.bb[0]);
-            memcpy(bitbuffer->bb[i], tmp.bb[0], len); // safe to write over: can only be shorter
+            uint8_t tmp[BITBUF_ROWS * BITBUF_COLS]; // no need to clear, every byte is written
+            len = extract_bytes_uart(bitbuffer->bb[i], 0, len, tmp);
+            memcpy(bitbuffer->bb[i], tmp, len); // safe to write over: can only be shorter
             bitbuffer->bits_per_row[i] = len * 8;
         }
     }
@@ -250,10 +337,11 @@ static int flex_callback(r_device *decoder, bitbuffer_t *bitbuffer)
         for (i = 0; i < bitbuffer->num_rows; i++) {
             // TODO: refactor to bitbuffer_decode_dm_row()
             unsigned len = bitbuffer->bits_per_row[i];
-            bitbuffer_t tmp = {0};
-            bitbuffer_differential_manchester_decode(bitbuffer, i, 0, &tmp, len);
-            len = tmp.bits_per_row[0];
-            memcpy(bitbuffer->bb[i], tmp.bb[0], (len + 7) / 8); // safe to write over: can only be shorter
+            bitbuffer_t *tmp = &params->decoded;
+            bitbuffer_clear(tmp);
+            bitbuffer_differential_manchester_decode(bitbuffer, i, 0, tmp, len);
+            len = tmp->bits_per_row[0];
+            memcpy(bitbuffer->bb[i], tmp->bb[0], (len + 7) / 8); // safe to write over: can only be shorter
             bitbuffer->bits_per_row[i] = len;
         }
     }
@@ -263,10 +351,11 @@ static int flex_callback(r_device *decoder, bitbuffer_t *bitbuffer)
         for (i = 0; i < bitbuffer->num_rows; i++) {
             // TODO: refactor to bitbuffer_decode_mc_row()
             unsigned len = bitbuffer->bits_per_row[i];
-            bitbuffer_t tmp = {0};
-            bitbuffer_manchester_decode(bitbuffer, i, 0, &tmp, len);
-            len = tmp.bits_per_row[0];
-            memcpy(bitbuffer->bb[i], tmp.bb[0], (len + 7) / 8); // safe to write over: can only be shorter
+            bitbuffer_t *tmp = &params->decoded;
+            bitbuffer_clear(tmp);
+            bitbuffer_manchester_decode(bitbuffer, i, 0, tmp, len);
+            len = tmp->bits_per_row[0];
+            memcpy(bitbuffer->bb[i], tmp->bb[0], (len + 7) / 8); // safe to write over: can only be shorter
             bitbuffer->bits_per_row[i] = len;
         }
     }
@@ -624,6 +713,8 @@ static void parse_getter(const char *arg, struct flex_get *getter)
         fprintf(stderr, "Bad flex spec, \"get\" missing name!\n");
         usage();
     }
+
+    compile_getter(getter);
     /*
         fprintf(stderr, "parse_getter() bit_offset: %d bit_count: %d mask: %lx name: %s\n",
                 getter->bit_offset, getter->bit_count, getter->mask, getter->name);
@@ -758,9 +849,16 @@ r_device *flex_create_device(char *spec)
     if (params->min_bits < params->match_len)
         params->min_bits = params->match_len;
 
+    bitbuffer_pattern_compile(&params->match_pattern, params->match_bits, params->match_len);
+    bitbuffer_pattern_compile(&params->preamble_pattern, params->preamble_bits, params->preamble_len);
+
     if (params->min_bits > 0 && params->min_repeats < 1)
         params->min_repeats = 1;
 
+    // without a minimum length rows without bits might match
+    if (!params->min_bits)
+        dev->no_prefilter = 1;
+
     // add getter fields if unique requested
     if (params->unique) {
         int i = 0;
@@ -834,3 +932,171 @@ r_device *flex_create_device(char *spec)
     free(spec);
     return dev;
 }
+
+// Unit testing
+#ifdef _TEST
+
+#define FLEX_TEST_PACKAGES 2000
+
+static unsigned flex_test_outputs;
+static uint32_t flex_test_sum;
+
+/// Hash the JSON of each output, FNV-1a.
+static void flex_test_output(r_device *decoder, data_t *data)
+{
+    (void)decoder;
+    char buf[4096];
+    size_t len = data_print_jsons(data, buf, sizeof(buf));
+    for (size_t i = 0; i < len; ++i) {
+        flex_test_sum = (flex_test_sum ^ (uint8_t)buf[i]) * 16777619u;
+    }
+    flex_test_outputs++;
+    data_free(data);
+}
+
+/// Run the decoder on all packages, returns the hash of the outputs.
+static uint32_t flex_test_run(r_device *dev, bitbuffer_t const *packages, unsigned num_packages)
+{
+    static bitbuffer_t work;
+    flex_test_outputs = 0;
+    flex_test_sum     = 2166136261u;
+    for (unsigned k = 0; k < num_packages; ++k) {
+        bitbuffer_copy(&work, &packages[k]);
+        dev->decode_fn(dev, &work);
+    }
+    return flex_test_sum;
+}
+
+/// Typical lengths and some noise, repeated rows in half of the packages.
+static void flex_test_package(bitbuffer_t *bits)
+{
+    unsigned const lens[] = {12, 24, 25, 32, 36, 40, 42, 48, 56, 64, 65, 72, 80, 88, 96, 128};
+    bitbuffer_clear(bits);
+    unsigned num_rows = 1 + rand() % 8;
+    unsigned len      = rand() % 4 ? lens[rand() % 16] : 1 + (unsigned)rand() % 160;
+    int repeated      = rand() % 2;
+    uint8_t row[BITBUF_COLS];
+    for (unsigned r = 0; r < num_rows; ++r) {
+        if (r == 0 || !repeated) {
+            for (unsigned i = 0; i < BITBUF_COLS; ++i) {
+                row[i] = rand() & 0xff;
+            }
+        }
+        if (r > 0)
+            bitbuffer_add_row(bits);
+        for (unsigned b = 0; b < len; ++b) {
+            bitbuffer_add_bit(bits, row[b / 8] >> (7 - b % 8) & 1);
+        }
+    }
+}
+
+int main(void)
+{
+    unsigned passed = 0;
+    unsigned failed = 0;
+
+    fprintf(stderr, "flex:: test\n");
+    srand(1);
+
+    fprintf(stderr, "TEST: flex:: Getter plans against extract_number() and compact_number()\n");
+    uint8_t bytes[32];
+    unsigned diffs = 0;
+    for (int t = 0; t < 200000; ++t) {
+        for (unsigned i = 0; i < sizeof(bytes); ++i) {
+            bytes[i] = rand() & 0xff;
+        }
+        struct flex_get getter = {0};
+        getter.bit_offset = rand() % 64;
+        getter.bit_count  = 1 + rand() % (sizeof(unsigned long) * 8);
+        if (rand() % 2)
+            getter.mask = ((unsigned long)rand() << 8 ^ rand()) & (0x7fffffff >> rand() % 31);
+        compile_getter(&getter);
+        if (!getter.num_bytes)
+            continue;
+        unsigned long want = getter.mask ? compact_number(bytes, getter.bit_offset, getter.mask)
+                                         : extract_number(bytes, getter.bit_offset, getter.bit_count);
+        if (planned_number(bytes, &getter) != want)
+            diffs++;
+    }
+    if (diffs) {
+        fprintf(stderr, "FAIL: %u getter plans differ\n", diffs);
+        failed++;
+    }
+    else {
+        passed++;
+    }
+
+    fprintf(stderr, "TEST: flex:: Decoder output with and without the getter plans\n");
+    char const *const specs[] = {
+            "n=plain,m=OOK_PWM,s=100,l=200,r=500,get=@0:{8}:id,get=@8:{4}:ch,get=@13:{11}:temp:%d,get=@3:{32}:all",
+            "n=masked,m=OOK_PWM,s=100,l=200,r=500,bits>=24,get=@1:{12}0xf0f:id,get=@5:{16}0x8001:flags,get=@0:{24}0x5a5a5a:odd",
+            "n=mapped,m=OOK_PWM,s=100,l=200,r=500,bits>=12,get=@0:{2}:button:[0:none 1:one 2:two 3:both],get=@2:{6}:code",
+            "n=repeats,m=OOK_PWM,s=100,l=200,r=500,bits>=24,repeats>=2,get=@0:{24}:id,get=@7:{9}:val",
+            "n=once,m=OOK_PWM,s=100,l=200,r=500,bits>=32,bits<=72,repeats>=1,unique,get=@0:{16}:id",
+            "n=aligned,m=OOK_PWM,s=100,l=200,r=500,invert,reflect,preamble={4}0xa,get=@0:{12}:id,get=@12:{60}:long",
+            "n=manchester,m=OOK_PWM,s=100,l=200,r=500,bits>=16,decode_mc,get=@0:{8}:id,get=@4:{8}0xc3:mask",
+            "n=counted,m=OOK_PWM,s=100,l=200,r=500,rows>=2,countonly,get=@0:{4}:id",
+    };
+    unsigned const num_specs = sizeof(specs) / sizeof(*specs);
+    static bitbuffer_t packages[FLEX_TEST_PACKAGES];
+    for (unsigned k = 0; k < FLEX_TEST_PACKAGES; ++k) {
+        flex_test_package(&packages[k]);
+    }
+    for (unsigned s = 0; s < num_specs; ++s) {
+        char spec[256];
+        snprintf(spec, sizeof(spec), "%s", specs[s]);
+        r_device *dev = flex_create_device(spec);
+        if (!dev) {
+            fprintf(stderr, "FAIL: spec \"%s\"\n", specs[s]);
+            failed++;
+            continue;
+        }
+        dev->output_fn             = flex_test_output;
+        struct flex_params *params = decoder_user_data(dev);
+
+        uint32_t planned_sum     = flex_test_run(dev, packages, FLEX_TEST_PACKAGES);
+        unsigned planned_outputs = flex_test_outputs;
+
+        // without plans the getters use the generic extract
+        for (int g = 0; g < GETTER_SLOTS; ++g) {
+            params->getter[g].num_bytes = 0;
+        }
+        uint32_t generic_sum = flex_test_run(dev, packages, FLEX_TEST_PACKAGES);
+        if (!planned_outputs || planned_outputs != flex_test_outputs || planned_sum != generic_sum) {
+            fprintf(stderr, "FAIL: output of \"%s\" differs without the getter plans (%u, %u outputs)\n",
+                    specs[s], planned_outputs, flex_test_outputs);
+            failed++;
+        }
+        else {
+            passed++;
+        }
+    }
+
+    fprintf(stderr, "TEST: flex:: First row with min bits against bitbuffer_find_repeated_row()\n");
+    diffs = 0;
+    for (unsigned k = 0; k < FLEX_TEST_PACKAGES; ++k) {
+        bitbuffer_t *bits = &packages[k];
+        unsigned min_bits = rand() % 100;
+        int r             = -1;
+        for (int i = 0; i < bits->num_rows; i++) {
+            if (bits->bits_per_row[i] >= min_bits) {
+                r = i;
+                break;
+            }
+        }
+        if (r != bitbuffer_find_repeated_row(bits, 1, min_bits) || r != bitbuffer_find_repeated_row(bits, 0, min_bits))
+            diffs++;
+    }
+    if (diffs) {
+        fprintf(stderr, "FAIL: %u packages differ in the first row\n", diffs);
+        failed++;
+    }
+    else {
+        passed++;
+    }
+
+    fprintf(stderr, "flex:: test (%u/%u) passed, (%u) failed.\n", passed, passed + failed, failed);
+
+    return failed;
+}
+#endif /* _TEST */
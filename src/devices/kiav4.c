@@ -7,11 +7,30 @@
 
     v3/4 uses keeloq keys which I am not going to distribute
     decoding will require the user to put in keys
+
+    Keys are read from a file given as decoder argument, `-R 294:kia_keys.txt` for
+    the OOK variant ("Kia V4") or `-R 295:kia_keys.txt` for the FSK variant ("Kia V4 (FSK)").
+    Each line holds a manufacturer key in hex and optionally the model it identifies,
+    e.g. `0123456789abcdef V4`, `#` starts a comment. Keys are tried in file order.
 */
 
 #include "decoder.h"
-                            //V4     V3
-uint64_t kia_3_4_mf_keys[] = {0x00, 0x00};
+#include <stdlib.h>
+
+/// A manufacturer key and the model it identifies.
+typedef struct kia_mf_key {
+    uint64_t key;
+    char model[8];
+} kia_mf_key_t;
+
+/// Manufacturer keys loaded from the key file.
+typedef struct kia_v4_keys {
+    unsigned num_keys;
+    kia_mf_key_t keys[];
+} kia_v4_keys_t;
+
+/// Keys decrypted in one batch, see keeloq_common_decrypt_keys().
+#define KIA_KEY_BATCH 64
 
 static int kia_v4_decode(r_device *decoder, bitbuffer_t *bitbuffer)
 {   
@@ -68,25 +87,32 @@ static int kia_v4_decode(r_device *decoder, bitbuffer_t *bitbuffer)
     snprintf(encrypted_str, sizeof(encrypted_str), "%08X", encrypted);
     char serial_str[9];
     snprintf(serial_str, sizeof(serial_str), "%07X", serial);
-    char model_str[] = "Kia 3/4";
+    char model_str[16] = "Kia 3/4";
     char decrypted_str[12];
     snprintf(decrypted_str, sizeof(decrypted_str), "%s", "Unknown");
     char mfkey_str[18];
     snprintf(mfkey_str, sizeof(mfkey_str), "%s", "Unknown");
 
-    if (kia_3_4_mf_keys[0] != 0x00) {
-        for (size_t j = 0; j < 2; j++){ 
-            uint32_t block = keeloq_common_decrypt(encrypted, kia_3_4_mf_keys[j]);
+    kia_v4_keys_t const *mf = decoder_user_data(decoder);
+    unsigned num_keys = mf ? mf->num_keys : 0;
+    int found = 0;
+    for (unsigned base = 0; base < num_keys && !found; base += KIA_KEY_BATCH) {
+        // decrypt a batch of keys at once, then take the first match in key order
+        uint64_t batch[KIA_KEY_BATCH];
+        uint32_t blocks[KIA_KEY_BATCH];
+        unsigned n = num_keys - base < KIA_KEY_BATCH ? num_keys - base : KIA_KEY_BATCH;
+        for (unsigned j = 0; j < n; j++) {
+            batch[j] = mf->keys[base + j].key;
+        }
+        keeloq_common_decrypt_keys(encrypted, batch, n, blocks);
+
+        for (unsigned j = 0; j < n; j++) {
+            uint32_t block = blocks[j];
             if (((uint8_t)(btn) == (uint8_t)(block >> 28)) && ((uint8_t)(serial & 0x00000FF)) == ((uint8_t)((block & 0x00FF0000) >> 16))) {
                 snprintf(decrypted_str, sizeof(decrypted_str), "%08X", block);
-                snprintf(mfkey_str, sizeof(mfkey_str), "%08lX", kia_3_4_mf_keys[j]);
-            
-                if (kia_3_4_mf_keys[j] == kia_3_4_mf_keys[0]) {
-                    snprintf(model_str, sizeof(model_str), "%s", "Kia V4");
-                }
-                else {
-                    snprintf(model_str, sizeof(model_str), "%s", "Kia V3");
-                }
+                snprintf(mfkey_str, sizeof(mfkey_str), "%08lX", batch[j]);
+                snprintf(model_str, sizeof(model_str), "Kia %s", mf->keys[base + j].model);
+                found = 1;
                 break;
             }
         }
@@ -122,6 +148,75 @@ static char const *const output_fields[] = {
         NULL,
 };
 
+/// Parse a key file line, returns 1 for a key, 0 for a blank or comment line, -1 on errors.
+static int kia_v4_parse_key(char const *line, kia_mf_key_t *k)
+{
+    char const *p = line + strspn(line, " \t");
+    if (!*p || strchr("#\r\n", *p))
+        return 0;
+
+    char *end;
+    k->key = strtoull(p, &end, 16);
+    if (end == p || (*end && !strchr(" \t\r\n#", *end)))
+        return -1;
+
+    p = end + strspn(end, " \t");
+    size_t len = strcspn(p, " \t\r\n#");
+    if (!len || len >= sizeof(k->model))
+        snprintf(k->model, sizeof(k->model), "%s", "3/4");
+    else
+        snprintf(k->model, sizeof(k->model), "%.*s", (int)len, p);
+    return 1;
+}
+
+/// Read the manufacturer keys, exits on errors as for a bad decoder spec.
+static r_device *kia_v4_create_with(r_device const *dev_template, char *arg)
+{
+    if (!arg || !*arg) {
+        return decoder_create(dev_template, 0); // NOTE: returns NULL on alloc failure.
+    }
+
+    FILE *fp = fopen(arg, "r");
+    if (!fp) {
+        fprintf(stderr, "%s: can't open key file \"%s\"\n", dev_template->name, arg);
+        exit(1);
+    }
+
+    // count the keys first to size the decoder data
+    char line[256];
+    kia_mf_key_t k;
+    unsigned num_keys = 0;
+    unsigned lineno   = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        lineno++;
+        int ret = kia_v4_parse_key(line, &k);
+        if (ret < 0) {
+            fprintf(stderr, "%s: bad key in \"%s\" line %u\n", dev_template->name, arg, lineno);
+            exit(1);
+        }
+        num_keys += ret;
+    }
+
+    r_device *r_dev = decoder_create(dev_template, sizeof(kia_v4_keys_t) + num_keys * sizeof(kia_mf_key_t));
+    if (!r_dev) {
+        fclose(fp);
+        return NULL; // NOTE: returns NULL on alloc failure.
+    }
+    kia_v4_keys_t *mf = decoder_user_data(r_dev);
+
+    rewind(fp);
+    while (mf->num_keys < num_keys && fgets(line, sizeof(line), fp)) {
+        if (kia_v4_parse_key(line, &k) > 0)
+            mf->keys[mf->num_keys++] = k;
+    }
+    fclose(fp);
+
+    return r_dev;
+}
+
+static r_device *kia_v4_create(char *arg);
+static r_device *kia_v4_fsk_create(char *arg);
+
 //Don't think v4 is ever OOK
 //but might as well check
 r_device const kia_v4 = {
@@ -133,6 +228,7 @@ r_device const kia_v4 = {
         .reset_limit = 9000,
         .tolerance   = 152, // us
         .decode_fn   = &kia_v4_decode,
+        .create_fn   = &kia_v4_create,
         .fields      = output_fields,
 };
 
@@ -145,5 +241,16 @@ r_device const kia_v4_fsk = {
         .reset_limit = 9000,
         .tolerance   = 152, // us
         .decode_fn   = &kia_v4_decode,
+        .create_fn   = &kia_v4_fsk_create,
         .fields      = output_fields,
 };
+
+static r_device *kia_v4_create(char *arg)
+{
+    return kia_v4_create_with(&kia_v4, arg);
+}
+
+static r_device *kia_v4_fsk_create(char *arg)
+{
+    return kia_v4_create_with(&kia_v4_fsk, arg);
+}
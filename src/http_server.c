@@ -64,6 +64,11 @@ or `(echo "GET /stream HTTP/1.0\n"; sleep 600) | socat - tcp:127.0.0.1:8433`
     .reset_limit
     .fields
 
+- "get_decoder_order"
+    .adaptive   half-life in packages of the adaptive order, 0: off
+    .ook, .fsk  per priority the decoders in run order
+                with .num .name .hits (decayed) .always
+
 - "device_info"
     device  0:  Realtek, RTL2838UHIDIR, SN: 00000001
     Found Rafael Micro R820T tuner
@@ -249,6 +254,48 @@ static data_t *meta_data(r_cfg_t *cfg)
             NULL);
 }
 
+static data_array_t *dispatch_order_data(r_dispatch_t const *dispatch)
+{
+    list_t groups = {0};
+    list_ensure_size(&groups, dispatch->num_groups);
+
+    unsigned i = 0;
+    for (unsigned g = 0; g < dispatch->num_groups; ++g) {
+        list_t devs = {0};
+        list_ensure_size(&devs, dispatch->group_end[g] - i);
+        unsigned priority = dispatch->entries[dispatch->order[i]].r_dev->priority;
+        for (; i < dispatch->group_end[g]; ++i) {
+            r_dispatch_entry_t const *entry = &dispatch->entries[dispatch->order[i]];
+            data_t *data = data_make(
+                    "num", "", DATA_INT, entry->r_dev->protocol_num,
+                    "name", "", DATA_STRING, entry->r_dev->name,
+                    "hits", "", DATA_DOUBLE, dispatch->hit_weight > 0.0 ? entry->hits / dispatch->hit_weight : 0.0,
+                    "always", "", DATA_INT, entry->always,
+                    NULL);
+            list_push(&devs, data);
+        }
+        data_t *data = data_make(
+                "priority", "", DATA_INT, priority,
+                "decoders", "", DATA_ARRAY, data_array(devs.len, DATA_DATA, devs.elems),
+                NULL);
+        list_free_elems(&devs, NULL);
+        list_push(&groups, data);
+    }
+
+    data_array_t *array = data_array(groups.len, DATA_DATA, groups.elems);
+    list_free_elems(&groups, NULL);
+    return array;
+}
+
+static data_t *decoder_order_data(r_cfg_t *cfg)
+{
+    return data_make(
+            "adaptive", "", DATA_INT, cfg->demod->adaptive_half_life,
+            "ook", "", DATA_ARRAY, dispatch_order_data(&cfg->demod->ook_dispatch),
+            "fsk", "", DATA_ARRAY, dispatch_order_data(&cfg->demod->fsk_dispatch),
+            NULL);
+}
+
 static data_t *protocols_data(r_cfg_t *cfg)
 {
     list_t devs = {0};
@@ -573,6 +620,13 @@ static void rpc_exec(rpc_t *rpc, r_cfg_t *cfg)
         rpc->response(rpc, 1, buf, 0);
         data_free(data);
     }
+    else if (!strcmp(rpc->method, "get_decoder_order")) {
+        char buf[102400]; // we expect the order string to be around 50k bytes.
+        data_t *data = decoder_order_data(cfg);
+        data_print_jsons(data, buf, sizeof(buf));
+        rpc->response(rpc, 1, buf, 0);
+        data_free(data);
+    }
     else if (!strcmp(rpc->method, "get_protocols")) {
         char buf[102400]; // we expect the protocol string to be around 80k bytes.
         data_t *data = protocols_data(cfg);
@@ -735,6 +789,79 @@ static void handle_redirect(struct mg_connection *nc, struct http_message *hm)
             "\r\n\r\n");
 }
 
+#ifdef DECODER_PROFILING
+// append a label value, escaping backslash, double-quote, and line feed
+static void metrics_label(abuf_t *buf, char const *str)
+{
+    for (; *str; ++str) {
+        if (*str == '\\' || *str == '"')
+            abuf_printf(buf, "\\%c", *str);
+        else if (*str == '\n')
+            abuf_cat(buf, "\\n");
+        else
+            abuf_printf(buf, "%c", *str);
+    }
+}
+#endif
+
+// per decoder run time series, the returned buffer needs to be freed
+static char *decoder_metrics(r_cfg_t *cfg, size_t *len)
+{
+    *len = 0;
+#ifdef DECODER_PROFILING
+    list_t *r_devs = &cfg->demod->r_devs;
+
+    // three series per decoder, the name escaped to at most twice its length
+    size_t size = 1000;
+    for (void **iter = r_devs->elems; iter && *iter; ++iter) {
+        r_device *r_dev = *iter;
+        size += 3 * (100 + 2 * strlen(r_dev->name));
+    }
+    char *dec_buf = malloc(size);
+    if (!dec_buf) {
+        WARN_MALLOC("decoder_metrics()");
+        return NULL;
+    }
+    abuf_t buf;
+    abuf_init(&buf, dec_buf, size);
+
+    static char const *const series[] = {"decoder_calls", "decoder_run_seconds", "decoder_decode_seconds"};
+    static char const *const headers[] = {
+            "# TYPE decoder_calls counter\n"
+            "# UNIT decoder_calls packages\n"
+            "# HELP decoder_calls Number of packages sliced for the decoder.\n",
+            "# TYPE decoder_run_seconds counter\n"
+            "# UNIT decoder_run_seconds seconds\n"
+            "# HELP decoder_run_seconds Wall time spent slicing and decoding packages.\n",
+            "# TYPE decoder_decode_seconds counter\n"
+            "# UNIT decoder_decode_seconds seconds\n"
+            "# HELP decoder_decode_seconds Wall time spent in the decoder callback.\n",
+    };
+    for (unsigned s = 0; s < 3; ++s) {
+        abuf_cat(&buf, headers[s]);
+        for (void **iter = r_devs->elems; iter && *iter; ++iter) {
+            r_device *r_dev = *iter;
+            unsigned calls  = r_dev->profile_total.calls + r_dev->profile.calls;
+            if (!calls)
+                continue;
+            abuf_printf(&buf, "%s_total{protocol=\"%u\",name=\"", series[s], r_dev->protocol_num);
+            metrics_label(&buf, r_dev->name);
+            if (s == 0)
+                abuf_printf(&buf, "\"} %u\n", calls);
+            else if (s == 1)
+                abuf_printf(&buf, "\"} %.9f\n", (r_dev->profile_total.slice_ns + r_dev->profile.slice_ns) * 1e-9);
+            else
+                abuf_printf(&buf, "\"} %.9f\n", (r_dev->profile_total.decode_ns + r_dev->profile.decode_ns) * 1e-9);
+        }
+    }
+    *len = (size_t)(buf.tail - dec_buf);
+    return dec_buf;
+#else
+    (void)cfg;
+    return NULL;
+#endif
+}
+
 static void handle_openmetrics(struct mg_connection *nc, struct http_message *hm)
 {
     if (mg_vcmp(&hm->method, "GET") != 0) {
@@ -783,7 +910,10 @@ static void handle_openmetrics(struct mg_connection *nc, struct http_message *hm
             "# UNIT input_event_frames frames\n"
             "# HELP input_event_frames Number of SDR frames with decode events.\n"
             "input_event_frames_total %u\n"
-            "# EOF\n",
+            "# TYPE input_rejected_packages counter\n"
+            "# UNIT input_rejected_packages packages\n"
+            "# HELP input_rejected_packages Number of packages rejected as spurious before decoding.\n"
+            "input_rejected_packages_total %u\n",
             (float)(now - cfg->running_since), // uptime_seconds_total,
             (float)cfg->running_since,         // uptime_seconds_created,
             (unsigned)cfg->demod->r_devs.len,  // decoder_enabled,
@@ -793,16 +923,25 @@ static void handle_openmetrics(struct mg_connection *nc, struct http_message *hm
             cfg->total_frames_squelch,         // input_squelch_frames_total,
             cfg->total_frames_ook,             // input_ook_frames_total,
             cfg->total_frames_fsk,             // input_fsk_frames_total,
-            cfg->total_frames_events);         // input_event_frames_total,
+            cfg->total_frames_events,          // input_event_frames_total,
+            cfg->total_frames_rejected);       // input_rejected_packages_total,
+
+    size_t dec_len = 0;
+    char *dec_buf  = decoder_metrics(cfg, &dec_len);
+    static char const eof[] = "# EOF\n";
 
     mg_printf(nc,
             "HTTP/1.1 200 OK\r\n"
             "Content-Length: %u\r\n"
             "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
             "\r\n",
-            len);
+            (unsigned)(len + dec_len + sizeof(eof) - 1));
     mg_send(nc, buf, (size_t)len);
+    if (dec_buf)
+        mg_send(nc, dec_buf, dec_len);
+    mg_send(nc, eof, sizeof(eof) - 1);
     nc->flags |= MG_F_SEND_AND_CLOSE;
+    free(dec_buf);
 }
 
 // reply to ws command
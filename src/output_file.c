@@ -321,7 +321,7 @@ static void R_API_CALLCONV print_kv_data(data_output_t *output, data_t *data, ch
         }
 
         // print key
-        char *key = *data->pretty_key ? data->pretty_key : data->key;
+        char const *key = *data->pretty_key ? data->pretty_key : data->key;
         kv->column += fprintf(kv->file, "%-10s: ", key);
         // print value
         if (color)
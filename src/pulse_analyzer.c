@@ -17,25 +17,8 @@
 #include <string.h>
 #include <limits.h>
 
-#define MAX_HIST_BINS 16
-
-/// Histogram data for single bin
-typedef struct {
-    unsigned count;
-    int sum;
-    int mean;
-    int min;
-    int max;
-} hist_bin_t;
-
-/// Histogram data for all bins
-typedef struct {
-    unsigned bins_count;
-    hist_bin_t bins[MAX_HIST_BINS];
-} histogram_t;
-
 /// Generate a histogram (unsorted)
-static void histogram_sum(histogram_t *hist, int const *data, unsigned len, float tolerance)
+void histogram_sum(histogram_t *hist, int const *data, unsigned len, float tolerance)
 {
     unsigned bin;    // Iterator will be used outside for!
 
@@ -62,6 +45,9 @@ static void histogram_sum(histogram_t *hist, int const *data, unsigned len, floa
             hist->bins[bin].max        = data[n];
             hist->bins_count++;
         } // for bin
+        else if (bin == hist->bins_count) {
+            hist->dropped++;
+        }
     } // for data
 }
 
@@ -25,6 +25,7 @@
 #define OOK_MAX_LOW_LEVEL   DB_TO_AMP(-15) // Maximum estimate for low level
 #define OOK_EST_HIGH_RATIO  64          // Constant for slowness of OOK high level estimator
 #define OOK_EST_LOW_RATIO   1024        // Constant for slowness of OOK low level (noise) estimator (very slow)
+#define OOK_IDLE_BLOCK_LEN  64          // Samples per block in the idle pre-scan
 
 /// Internal state data for pulse_pulse_package()
 struct pulse_detect {
@@ -50,6 +51,8 @@ struct pulse_detect {
 
     int verbosity; ///< Debug output verbosity, 0=None, 1=Levels, 2=Histograms
 
+    unsigned rejected_count; ///< Package starts dropped as a spurious short pulse
+
     pulse_detect_fsk_t pulse_detect_fsk;
 };
 
@@ -83,6 +86,13 @@ void pulse_detect_reset(pulse_detect_t *pulse_detect)
     pulse_detect_fsk_init(&pulse_detect->pulse_detect_fsk);
 }
 
+unsigned pulse_detect_take_rejected(pulse_detect_t *pulse_detect)
+{
+    unsigned rejected = pulse_detect->rejected_count;
+    pulse_detect->rejected_count = 0;
+    return rejected;
+}
+
 void pulse_detect_set_levels(pulse_detect_t *pulse_detect, int use_mag_est, float fixed_high_level, float min_high_level, float high_low_ratio, int verbosity)
 {
     pulse_detect->use_mag_est = use_mag_est;
@@ -195,6 +205,56 @@ static void print_att_hist(char const *s, int att_hist[])
     }
 }
 
+/// OOK trigger level for a low (noise) estimate, as computed by the state machine when idle.
+static int ook_trigger_level(pulse_detect_t const *pulse_detect, int ook_low_estimate)
+{
+    int ook_high_estimate = MAX(pulse_detect->ook_high_low_ratio * ook_low_estimate, pulse_detect->ook_min_high_level);
+    int16_t ook_threshold = (ook_low_estimate + MIN(ook_high_estimate, OOK_MAX_HIGH_LEVEL)) / 2;
+    if (pulse_detect->ook_fixed_high_level != 0) {
+        ook_threshold = pulse_detect->ook_fixed_high_level; // Manual override
+    }
+    int16_t const ook_hysteresis = ook_threshold / 8; // +-12%
+    return ook_threshold + ook_hysteresis;
+}
+
+/** Skip idle blocks that can not contain a pulse start.
+
+    The low estimate moves at most (low - min) / OOK_EST_LOW_RATIO + 1 down per sample,
+    the trigger level at that lower bound is checked against the block maximum.
+    Skipped samples only update the noise estimate, exactly as the state machine would.
+*/
+static void ook_idle_skip(pulse_detect_t *s, int16_t const *envelope_data, int len)
+{
+    while (s->data_counter + OOK_IDLE_BLOCK_LEN <= len) {
+        int16_t const *block = &envelope_data[s->data_counter];
+        int16_t am_min;
+        int16_t am_max;
+        baseband_level_range(block, OOK_IDLE_BLOCK_LEN, &am_min, &am_max);
+        int const low_drop = (MAX(s->ook_low_estimate - am_min, 0) / OOK_EST_LOW_RATIO + 1) * OOK_IDLE_BLOCK_LEN;
+        if (am_max > ook_trigger_level(s, s->ook_low_estimate - low_drop)) {
+            break; // the state machine needs to see this block
+        }
+        int low = s->ook_low_estimate;
+        if (am_max - (low - OOK_IDLE_BLOCK_LEN) < OOK_EST_LOW_RATIO && (low + OOK_IDLE_BLOCK_LEN) - am_min < OOK_EST_LOW_RATIO) {
+            // the estimate stays within the block length, every delta is below the ratio and the update is a unit step
+            for (int i = 0; i < OOK_IDLE_BLOCK_LEN; ++i) {
+                low += 2 * (block[i] > low) - 1;
+            }
+        }
+        else {
+            for (int i = 0; i < OOK_IDLE_BLOCK_LEN; ++i) {
+                int const ook_low_delta = block[i] - low;
+                low += ook_low_delta / OOK_EST_LOW_RATIO;
+                low += ((ook_low_delta > 0) ? 1 : -1);
+            }
+        }
+        s->ook_low_estimate = low;
+        s->ook_high_estimate = s->ook_high_low_ratio * s->ook_low_estimate;
+        s->ook_high_estimate = MAX(s->ook_high_estimate, s->ook_min_high_level);
+        s->data_counter += OOK_IDLE_BLOCK_LEN;
+    }
+}
+
 /// Demodulate On/Off Keying (OOK) and Frequency Shift Keying (FSK) from an envelope signal
 int pulse_detect_package(pulse_detect_t *pulse_detect, int16_t const *envelope_data, int16_t const *fm_data, int len, uint32_t samp_rate, uint64_t sample_offset, pulse_data_t *pulses, pulse_data_t *fsk_pulses, unsigned fpdm)
 {
@@ -210,8 +270,19 @@ int pulse_detect_package(pulse_detect_t *pulse_detect, int16_t const *envelope_d
     }
 
     int eop_on_spurious = 0;
+    int idle_scan_from  = s->data_counter; // blocks before this were rejected by the idle pre-scan
     // Process all new samples
     while (s->data_counter < len) {
+        // Skip ahead to the next possible pulse start when settled and idle, not while gathering the histogram
+        if (s->ook_state == PD_OOK_STATE_IDLE && s->data_counter >= idle_scan_from
+                && s->lead_in_counter > OOK_EST_LOW_RATIO
+                && s->ook_high_estimate == MAX(s->ook_high_low_ratio * s->ook_low_estimate, s->ook_min_high_level)
+                && pulse_detect->verbosity < LOG_NOTICE) {
+            ook_idle_skip(s, envelope_data, len);
+            idle_scan_from = s->data_counter + OOK_IDLE_BLOCK_LEN;
+            if (s->data_counter >= len)
+                break;
+        }
         // Calculate OOK detection threshold and hysteresis
         int16_t const am_n    = envelope_data[s->data_counter];
         if (pulse_detect->verbosity >= LOG_NOTICE) {
@@ -263,6 +334,7 @@ int pulse_detect_package(pulse_detect_t *pulse_detect, int16_t const *envelope_d
                         if (pulses->num_pulses <= 1) {
                             // if this was the first pulse go back to idle
                             s->ook_state = PD_OOK_STATE_IDLE;
+                            s->rejected_count += 1;
                         } else {
                             // otherwise emit a package, which then goes back to idle
                             eop_on_spurious = 1;
@@ -12,13 +12,18 @@
 */
 
 #include "pulse_slicer.h"
+#include "pulse_analyzer.h"
 #include "pulse_data.h"
 #include "bitbuffer.h"
 #include "c_util.h" // for MIN()
 #include "logger.h"
 #include "decoder_util.h" // TODO: this should be refactored
+#include "fatal.h"
+#include "compat_time.h"
+#include "compat_pthread.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdint.h>
 #include <math.h>
 #include <limits.h>
@@ -28,7 +33,13 @@ static int account_event(r_device *device, bitbuffer_t *bits, char const *demod_
     // run decoder
     int ret = 0;
     if (device->decode_fn) {
+#ifdef DECODER_PROFILING
+        uint64_t start = monotonic_ns();
         ret = device->decode_fn(device, bits);
+        device->profile.decode_ns += monotonic_ns() - start;
+#else
+        ret = device->decode_fn(device, bits);
+#endif
     }
 
     // statistics accounting
@@ -62,6 +73,100 @@ static int account_event(r_device *device, bitbuffer_t *bits, char const *demod_
     return ret;
 }
 
+/// Bitbuffer for the slicers, one per thread to not clear 6 KB on the stack for every call.
+static THREAD_LOCAL bitbuffer_t slicer_bits;
+
+/// Get the cleared slicer bitbuffer, only the rows written by the last slicer are cleared.
+static bitbuffer_t *slicer_bitbuffer(void)
+{
+    bitbuffer_clear(&slicer_bits);
+    return &slicer_bits;
+}
+
+/// Lower and upper bounds (non inclusive) of the PPM gaps and PWM pulses.
+typedef struct slicer_bounds {
+    int zero_l, zero_u;
+    int one_l, one_u;
+    int sync_l, sync_u;
+} slicer_bounds_t;
+
+static slicer_bounds_t ppm_bounds(int s_short, int s_long, int s_reset, int s_gap, int s_sync, int s_tolerance)
+{
+    slicer_bounds_t b = {0};
+
+    if (s_tolerance > 0) {
+        // precise
+        b.zero_l = s_short - s_tolerance;
+        b.zero_u = s_short + s_tolerance;
+        b.one_l  = s_long - s_tolerance;
+        b.one_u  = s_long + s_tolerance;
+        if (s_sync > 0) {
+            b.sync_l = s_sync - s_tolerance;
+            b.sync_u = s_sync + s_tolerance;
+        }
+    }
+    else {
+        // no sync, short=0, long=1
+        b.zero_l = 0;
+        b.zero_u = (s_short + s_long) / 2 + 1;
+        b.one_l  = b.zero_u - 1;
+        b.one_u  = s_gap ? s_gap : s_reset;
+    }
+    return b;
+}
+
+static slicer_bounds_t pwm_bounds(int s_short, int s_long, int s_sync, int s_tolerance)
+{
+    slicer_bounds_t b = {0};
+
+    if (s_tolerance > 0) {
+        // precise
+        b.one_l  = s_short - s_tolerance;
+        b.one_u  = s_short + s_tolerance;
+        b.zero_l = s_long - s_tolerance;
+        b.zero_u = s_long + s_tolerance;
+        if (s_sync > 0) {
+            b.sync_l = s_sync - s_tolerance;
+            b.sync_u = s_sync + s_tolerance;
+        }
+    }
+    else if (s_sync <= 0) {
+        // no sync, short=1, long=0
+        b.one_l  = 0;
+        b.one_u  = (s_short + s_long) / 2 + 1;
+        b.zero_l = b.one_u - 1;
+        b.zero_u = INT_MAX;
+    }
+    else if (s_sync < s_short) {
+        // short=sync, middle=1, long=0
+        b.sync_l = 0;
+        b.sync_u = (s_sync + s_short) / 2 + 1;
+        b.one_l  = b.sync_u - 1;
+        b.one_u  = (s_short + s_long) / 2 + 1;
+        b.zero_l = b.one_u - 1;
+        b.zero_u = INT_MAX;
+    }
+    else if (s_sync < s_long) {
+        // short=1, middle=sync, long=0
+        b.one_l  = 0;
+        b.one_u  = (s_short + s_sync) / 2 + 1;
+        b.sync_l = b.one_u - 1;
+        b.sync_u = (s_sync + s_long) / 2 + 1;
+        b.zero_l = b.sync_u - 1;
+        b.zero_u = INT_MAX;
+    }
+    else {
+        // short=1, middle=0, long=sync
+        b.one_l  = 0;
+        b.one_u  = (s_short + s_long) / 2 + 1;
+        b.zero_l = b.one_u - 1;
+        b.zero_u = (s_long + s_sync) / 2 + 1;
+        b.sync_l = b.zero_u - 1;
+        b.sync_u = INT_MAX;
+    }
+    return b;
+}
+
 int pulse_slicer_pcm(pulse_data_t const *pulses, r_device *device)
 {
     float samples_per_us = pulses->sample_rate / 1.0e6f;
@@ -88,7 +193,7 @@ int pulse_slicer_pcm(pulse_data_t const *pulses, r_device *device)
     float f_long  = device->long_width > 0.0f ? 1.0f / (device->long_width * samples_per_us) : 0;
 
     int events = 0;
-    bitbuffer_t bits = {0};
+    bitbuffer_t *bits = slicer_bitbuffer();
 
     int const gap_limit = s_gap ? s_gap : s_reset;
     int const max_zeros = gap_limit / s_long;
@@ -218,13 +323,13 @@ int pulse_slicer_pcm(pulse_data_t const *pulses, r_device *device)
         int lows = (pulses->gap[n] + s_short - s_long) * f_long + 0.5f;
 
         // Add run of ones (1 for RZ, many for NRZ)
-        for (int i = 0; i < highs; ++i) {
-            bitbuffer_add_bit(&bits, 1);
+        if (highs > 0) {
+            bitbuffer_add_bits(bits, 1, highs);
         }
         // Add run of zeros, handle possibly negative "lows" gracefully
         lows = MIN(lows, max_zeros); // Don't overflow at end of message
-        for (int i = 0; i < lows; ++i) {
-            bitbuffer_add_bit(&bits, 0);
+        if (lows > 0) {
+            bitbuffer_add_bits(bits, 0, lows);
         }
 
         // Validate data
@@ -237,20 +342,20 @@ int pulse_slicer_pcm(pulse_data_t const *pulses, r_device *device)
                         n, pulses->pulse[n], pulses->gap[n],
                         pulses->pulse[n] + pulses->gap[n]);
             }
-            bitbuffer_clear(&bits);
+            bitbuffer_clear(bits);
         }
 
         // Check for new packet in multipacket
         else if (pulses->gap[n] > gap_limit && pulses->gap[n] <= s_reset) {
-            bitbuffer_add_row(&bits);
+            bitbuffer_add_row(bits);
         }
         // End of Message?
         if (((n == pulses->num_pulses - 1)                            // No more pulses? (FSK)
                     || (pulses->gap[n] > s_reset))      // Long silence (OOK)
-                && (bits.bits_per_row[0] > 0 || bits.num_rows > 1)) { // Only if data has been accumulated
+                && (bits->bits_per_row[0] > 0 || bits->num_rows > 1)) { // Only if data has been accumulated
 
-            events += account_event(device, &bits, __func__);
-            bitbuffer_clear(&bits);
+            events += account_event(device, bits, __func__);
+            bitbuffer_clear(bits);
         }
     } // for
     return events;
@@ -279,57 +384,38 @@ int pulse_slicer_ppm(pulse_data_t const *pulses, r_device *device)
     }
 
     int events = 0;
-    bitbuffer_t bits = {0};
+    bitbuffer_t *bits = slicer_bitbuffer();
 
-    // lower and upper bounds (non inclusive)
-    int zero_l, zero_u;
-    int one_l, one_u;
-    int sync_l = 0, sync_u = 0;
-
-    if (s_tolerance > 0) {
-        // precise
-        zero_l = s_short - s_tolerance;
-        zero_u = s_short + s_tolerance;
-        one_l  = s_long - s_tolerance;
-        one_u  = s_long + s_tolerance;
-        if (s_sync > 0) {
-            sync_l = s_sync - s_tolerance;
-            sync_u = s_sync + s_tolerance;
-        }
-    }
-    else {
-        // no sync, short=0, long=1
-        zero_l = 0;
-        zero_u = (s_short + s_long) / 2 + 1;
-        one_l  = zero_u - 1;
-        one_u  = s_gap ? s_gap : s_reset;
-    }
+    slicer_bounds_t bounds = ppm_bounds(s_short, s_long, s_reset, s_gap, s_sync, s_tolerance);
+    int const zero_l = bounds.zero_l, zero_u = bounds.zero_u;
+    int const one_l = bounds.one_l, one_u = bounds.one_u;
+    int const sync_l = bounds.sync_l, sync_u = bounds.sync_u;
 
     for (unsigned n = 0; n < pulses->num_pulses; ++n) {
         if (pulses->gap[n] > zero_l && pulses->gap[n] < zero_u) {
             // Short gap
-            bitbuffer_add_bit(&bits, 0);
+            bitbuffer_add_bit(bits, 0);
         }
         else if (pulses->gap[n] > one_l && pulses->gap[n] < one_u) {
             // Long gap
-            bitbuffer_add_bit(&bits, 1);
+            bitbuffer_add_bit(bits, 1);
         }
         else if (pulses->gap[n] > sync_l && pulses->gap[n] < sync_u) {
             // Sync gap
-            bitbuffer_add_sync(&bits);
+            bitbuffer_add_sync(bits);
         }
 
         // Check for new packet in multipacket
         else if (pulses->gap[n] < s_reset) {
-            bitbuffer_add_row(&bits);
+            bitbuffer_add_row(bits);
         }
         // End of Message?
         if (((n == pulses->num_pulses - 1)                            // No more pulses? (FSK)
                     || (pulses->gap[n] >= s_reset))     // Long silence (OOK)
-                && (bits.bits_per_row[0] > 0 || bits.num_rows > 1)) { // Only if data has been accumulated
+                && (bits->bits_per_row[0] > 0 || bits->num_rows > 1)) { // Only if data has been accumulated
 
-            events += account_event(device, &bits, __func__);
-            bitbuffer_clear(&bits);
+            events += account_event(device, bits, __func__);
+            bitbuffer_clear(bits);
         }
     } // for pulses
     return events;
@@ -358,91 +444,45 @@ int pulse_slicer_pwm(pulse_data_t const *pulses, r_device *device)
     }
 
     int events = 0;
-    bitbuffer_t bits = {0};
-
-    // lower and upper bounds (non inclusive)
-    int one_l, one_u;
-    int zero_l, zero_u;
-    int sync_l = 0, sync_u = 0;
+    bitbuffer_t *bits = slicer_bitbuffer();
 
-    if (s_tolerance > 0) {
-        // precise
-        one_l  = s_short - s_tolerance;
-        one_u  = s_short + s_tolerance;
-        zero_l = s_long - s_tolerance;
-        zero_u = s_long + s_tolerance;
-        if (s_sync > 0) {
-            sync_l = s_sync - s_tolerance;
-            sync_u = s_sync + s_tolerance;
-        }
-    }
-    else if (s_sync <= 0) {
-        // no sync, short=1, long=0
-        one_l  = 0;
-        one_u  = (s_short + s_long) / 2 + 1;
-        zero_l = one_u - 1;
-        zero_u = INT_MAX;
-    }
-    else if (s_sync < s_short) {
-        // short=sync, middle=1, long=0
-        sync_l = 0;
-        sync_u = (s_sync + s_short) / 2 + 1;
-        one_l  = sync_u - 1;
-        one_u  = (s_short + s_long) / 2 + 1;
-        zero_l = one_u - 1;
-        zero_u = INT_MAX;
-    }
-    else if (s_sync < s_long) {
-        // short=1, middle=sync, long=0
-        one_l  = 0;
-        one_u  = (s_short + s_sync) / 2 + 1;
-        sync_l = one_u - 1;
-        sync_u = (s_sync + s_long) / 2 + 1;
-        zero_l = sync_u - 1;
-        zero_u = INT_MAX;
-    }
-    else {
-        // short=1, middle=0, long=sync
-        one_l  = 0;
-        one_u  = (s_short + s_long) / 2 + 1;
-        zero_l = one_u - 1;
-        zero_u = (s_long + s_sync) / 2 + 1;
-        sync_l = zero_u - 1;
-        sync_u = INT_MAX;
-    }
+    slicer_bounds_t bounds = pwm_bounds(s_short, s_long, s_sync, s_tolerance);
+    int const one_l = bounds.one_l, one_u = bounds.one_u;
+    int const zero_l = bounds.zero_l, zero_u = bounds.zero_u;
+    int const sync_l = bounds.sync_l, sync_u = bounds.sync_u;
 
     for (unsigned n = 0; n < pulses->num_pulses; ++n) {
         if (pulses->pulse[n] > one_l && pulses->pulse[n] < one_u) {
             // 'Short' 1 pulse
-            bitbuffer_add_bit(&bits, 1);
+            bitbuffer_add_bit(bits, 1);
         }
         else if (pulses->pulse[n] > zero_l && pulses->pulse[n] < zero_u) {
             // 'Long' 0 pulse
-            bitbuffer_add_bit(&bits, 0);
+            bitbuffer_add_bit(bits, 0);
         }
         else if (pulses->pulse[n] > sync_l && pulses->pulse[n] < sync_u) {
             // Sync pulse
-            bitbuffer_add_sync(&bits);
+            bitbuffer_add_sync(bits);
         }
         else if (pulses->pulse[n] <= one_l) {
             // Ignore spurious short pulses
         }
         else {
             // Pulse outside specified timing
-            bitbuffer_add_row(&bits);
+            bitbuffer_add_row(bits);
         }
 
         // End of Message?
         if (((n == pulses->num_pulses - 1)                       // No more pulses? (FSK)
                     || (pulses->gap[n] > s_reset)) // Long silence (OOK)
-                && (bits.num_rows > 0)) {                        // Only if data has been accumulated
-            events += account_event(device, &bits, __func__);
-            bitbuffer_clear(&bits);
+                && (bits->num_rows > 0)) {                        // Only if data has been accumulated
+            events += account_event(device, bits, __func__);
+            bitbuffer_clear(bits);
         }
         else if (s_gap > 0 && pulses->gap[n] > s_gap
-                && bits.num_rows > 0 && bits.bits_per_row[bits.num_rows - 1] > 0) {
+                && bits->num_rows > 0 && bits->bits_per_row[bits->num_rows - 1] > 0) {
             // New packet in multipacket
-            bitbuffer_add_row(&bits);
+            bitbuffer_add_row(bits);
         }
     }
     return events;
@@ -472,10 +512,10 @@ int pulse_slicer_manchester_zerobit(pulse_data_t const *pulses, r_device *device
 
     int events = 0;
     int time_since_last = 0;
-    bitbuffer_t bits = {0};
+    bitbuffer_t *bits = slicer_bitbuffer();
 
     // First rising edge is always counted as a zero (Seems to be hardcoded policy for the Oregon Scientific sensors...)
-    bitbuffer_add_bit(&bits, 0);
+    bitbuffer_add_bit(bits, 0);
 
     for (unsigned n = 0; n < pulses->num_pulses; ++n) {
         // The pulse or gap is too long or too short, thus invalid
@@ -487,17 +527,17 @@ int pulse_slicer_manchester_zerobit(pulse_data_t const *pulses, r_device *device
             if (pulses->pulse[n] > s_short * 1.5
                     && pulses->pulse[n] <= s_short * 2 + s_tolerance) {
                 // Long last pulse means with the gap this is a [1]10 transition, add a one
-                bitbuffer_add_bit(&bits, 1);
+                bitbuffer_add_bit(bits, 1);
             }
-            bitbuffer_add_row(&bits);
-            bitbuffer_add_bit(&bits, 0); // Prepare for new message with hardcoded 0
+            bitbuffer_add_row(bits);
+            bitbuffer_add_bit(bits, 0); // Prepare for new message with hardcoded 0
             time_since_last = 0;
         }
         // Falling edge is on end of pulse
         else if (pulses->pulse[n] + time_since_last > (s_short * 1.5)) {
             // Last bit was recorded more than short_width*1.5 samples ago
             // so this pulse start must be a data edge (falling data edge means bit = 1)
-            bitbuffer_add_bit(&bits, 1);
+            bitbuffer_add_bit(bits, 1);
             time_since_last = 0;
         }
         else {
@@ -507,17 +547,17 @@ int pulse_slicer_manchester_zerobit(pulse_data_t const *pulses, r_device *device
         // End of Message?
         if (((n == pulses->num_pulses - 1)                       // No more pulses? (FSK)
                     || (pulses->gap[n] > s_reset)) // Long silence (OOK)
-                && (bits.num_rows > 0)) {                        // Only if data has been accumulated
-            events += account_event(device, &bits, __func__);
-            bitbuffer_clear(&bits);
-            bitbuffer_add_bit(&bits, 0); // Prepare for new message with hardcoded 0
+                && (bits->num_rows > 0)) {                        // Only if data has been accumulated
+            events += account_event(device, bits, __func__);
+            bitbuffer_clear(bits);
+            bitbuffer_add_bit(bits, 0); // Prepare for new message with hardcoded 0
             time_since_last = 0;
         }
         // Rising edge is on end of gap
         else if (pulses->gap[n] + time_since_last > (s_short * 1.5)) {
             // Last bit was recorded more than short_width*1.5 samples ago
             // so this pulse end is a data edge (rising data edge means bit = 0)
-            bitbuffer_add_bit(&bits, 0);
+            bitbuffer_add_bit(bits, 0);
             time_since_last = 0;
         }
         else {
@@ -557,7 +597,7 @@ int pulse_slicer_dmc(pulse_data_t const *pulses, r_device *device)
         return 0;
     }
 
-    bitbuffer_t bits = {0};
+    bitbuffer_t *bits = slicer_bitbuffer();
     int events = 0;
 
     for (unsigned int n = 0; n < pulses->num_pulses * 2; ++n) {
@@ -565,15 +605,15 @@ int pulse_slicer_dmc(pulse_data_t const *pulses, r_device *device)
 
         if (abs(symbol - s_short) < s_tolerance) {
             // Short - 1
-            bitbuffer_add_bit(&bits, 1);
+            bitbuffer_add_bit(bits, 1);
             symbol = n + 1 < pulses->num_pulses * 2 ? pulse_slicer_get_symbol(pulses, ++n) : 0;
             if (abs(symbol - s_short) > s_tolerance) {
                 if (symbol >= s_reset - s_tolerance) {
                     // Don't expect another short gap at end of message
                     n--;
                 }
-                else if (bits.num_rows > 0 && bits.bits_per_row[bits.num_rows - 1] > 0) {
-                    bitbuffer_add_row(&bits);
+                else if (bits->num_rows > 0 && bits->bits_per_row[bits->num_rows - 1] > 0) {
+                    bitbuffer_add_row(bits);
 /*
                     print_logf(LOG_WARNING, __func__, "Detected error during pulse_slicer_dmc(): %s",
                             device->name);
@@ -583,12 +623,12 @@ int pulse_slicer_dmc(pulse_data_t const *pulses, r_device *device)
         }
         else if (abs(symbol - s_long) < s_tolerance) {
             // Long - 0
-            bitbuffer_add_bit(&bits, 0);
+            bitbuffer_add_bit(bits, 0);
         }
         else if (symbol >= s_reset - s_tolerance
-                && bits.num_rows > 0) { // Only if data has been accumulated
+                && bits->num_rows > 0) { // Only if data has been accumulated
             //END message ?
-            events += account_event(device, &bits, __func__);
+            events += account_event(device, bits, __func__);
         }
     }
 
@@ -622,24 +662,24 @@ int pulse_slicer_piwm_raw(pulse_data_t const *pulses, r_device *device)
 
     int w;
 
-    bitbuffer_t bits = {0};
+    bitbuffer_t *bits = slicer_bitbuffer();
     int events = 0;
 
     for (unsigned int n = 0; n < pulses->num_pulses * 2; ++n) {
         int symbol = pulse_slicer_get_symbol(pulses, n);
         w = symbol * f_short + 0.5;
         if (symbol > s_long) {
-            bitbuffer_add_row(&bits);
+            bitbuffer_add_row(bits);
         }
         else if (abs(symbol - w * s_short) < s_tolerance) {
             // Add w symbols
-            for (; w > 0; --w)
-                bitbuffer_add_bit(&bits, 1 - n % 2);
+            if (w > 0)
+                bitbuffer_add_bits(bits, 1 - n % 2, w);
         }
         else if (symbol < s_reset
-                && bits.num_rows > 0
-                && bits.bits_per_row[bits.num_rows - 1] > 0) {
-            bitbuffer_add_row(&bits);
+                && bits->num_rows > 0
+                && bits->bits_per_row[bits->num_rows - 1] > 0) {
+            bitbuffer_add_row(bits);
 /*
             print_logf(LOG_WARNING, __func__, "Detected error during pulse_slicer_piwm_raw(): %s",
                     device->name);
@@ -648,9 +688,9 @@ int pulse_slicer_piwm_raw(pulse_data_t const *pulses, r_device *device)
 
         if (((n == pulses->num_pulses * 2 - 1)              // No more pulses? (FSK)
                     || (symbol > s_reset)) // Long silence (OOK)
-                && (bits.num_rows > 0)) {                   // Only if data has been accumulated
+                && (bits->num_rows > 0)) {                   // Only if data has been accumulated
             //END message ?
-            events += account_event(device, &bits, __func__);
+            events += account_event(device, bits, __func__);
         }
     }
 
@@ -679,23 +719,23 @@ int pulse_slicer_piwm_dc(pulse_data_t const *pulses, r_device *device)
         return 0;
     }
 
-    bitbuffer_t bits = {0};
+    bitbuffer_t *bits = slicer_bitbuffer();
     int events = 0;
 
     for (unsigned int n = 0; n < pulses->num_pulses * 2; ++n) {
         int symbol = pulse_slicer_get_symbol(pulses, n);
         if (abs(symbol - s_short) < s_tolerance) {
             // Short - 1
-            bitbuffer_add_bit(&bits, 1);
+            bitbuffer_add_bit(bits, 1);
         }
         else if (abs(symbol - s_long) < s_tolerance) {
             // Long - 0
-            bitbuffer_add_bit(&bits, 0);
+            bitbuffer_add_bit(bits, 0);
         }
         else if (symbol < s_reset
-                && bits.num_rows > 0
-                && bits.bits_per_row[bits.num_rows - 1] > 0) {
-            bitbuffer_add_row(&bits);
+                && bits->num_rows > 0
+                && bits->bits_per_row[bits->num_rows - 1] > 0) {
+            bitbuffer_add_row(bits);
 /*
             print_logf(LOG_WARNING, __func__, "Detected error during pulse_slicer_piwm_dc(): %s",
                     device->name);
@@ -704,9 +744,9 @@ int pulse_slicer_piwm_dc(pulse_data_t const *pulses, r_device *device)
 
         if (((n == pulses->num_pulses * 2 - 1)              // No more pulses? (FSK)
                     || (symbol > s_reset)) // Long silence (OOK)
-                && (bits.num_rows > 0)) {                   // Only if data has been accumulated
+                && (bits->num_rows > 0)) {                   // Only if data has been accumulated
             //END message ?
-            events += account_event(device, &bits, __func__);
+            events += account_event(device, bits, __func__);
         }
     }
 
@@ -736,23 +776,21 @@ int pulse_slicer_nrzs(pulse_data_t const *pulses, r_device *device)
     }
 
     int events = 0;
-    bitbuffer_t bits = {0};
+    bitbuffer_t *bits = slicer_bitbuffer();
     int limit = s_short;
 
     for (unsigned n = 0; n < pulses->num_pulses; ++n) {
         if (pulses->pulse[n] > limit) {
-            for (int i = 0 ; i < (pulses->pulse[n]/limit) ; i++) {
-                bitbuffer_add_bit(&bits, 1);
-            }
-            bitbuffer_add_bit(&bits, 0);
+            bitbuffer_add_bits(bits, 1, pulses->pulse[n] / limit);
+            bitbuffer_add_bit(bits, 0);
         } else if (pulses->pulse[n] < limit) {
-            bitbuffer_add_bit(&bits, 0);
+            bitbuffer_add_bit(bits, 0);
         }
 
         if (n == pulses->num_pulses - 1
                     || pulses->gap[n] >= s_reset) {
 
-            events += account_event(device, &bits, __func__);
+            events += account_event(device, bits, __func__);
         }
     }
 
@@ -799,7 +837,7 @@ int pulse_slicer_osv1(pulse_data_t const *pulses, r_device *device)
     int preamble = 0;
     int events = 0;
     int manbit = 0;
-    bitbuffer_t bits = {0};
+    bitbuffer_t *bits = slicer_bitbuffer();
     int halfbit_min = s_short / 2;
     int halfbit_max = s_short * 3 / 2;
     int sync_min = 2 * halfbit_max;
@@ -832,33 +870,33 @@ int pulse_slicer_osv1(pulse_data_t const *pulses, r_device *device)
     if (pulses->gap[n] > pulses->pulse[n]) {
         manbit ^= 1;
         if (manbit)
-            bitbuffer_add_bit(&bits, 0);
+            bitbuffer_add_bit(bits, 0);
     }
 
     /* remaining data bits */
     for (n++; n < pulses->num_pulses; ++n) {
         manbit ^= 1;
         if (manbit)
-            bitbuffer_add_bit(&bits, 1);
+            bitbuffer_add_bit(bits, 1);
         if (pulses->pulse[n] > halfbit_max) {
             manbit ^= 1;
             if (manbit)
-                bitbuffer_add_bit(&bits, 1);
+                bitbuffer_add_bit(bits, 1);
         }
         if ((n == pulses->num_pulses - 1
                     || pulses->gap[n] > s_reset)
-                && (bits.num_rows > 0)) { // Only if data has been accumulated
+                && (bits->num_rows > 0)) { // Only if data has been accumulated
             //END message ?
-            events += account_event(device, &bits, __func__);
+            events += account_event(device, bits, __func__);
             return events;
         }
         manbit ^= 1;
         if (manbit)
-            bitbuffer_add_bit(&bits, 0);
+            bitbuffer_add_bit(bits, 0);
         if (pulses->gap[n] > halfbit_max) {
             manbit ^= 1;
             if (manbit)
-                bitbuffer_add_bit(&bits, 0);
+                bitbuffer_add_bit(bits, 0);
         }
     }
     return events;
@@ -867,11 +905,249 @@ int pulse_slicer_osv1(pulse_data_t const *pulses, r_device *device)
 int pulse_slicer_string(const char *code, r_device *device)
 {
     int events = 0;
-    bitbuffer_t bits = {0};
+    bitbuffer_t *bits = slicer_bitbuffer();
+
+    bitbuffer_parse(bits, code);
+
+    events += account_event(device, bits, __func__);
+
+    return events;
+}
+
+/* slicing cache */
+
+/// Name of a slicer whose output only depends on the key, NULL if it can't be cached.
+static char const *cacheable_slicer_name(pulse_slicer_fn slicer)
+{
+    if (slicer == pulse_slicer_pcm)
+        return "pulse_slicer_pcm";
+    if (slicer == pulse_slicer_ppm)
+        return "pulse_slicer_ppm";
+    if (slicer == pulse_slicer_pwm)
+        return "pulse_slicer_pwm";
+    if (slicer == pulse_slicer_manchester_zerobit)
+        return "pulse_slicer_manchester_zerobit";
+    if (slicer == pulse_slicer_osv1)
+        return "pulse_slicer_osv1";
+    // the DMC, PIWM and NRZS slicers keep adding to the bitbuffer the decoder was given
+    return NULL;
+}
+
+int pulse_slicer_key(pulse_slicer_key_t *key, uint32_t sample_rate, pulse_slicer_fn slicer, r_device const *device)
+{
+    // compute the timing as the slicer would
+    float samples_per_us = sample_rate / 1.0e6f;
+
+    *key = (pulse_slicer_key_t){
+            .slicer      = slicer,
+            .s_short     = device->short_width * samples_per_us,
+            .s_long      = device->long_width * samples_per_us,
+            .s_reset     = device->reset_limit * samples_per_us,
+            .s_gap       = device->gap_limit * samples_per_us,
+            .s_sync      = device->sync_width * samples_per_us,
+            .s_tolerance = device->tolerance * samples_per_us,
+    };
+    if (slicer == pulse_slicer_pcm) {
+        key->f_short = device->short_width > 0.0f ? 1.0f / (device->short_width * samples_per_us) : 0;
+        key->f_long  = device->long_width > 0.0f ? 1.0f / (device->long_width * samples_per_us) : 0;
+    }
+
+    // verbose slicers log with the decoder, on rounding to zero the slicer warns
+    return cacheable_slicer_name(slicer)
+            && !device->verbose
+            && pulse_slicer_timing_valid(key, device);
+}
+
+int pulse_slicer_timing_valid(pulse_slicer_key_t const *key, r_device const *device)
+{
+    return !((device->short_width > 0 && key->s_short <= 0)
+            || (device->long_width > 0 && key->s_long <= 0)
+            || (device->reset_limit > 0 && key->s_reset <= 0)
+            || (device->gap_limit > 0 && key->s_gap <= 0)
+            || (device->sync_width > 0 && key->s_sync <= 0)
+            || (device->tolerance > 0 && key->s_tolerance <= 0));
+}
+
+int pulse_slicer_key_equal(pulse_slicer_key_t const *a, pulse_slicer_key_t const *b)
+{
+    return a->slicer == b->slicer
+            && a->s_short == b->s_short
+            && a->s_long == b->s_long
+            && a->s_reset == b->s_reset
+            && a->s_gap == b->s_gap
+            && a->s_sync == b->s_sync
+            && a->s_tolerance == b->s_tolerance
+            && a->f_short == b->f_short
+            && a->f_long == b->f_long;
+}
+
+static unsigned slicer_key_hash(pulse_slicer_key_t const *key)
+{
+    unsigned h = (unsigned)(uintptr_t)key->slicer;
+    h = h * 31 + key->s_short;
+    h = h * 31 + key->s_long;
+    h = h * 31 + key->s_reset;
+    h = h * 31 + key->s_gap;
+    h = h * 31 + key->s_sync;
+    h = h * 31 + key->s_tolerance;
+    return h ^ (h >> 15);
+}
+
+/// Stands in for the decoder while slicing, records a copy of each bitbuffer.
+static int slicer_record(r_device *decoder, bitbuffer_t *bitbuffer)
+{
+    pulse_slicer_cache_t *cache = decoder->decode_ctx;
+
+    if (cache->num_bits == cache->bits_size) {
+        unsigned bits_size = cache->bits_size ? cache->bits_size * 2 : 4;
+        bitbuffer_t *bits  = realloc(cache->bits, bits_size * sizeof(*bits));
+        if (!bits)
+            FATAL_REALLOC("slicer_record()");
+        // new bitbuffers need to be cleared once, later copies only clear the rows in use
+        memset(&bits[cache->bits_size], 0, (bits_size - cache->bits_size) * sizeof(*bits));
+        cache->bits      = bits;
+        cache->bits_size = bits_size;
+    }
+    bitbuffer_copy(&cache->bits[cache->num_bits++], bitbuffer);
+    return 0;
+}
 
-    bitbuffer_parse(&bits, code);
+void pulse_slicer_cache_free(pulse_slicer_cache_t *cache)
+{
+    free(cache->slots);
+    free(cache->table);
+    free(cache->bits);
+    cache->slots     = NULL;
+    cache->table     = NULL;
+    cache->bits      = NULL;
+    cache->max_slots = 0;
+    cache->num_slots = 0;
+    cache->num_bits  = 0;
+    cache->bits_size = 0;
+}
 
-    events += account_event(device, &bits, __func__);
+void pulse_slicer_cache_init(pulse_slicer_cache_t *cache, unsigned max_decoders)
+{
+    pulse_slicer_cache_free(cache);
+    if (!max_decoders)
+        return;
+
+    unsigned table_size = 16;
+    while (table_size < max_decoders * 2)
+        table_size *= 2;
+
+    cache->slots = calloc(max_decoders, sizeof(*cache->slots));
+    if (!cache->slots)
+        FATAL_CALLOC("pulse_slicer_cache_init()");
+    cache->table = malloc(table_size * sizeof(*cache->table));
+    if (!cache->table)
+        FATAL_MALLOC("pulse_slicer_cache_init()");
+    for (unsigned i = 0; i < table_size; ++i)
+        cache->table[i] = -1;
+    cache->max_slots  = max_decoders;
+    cache->table_mask = table_size - 1;
+}
 
+void pulse_slicer_cache_clear(pulse_slicer_cache_t *cache)
+{
+    for (unsigned i = 0; i < cache->num_slots; ++i)
+        cache->table[cache->slots[i].bucket] = -1;
+    cache->num_slots = 0;
+    cache->num_bits  = 0;
+}
+
+int pulse_slicer_cached(pulse_slicer_cache_t *cache, pulse_data_t const *pulses, pulse_slicer_key_t const *key, r_device *device)
+{
+    if (cache->num_slots >= cache->max_slots) {
+        cache->slices += 1;
+        return key->slicer(pulses, device);
+    }
+
+    unsigned bucket = slicer_key_hash(key) & cache->table_mask;
+    while (cache->table[bucket] >= 0 && !pulse_slicer_key_equal(&cache->slots[cache->table[bucket]].key, key))
+        bucket = (bucket + 1) & cache->table_mask;
+
+    pulse_slicer_slot_t *slot;
+    if (cache->table[bucket] >= 0) {
+        slot = &cache->slots[cache->table[bucket]];
+        cache->slices_saved += 1;
+    }
+    else {
+        cache->table[bucket] = cache->num_slots;
+        slot  = &cache->slots[cache->num_slots++];
+        *slot = (pulse_slicer_slot_t){.key = *key, .name = cacheable_slicer_name(key->slicer), .bucket = bucket, .first = cache->num_bits};
+
+        r_device recorder   = *device;
+        recorder.decode_fn  = slicer_record;
+        recorder.decode_ctx = cache;
+        key->slicer(pulses, &recorder);
+        slot->count = cache->num_bits - slot->first;
+        cache->slices += 1;
+    }
+
+    int events = 0;
+    for (unsigned i = slot->first; i < slot->first + slot->count; ++i) {
+        bitbuffer_copy(&cache->scratch, &cache->bits[i]);
+        events += account_event(device, &cache->scratch, slot->name);
+    }
     return events;
 }
+
+/* width prefilter */
+
+void pulse_slicer_bands(pulse_slicer_bands_t *bands, pulse_slicer_key_t const *key)
+{
+    *bands = (pulse_slicer_bands_t){0};
+
+    if (key->slicer == pulse_slicer_pcm && key->s_short != key->s_long) {
+        // RZ clears the bits on every pulse out of tolerance, without one no event is produced
+        int s_tolerance = key->s_tolerance > 0 ? key->s_tolerance : key->s_long / 4;
+        bands->widths   = PULSE_SLICER_PULSE_BANDS;
+        bands->lower[0] = bands->lower[1] = key->s_short - s_tolerance - 1;
+        bands->upper[0] = bands->upper[1] = key->s_short + s_tolerance + 1;
+    }
+    else if (key->slicer == pulse_slicer_ppm) {
+        slicer_bounds_t b = ppm_bounds(key->s_short, key->s_long, key->s_reset, key->s_gap, key->s_sync, key->s_tolerance);
+        bands->widths   = PULSE_SLICER_GAP_BANDS;
+        bands->lower[0] = b.zero_l;
+        bands->upper[0] = b.zero_u;
+        bands->lower[1] = b.one_l;
+        bands->upper[1] = b.one_u;
+    }
+    else if (key->slicer == pulse_slicer_pwm) {
+        slicer_bounds_t b = pwm_bounds(key->s_short, key->s_long, key->s_sync, key->s_tolerance);
+        bands->widths   = PULSE_SLICER_PULSE_BANDS;
+        bands->lower[0] = b.one_l;
+        bands->upper[0] = b.one_u;
+        bands->lower[1] = b.zero_l;
+        bands->upper[1] = b.zero_u;
+    }
+}
+
+void pulse_slicer_widths(pulse_slicer_widths_t *widths, pulse_data_t const *pulses)
+{
+    widths->pulses.bins_count = 0;
+    widths->pulses.dropped    = 0;
+    widths->gaps.bins_count   = 0;
+    widths->gaps.dropped      = 0;
+    histogram_sum(&widths->pulses, pulses->pulse, pulses->num_pulses, PULSE_SLICER_WIDTHS_TOLERANCE);
+    histogram_sum(&widths->gaps, pulses->gap, pulses->num_pulses, PULSE_SLICER_WIDTHS_TOLERANCE);
+}
+
+int pulse_slicer_bands_present(pulse_slicer_bands_t const *bands, pulse_slicer_widths_t const *widths)
+{
+    if (!bands->widths)
+        return 1;
+    histogram_t const *hist = bands->widths == PULSE_SLICER_GAP_BANDS ? &widths->gaps : &widths->pulses;
+    if (hist->dropped)
+        return 1; // the bins don't cover all widths
+
+    for (unsigned i = 0; i < hist->bins_count; ++i) {
+        hist_bin_t const *bin = &hist->bins[i];
+        for (int j = 0; j < 2; ++j) {
+            if (bin->max > bands->lower[j] && bin->min < bands->upper[j])
+                return 1;
+        }
+    }
+    return 0;
+}
@@ -210,6 +210,83 @@ r_cfg_t *r_create_cfg(void)
     return cfg;
 }
 
+/// Replace a buffer with a zeroed one of a new size, the old contents are dropped.
+static void *dm_buf_resize(void *buf, size_t size)
+{
+    free(buf);
+    if (!size)
+        return NULL;
+    void *p = calloc(1, size);
+    if (!p)
+        FATAL_CALLOC("dm_state_alloc_buffers()");
+    return p;
+}
+
+size_t dm_state_alloc_buffers(struct dm_state *demod, unsigned long max_samples)
+{
+    size_t total = 0;
+
+    if (demod->channelizer) {
+        // the main state only splits the input, each channel demodulates its own CS16 frames
+        unsigned num_channels = channelizer_num_channels(demod->channelizer);
+        unsigned long ch_samples = max_samples / num_channels + 1;
+        for (unsigned c = 0; c < num_channels; ++c) {
+            struct dm_state *ch_demod = demod->channels[c].demod;
+            total += dm_state_alloc_buffers(ch_demod, ch_samples);
+            ch_demod->decim_buf = dm_buf_resize(ch_demod->decim_buf, ch_samples * 2 * sizeof(int16_t));
+            total += ch_samples * 2 * sizeof(int16_t);
+        }
+        demod->buf_samples = max_samples;
+        return total;
+    }
+
+    // IQ dumpers convert in the temp buffer, make room for the widest output format
+    unsigned long temp_len = max_samples;
+    size_t u8_size         = 0;
+    size_t f32_size        = 0;
+    for (void **iter = demod->dumper.elems; iter && *iter; ++iter) {
+        file_info_t const *dumper = *iter;
+        if (dumper->format == U8_LOGIC)
+            u8_size = max_samples * sizeof(uint8_t);
+        else if (dumper->format == F32_AM || dumper->format == F32_FM || dumper->format == F32_I || dumper->format == F32_Q)
+            f32_size = max_samples * sizeof(float);
+        else if (dumper->format == CS16_IQ)
+            temp_len = MAX(temp_len, max_samples * 2);
+        else if (dumper->format == CF32_IQ)
+            temp_len = MAX(temp_len, max_samples * 4);
+    }
+    // decimated frames are CS16 and at most one sample longer than the input over the factor
+    size_t decim_size = demod->decimation > 1 ? (max_samples / demod->decimation + 1) * 2 * sizeof(int16_t) : 0;
+
+    demod->am_buf      = dm_buf_resize(demod->am_buf, max_samples * sizeof(int16_t));
+    demod->buf.temp    = dm_buf_resize(demod->buf.temp, temp_len * sizeof(uint16_t));
+    demod->u8_buf      = dm_buf_resize(demod->u8_buf, u8_size);
+    demod->f32_buf     = dm_buf_resize(demod->f32_buf, f32_size);
+    demod->decim_buf   = dm_buf_resize(demod->decim_buf, decim_size);
+    demod->buf_samples = max_samples;
+
+    total += max_samples * sizeof(int16_t) + temp_len * sizeof(uint16_t) + u8_size + f32_size + decim_size;
+    return total;
+}
+
+void dm_state_free_buffers(struct dm_state *demod)
+{
+    for (unsigned c = 0; demod->channels && c < demod->num_channels; ++c) {
+        dm_state_free_buffers(demod->channels[c].demod);
+    }
+    free(demod->am_buf);
+    demod->am_buf = NULL;
+    free(demod->buf.temp);
+    demod->buf.temp = NULL;
+    free(demod->u8_buf);
+    demod->u8_buf = NULL;
+    free(demod->f32_buf);
+    demod->f32_buf = NULL;
+    free(demod->decim_buf);
+    demod->decim_buf = NULL;
+    demod->buf_samples = 0;
+}
+
 void r_free_cfg(r_cfg_t *cfg)
 {
     if (cfg->dev) {
@@ -228,6 +305,13 @@ void r_free_cfg(r_cfg_t *cfg)
     }
     list_free_elems(&cfg->demod->dumper, free);
 
+    r_dispatch_free(&cfg->demod->ook_dispatch);
+    r_dispatch_free(&cfg->demod->fsk_dispatch);
+    decoder_pool_free(cfg->demod->decoder_pool);
+    cfg->demod->decoder_pool = NULL;
+    free(cfg->demod->always_run);
+    cfg->demod->always_run     = NULL;
+    cfg->demod->num_always_run = 0;
     list_free_elems(&cfg->demod->r_devs, (list_elem_free_fn)free_protocol);
 
     if (cfg->demod->am_analyze)
@@ -237,6 +321,21 @@ void r_free_cfg(r_cfg_t *cfg)
     pulse_detect_free(cfg->demod->pulse_detect);
     cfg->demod->pulse_detect = NULL;
 
+    dm_state_free_buffers(cfg->demod);
+
+    decoder_pool_free(cfg->demod->channel_pool);
+    cfg->demod->channel_pool = NULL;
+    for (unsigned c = 0; cfg->demod->channels && c < cfg->demod->num_channels; ++c) {
+        dm_channel_t *channel = &cfg->demod->channels[c];
+        list_free_elems(&channel->packages, free);
+        pulse_detect_free(channel->demod->pulse_detect);
+        free(channel->demod);
+    }
+    free(cfg->demod->channels);
+    cfg->demod->channels = NULL;
+    channelizer_free(cfg->demod->channelizer);
+    cfg->demod->channelizer = NULL;
+
     list_free_elems(&cfg->raw_handler, (list_elem_free_fn)raw_output_free);
 
     r_logger_set_log_handler(NULL, NULL);
@@ -262,7 +361,8 @@ void r_free_cfg(r_cfg_t *cfg)
 
 /* device decoder protocols */
 
-void register_protocol(r_cfg_t *cfg, r_device *r_dev, char *arg)
+/// Create and add a decoder, the caller rebuilds the dispatch tables.
+static void add_protocol(r_cfg_t *cfg, r_device *r_dev, char *arg)
 {
     // use arg of 'v', 'vv', 'vvv' as device verbosity
     int dev_verbose = 0;
@@ -304,6 +404,12 @@ void register_protocol(r_cfg_t *cfg, r_device *r_dev, char *arg)
     }
 }
 
+void register_protocol(r_cfg_t *cfg, r_device *r_dev, char *arg)
+{
+    add_protocol(cfg, r_dev, arg);
+    update_protocol_dispatch(cfg);
+}
+
 void free_protocol(r_device *r_dev)
 {
     // free(r_dev->name);
@@ -320,6 +426,7 @@ void unregister_protocol(r_cfg_t *cfg, r_device *r_dev)
             i--; // so we don't skip the next elem now shifted down
         }
     }
+    update_protocol_dispatch(cfg);
 }
 
 void register_all_protocols(r_cfg_t *cfg, unsigned disabled)
@@ -327,9 +434,11 @@ void register_all_protocols(r_cfg_t *cfg, unsigned disabled)
     for (int i = 0; i < cfg->num_r_devices; i++) {
         // register all device protocols that are not disabled
         if (cfg->devices[i].disabled <= disabled) {
-            register_protocol(cfg, &cfg->devices[i], NULL);
+            add_protocol(cfg, &cfg->devices[i], NULL);
         }
     }
+    // rebuild the dispatch tables once for all protocols
+    update_protocol_dispatch(cfg);
 }
 
 /* output helper */
@@ -341,8 +450,8 @@ void calc_rssi_snr(r_cfg_t *cfg, pulse_data_t *pulse_data)
     int const OOK_MAX_HIGH_LEVEL = DB_TO_AMP(0); // Maximum estimate for high level (-0 dB)
     float ook_max_estimate = ook_high_estimate < OOK_MAX_HIGH_LEVEL ? ook_high_estimate : OOK_MAX_HIGH_LEVEL;
     float asnr   = ook_max_estimate / ook_low_estimate;
-    float foffs1 = (float)pulse_data->fsk_f1_est / INT16_MAX * cfg->samp_rate / 2.0f;
-    float foffs2 = (float)pulse_data->fsk_f2_est / INT16_MAX * cfg->samp_rate / 2.0f;
+    float foffs1 = (float)pulse_data->fsk_f1_est / INT16_MAX * pulse_data->sample_rate / 2.0f;
+    float foffs2 = (float)pulse_data->fsk_f2_est / INT16_MAX * pulse_data->sample_rate / 2.0f;
     pulse_data->freq1_hz = (foffs1 + cfg->center_frequency);
     pulse_data->freq2_hz = (foffs2 + cfg->center_frequency);
     pulse_data->centerfreq_hz = cfg->center_frequency;
@@ -367,6 +476,11 @@ void calc_rssi_snr(r_cfg_t *cfg, pulse_data_t *pulse_data)
 
 char *time_pos_str(r_cfg_t *cfg, unsigned samples_ago, char *buf)
 {
+    // samples_ago counts demodulated samples, which are at a lower rate when decimating or channelizing
+    if (cfg->demod->decimator.factor > 1)
+        samples_ago *= cfg->demod->decimator.factor;
+    if (cfg->demod->channelizer)
+        samples_ago *= channelizer_num_channels(cfg->demod->channelizer);
     if (cfg->report_time == REPORT_TIME_SAMPLES) {
         double s_per_sample = 1.0f / cfg->samp_rate;
         return sample_pos_str(cfg->demod->sample_file_pos - samples_ago * s_per_sample, buf);
@@ -495,116 +609,457 @@ char const **determine_csv_fields(r_cfg_t *cfg, char const *const *well_known, i
     return (char const **)field_list.elems;
 }
 
-int run_ook_demods(list_t *r_devs, pulse_data_t *pulse_data)
+/// Get the slicer for a modulation, NULL if the modulation is not of the package type.
+static pulse_slicer_fn slicer_for_modulation(unsigned modulation, int fsk)
 {
-    int p_events = 0;
+    switch (modulation) {
+    case OOK_PULSE_PCM:
+    // case OOK_PULSE_RZ:
+        return fsk ? NULL : pulse_slicer_pcm;
+    case OOK_PULSE_PPM:
+        return fsk ? NULL : pulse_slicer_ppm;
+    case OOK_PULSE_PWM:
+        return fsk ? NULL : pulse_slicer_pwm;
+    case OOK_PULSE_MANCHESTER_ZEROBIT:
+        return fsk ? NULL : pulse_slicer_manchester_zerobit;
+    case OOK_PULSE_PIWM_RAW:
+        return fsk ? NULL : pulse_slicer_piwm_raw;
+    case OOK_PULSE_PIWM_DC:
+        return fsk ? NULL : pulse_slicer_piwm_dc;
+    case OOK_PULSE_DMC:
+        return fsk ? NULL : pulse_slicer_dmc;
+    case OOK_PULSE_PWM_OSV1:
+        return fsk ? NULL : pulse_slicer_osv1;
+    case OOK_PULSE_NRZS:
+        return fsk ? NULL : pulse_slicer_nrzs;
+    // FSK decoders
+    case FSK_PULSE_PCM:
+        return fsk ? pulse_slicer_pcm : NULL;
+    case FSK_PULSE_PWM:
+        return fsk ? pulse_slicer_pwm : NULL;
+    case FSK_PULSE_MANCHESTER_ZEROBIT:
+        return fsk ? pulse_slicer_manchester_zerobit : NULL;
+    default:
+        if (!fsk) // warn only once per table rebuild
+            fprintf(stderr, "Unknown modulation %u in protocol!\n", modulation);
+        return NULL;
+    }
+}
 
-    unsigned next_priority = 0; // next smallest on each loop through decoders
-    // run all decoders of each priority, stop if an event is produced
-    for (unsigned priority = 0; !p_events && priority < UINT_MAX; priority = next_priority) {
-        next_priority = UINT_MAX;
-        for (void **iter = r_devs->elems; iter && *iter; ++iter) {
-            r_device *r_dev = *iter;
-
-            // Find next smallest priority
-            if (r_dev->priority > priority && r_dev->priority < next_priority)
-                next_priority = r_dev->priority;
-            // Run only current priority
-            if (r_dev->priority != priority)
-                continue;
+/// An output or log of a decoder, held back while the decoders run in parallel.
+typedef struct r_deferred_item {
+    int level; ///< log level, or -1 for an output
+    data_t *data;
+} r_deferred_item_t;
+
+/// Held back outputs of one decoder and its own handlers.
+struct r_deferred {
+    list_t items;
+    void (*log_fn)(r_device *decoder, int level, data_t *data);
+    void (*output_fn)(r_device *decoder, data_t *data);
+    void *output_ctx;
+    int events;
+};
+
+static void deferred_push(struct r_deferred *deferred, int level, data_t *data)
+{
+    r_deferred_item_t *item = malloc(sizeof(*item));
+    if (!item)
+        FATAL_MALLOC("deferred_push()");
+    item->level = level;
+    item->data  = data;
+    list_push(&deferred->items, item);
+}
 
-            switch (r_dev->modulation) {
-            case OOK_PULSE_PCM:
-            // case OOK_PULSE_RZ:
-                p_events += pulse_slicer_pcm(pulse_data, r_dev);
-                break;
-            case OOK_PULSE_PPM:
-                p_events += pulse_slicer_ppm(pulse_data, r_dev);
-                break;
-            case OOK_PULSE_PWM:
-                p_events += pulse_slicer_pwm(pulse_data, r_dev);
-                break;
-            case OOK_PULSE_MANCHESTER_ZEROBIT:
-                p_events += pulse_slicer_manchester_zerobit(pulse_data, r_dev);
-                break;
-            case OOK_PULSE_PIWM_RAW:
-                p_events += pulse_slicer_piwm_raw(pulse_data, r_dev);
-                break;
-            case OOK_PULSE_PIWM_DC:
-                p_events += pulse_slicer_piwm_dc(pulse_data, r_dev);
-                break;
-            case OOK_PULSE_DMC:
-                p_events += pulse_slicer_dmc(pulse_data, r_dev);
-                break;
-            case OOK_PULSE_PWM_OSV1:
-                p_events += pulse_slicer_osv1(pulse_data, r_dev);
-                break;
-            case OOK_PULSE_NRZS:
-                p_events += pulse_slicer_nrzs(pulse_data, r_dev);
-                break;
-            // FSK decoders
-            case FSK_PULSE_PCM:
-            case FSK_PULSE_PWM:
-            case FSK_PULSE_MANCHESTER_ZEROBIT:
+static void deferred_output_handler(r_device *r_dev, data_t *data)
+{
+    deferred_push(r_dev->output_ctx, -1, data);
+}
+
+static void deferred_log_handler(r_device *r_dev, int level, data_t *data)
+{
+    deferred_push(r_dev->output_ctx, level, data);
+}
+
+/// Free the per thread state, the pool itself is not owned.
+static void dispatch_detach_pool(r_dispatch_t *dispatch)
+{
+    unsigned num_threads = decoder_pool_num_threads(dispatch->pool);
+    for (unsigned w = 0; dispatch->worker_caches && w < num_threads; ++w) {
+        pulse_slicer_cache_free(&dispatch->worker_caches[w]);
+    }
+    free(dispatch->worker_caches);
+    for (unsigned j = 0; dispatch->deferred && j < dispatch->len; ++j) {
+        list_free_elems(&dispatch->deferred[j].items, NULL);
+    }
+    free(dispatch->deferred);
+    free(dispatch->unit_tail);
+    free(dispatch->unit_head);
+    free(dispatch->unit_next);
+    dispatch->worker_caches = NULL;
+    dispatch->deferred      = NULL;
+    dispatch->unit_tail     = NULL;
+    dispatch->unit_head     = NULL;
+    dispatch->unit_next     = NULL;
+    dispatch->pool          = NULL;
+}
+
+/// Set up the per thread state to run the decoders on a pool.
+static void dispatch_attach_pool(r_dispatch_t *dispatch, decoder_pool_t *pool)
+{
+    dispatch_detach_pool(dispatch);
+    if (!pool || !dispatch->len)
+        return;
+
+    unsigned num_threads    = decoder_pool_num_threads(pool);
+    dispatch->worker_caches = calloc(num_threads, sizeof(*dispatch->worker_caches));
+    if (!dispatch->worker_caches)
+        FATAL_CALLOC("dispatch_attach_pool()");
+    for (unsigned w = 0; w < num_threads; ++w) {
+        pulse_slicer_cache_init(&dispatch->worker_caches[w], dispatch->len);
+    }
+    dispatch->deferred = calloc(dispatch->len, sizeof(*dispatch->deferred));
+    if (!dispatch->deferred)
+        FATAL_CALLOC("dispatch_attach_pool()");
+    dispatch->unit_tail = malloc(dispatch->len * sizeof(*dispatch->unit_tail));
+    if (!dispatch->unit_tail)
+        FATAL_MALLOC("dispatch_attach_pool()");
+    for (unsigned i = 0; i < dispatch->len; ++i) {
+        dispatch->unit_tail[i] = -1;
+    }
+    dispatch->unit_head = calloc(dispatch->len, sizeof(*dispatch->unit_head));
+    if (!dispatch->unit_head)
+        FATAL_CALLOC("dispatch_attach_pool()");
+    dispatch->unit_next = calloc(dispatch->len, sizeof(*dispatch->unit_next));
+    if (!dispatch->unit_next)
+        FATAL_CALLOC("dispatch_attach_pool()");
+    dispatch->pool = pool;
+}
+
+void r_dispatch_free(r_dispatch_t *dispatch)
+{
+    dispatch_detach_pool(dispatch);
+    free(dispatch->entries);
+    free(dispatch->group_end);
+    free(dispatch->jobs);
+    free(dispatch->order);
+    pulse_slicer_cache_free(&dispatch->cache);
+    *dispatch = (r_dispatch_t){0};
+}
+
+void r_dispatch_build(r_dispatch_t *dispatch, list_t const *r_devs, int fsk)
+{
+    // keep the statistics across rebuilds
+    unsigned slices       = dispatch->cache.slices;
+    unsigned slices_saved = dispatch->cache.slices_saved;
+    unsigned prefiltered  = dispatch->prefiltered;
+    r_dispatch_free(dispatch);
+    dispatch->cache.slices       = slices;
+    dispatch->cache.slices_saved = slices_saved;
+    dispatch->prefiltered        = prefiltered;
+    if (!r_devs->len)
+        return;
+
+    dispatch->entries = calloc(r_devs->len, sizeof(*dispatch->entries));
+    if (!dispatch->entries)
+        FATAL_CALLOC("r_dispatch_build()");
+    dispatch->group_end = calloc(r_devs->len, sizeof(*dispatch->group_end));
+    if (!dispatch->group_end)
+        FATAL_CALLOC("r_dispatch_build()");
+    dispatch->jobs = calloc(r_devs->len, sizeof(*dispatch->jobs));
+    if (!dispatch->jobs)
+        FATAL_CALLOC("r_dispatch_build()");
+    dispatch->order = calloc(r_devs->len, sizeof(*dispatch->order));
+    if (!dispatch->order)
+        FATAL_CALLOC("r_dispatch_build()");
+
+    // stable insertion sort by priority, the list is short and built rarely
+    unsigned len = 0;
+    for (void **iter = r_devs->elems; iter && *iter; ++iter) {
+        r_device *r_dev = *iter;
+        if (r_dev->priority == UINT_MAX)
+            continue; // never reached by the priority scan
+        pulse_slicer_fn slicer = slicer_for_modulation(r_dev->modulation, fsk);
+        if (!slicer)
+            continue;
+        unsigned i = len++;
+        for (; i > 0 && dispatch->entries[i - 1].r_dev->priority > r_dev->priority; --i) {
+            dispatch->entries[i] = dispatch->entries[i - 1];
+        }
+        dispatch->entries[i] = (r_dispatch_entry_t){.slicer = slicer, .r_dev = r_dev};
+    }
+    dispatch->len = len;
+    pulse_slicer_cache_init(&dispatch->cache, len);
+    for (unsigned i = 0; i < len; ++i) {
+        dispatch->order[i] = i;
+    }
+
+    for (unsigned i = 1; i <= len; ++i) {
+        if (i == len || dispatch->entries[i].r_dev->priority != dispatch->entries[i - 1].r_dev->priority)
+            dispatch->group_end[dispatch->num_groups++] = i;
+    }
+}
+
+void r_dispatch_set_adaptive(r_dispatch_t *dispatch, unsigned half_life, unsigned const *always, unsigned num_always)
+{
+    dispatch->half_life  = half_life;
+    dispatch->hit_weight = 1.0;
+    dispatch->hit_growth = half_life ? pow(2.0, 1.0 / half_life) : 1.0;
+    for (unsigned i = 0; i < dispatch->len; ++i) {
+        r_dispatch_entry_t *entry = &dispatch->entries[i];
+        dispatch->order[i] = i;
+        entry->hits        = 0.0;
+        entry->always      = 0;
+        for (unsigned k = 0; k < num_always; ++k) {
+            if (entry->r_dev->protocol_num == always[k])
+                entry->always = 1;
+        }
+    }
+}
+
+void update_protocol_dispatch(r_cfg_t *cfg)
+{
+    struct dm_state *demod = cfg->demod;
+    r_dispatch_build(&demod->ook_dispatch, &demod->r_devs, 0);
+    r_dispatch_build(&demod->fsk_dispatch, &demod->r_devs, 1);
+    r_dispatch_set_adaptive(&demod->ook_dispatch, demod->adaptive_half_life, demod->always_run, demod->num_always_run);
+    r_dispatch_set_adaptive(&demod->fsk_dispatch, demod->adaptive_half_life, demod->always_run, demod->num_always_run);
+    dispatch_attach_pool(&cfg->demod->ook_dispatch, cfg->demod->decoder_pool);
+    dispatch_attach_pool(&cfg->demod->fsk_dispatch, cfg->demod->decoder_pool);
+}
+
+/// Compute the slicer keys for a sample rate and mark the decoders that can share the sliced bits.
+static void plan_dispatch_keys(r_dispatch_t *dispatch, uint32_t sample_rate)
+{
+    for (unsigned i = 0; i < dispatch->len; ++i) {
+        r_dispatch_entry_t *entry = &dispatch->entries[i];
+        entry->shared = 0;
+        entry->bands  = (pulse_slicer_bands_t){0};
+        if (!pulse_slicer_key(&entry->key, sample_rate, entry->slicer, entry->r_dev))
+            entry->key.slicer = NULL;
+        else if (!entry->r_dev->no_prefilter)
+            pulse_slicer_bands(&entry->bands, &entry->key);
+        // slicers log directly, not through the decoder log_fn
+        entry->parallel = !entry->r_dev->verbose && pulse_slicer_timing_valid(&entry->key, entry->r_dev);
+    }
+    // the list is short and the sample rate rarely changes
+    for (unsigned i = 0; i < dispatch->len; ++i) {
+        r_dispatch_entry_t *entry = &dispatch->entries[i];
+        entry->leader = i;
+        for (unsigned j = 0; entry->key.slicer && j < i; ++j) {
+            r_dispatch_entry_t *other = &dispatch->entries[j];
+            if (other->key.slicer && pulse_slicer_key_equal(&entry->key, &other->key)) {
+                entry->shared = other->shared = 1;
+                entry->leader = other->leader;
                 break;
-            default:
-                fprintf(stderr, "Unknown modulation %u in protocol!\n", r_dev->modulation);
             }
         }
     }
+    dispatch->key_rate = sample_rate;
+}
 
-    return p_events;
+/// Slice and decode one entry.
+static int run_entry(r_dispatch_entry_t const *entry, pulse_slicer_cache_t *cache, pulse_data_t const *pulse_data)
+{
+#ifdef DECODER_PROFILING
+    uint64_t start = monotonic_ns();
+#endif
+    int ret;
+    if (entry->shared) {
+        ret = pulse_slicer_cached(cache, pulse_data, &entry->key, entry->r_dev);
+    }
+    else {
+        cache->slices += 1;
+        ret = entry->slicer(pulse_data, entry->r_dev);
+    }
+#ifdef DECODER_PROFILING
+    entry->r_dev->profile.slice_ns += monotonic_ns() - start;
+    entry->r_dev->profile.calls += 1;
+#endif
+    return ret;
 }
 
-int run_fsk_demods(list_t *r_devs, pulse_data_t *fsk_pulse_data)
+typedef struct dispatch_run {
+    r_dispatch_t *dispatch;
+    pulse_data_t const *pulse_data;
+} dispatch_run_t;
+
+/// Run the jobs of one work unit, jobs that share a key run on the same thread to share the slicing.
+static void dispatch_unit(void *ctx, unsigned unit, unsigned worker)
 {
+    dispatch_run_t *run    = ctx;
+    r_dispatch_t *dispatch = run->dispatch;
+    for (int j = dispatch->unit_head[unit]; j >= 0; j = dispatch->unit_next[j]) {
+        r_dispatch_entry_t const *entry = &dispatch->entries[dispatch->jobs[j]];
+        dispatch->deferred[j].events    = run_entry(entry, &dispatch->worker_caches[worker], run->pulse_data);
+    }
+}
+
+/// Run the jobs on the pool, then emit the held back outputs in job order, as a serial run would.
+static int run_jobs_parallel(r_dispatch_t *dispatch, unsigned num_jobs, pulse_data_t const *pulse_data)
+{
+    // group the jobs that share a key into work units, in job order
+    unsigned num_units = 0;
+    int *unit_tail     = dispatch->unit_tail;
+    for (unsigned j = 0; j < num_jobs; ++j) {
+        r_dispatch_entry_t const *entry = &dispatch->entries[dispatch->jobs[j]];
+        dispatch->unit_next[j] = -1;
+        if (entry->shared && unit_tail[entry->leader] >= 0) {
+            dispatch->unit_next[unit_tail[entry->leader]] = j;
+        }
+        else {
+            dispatch->unit_head[num_units++] = j;
+        }
+        if (entry->shared)
+            unit_tail[entry->leader] = j;
+    }
+    for (unsigned j = 0; j < num_jobs; ++j) {
+        unit_tail[dispatch->entries[dispatch->jobs[j]].leader] = -1;
+    }
+
+    for (unsigned j = 0; j < num_jobs; ++j) {
+        r_device *r_dev              = dispatch->entries[dispatch->jobs[j]].r_dev;
+        struct r_deferred *deferred = &dispatch->deferred[j];
+        deferred->log_fn     = r_dev->log_fn;
+        deferred->output_fn  = r_dev->output_fn;
+        deferred->output_ctx = r_dev->output_ctx;
+        r_dev->log_fn        = deferred_log_handler;
+        r_dev->output_fn     = deferred_output_handler;
+        r_dev->output_ctx    = deferred;
+    }
+
+    dispatch_run_t run = {.dispatch = dispatch, .pulse_data = pulse_data};
+    decoder_pool_run(dispatch->pool, num_units, dispatch_unit, &run);
+
     int p_events = 0;
+    for (unsigned j = 0; j < num_jobs; ++j) {
+        r_device *r_dev              = dispatch->entries[dispatch->jobs[j]].r_dev;
+        struct r_deferred *deferred = &dispatch->deferred[j];
+        r_dev->log_fn     = deferred->log_fn;
+        r_dev->output_fn  = deferred->output_fn;
+        r_dev->output_ctx = deferred->output_ctx;
+        for (void **iter = deferred->items.elems; iter && *iter; ++iter) {
+            r_deferred_item_t *item = *iter;
+            if (item->level < 0)
+                r_dev->output_fn(r_dev, item->data);
+            else
+                r_dev->log_fn(r_dev, item->level, item->data);
+        }
+        list_clear(&deferred->items, free);
+        p_events += deferred->events;
+    }
 
-    unsigned next_priority = 0; // next smallest on each loop through decoders
-    // run all decoders of each priority, stop if an event is produced
-    for (unsigned priority = 0; !p_events && priority < UINT_MAX; priority = next_priority) {
-        next_priority = UINT_MAX;
-        for (void **iter = r_devs->elems; iter && *iter; ++iter) {
-            r_device *r_dev = *iter;
-
-            // Find next smallest priority
-            if (r_dev->priority > priority && r_dev->priority < next_priority)
-                next_priority = r_dev->priority;
-            // Run only current priority
-            if (r_dev->priority != priority)
-                continue;
+    unsigned num_threads = decoder_pool_num_threads(dispatch->pool);
+    for (unsigned w = 0; w < num_threads; ++w) {
+        dispatch->cache.slices += dispatch->worker_caches[w].slices;
+        dispatch->cache.slices_saved += dispatch->worker_caches[w].slices_saved;
+        dispatch->worker_caches[w].slices       = 0;
+        dispatch->worker_caches[w].slices_saved = 0;
+    }
+    return p_events;
+}
 
-            switch (r_dev->modulation) {
-            // OOK decoders
-            case OOK_PULSE_PCM:
-            // case OOK_PULSE_RZ:
-            case OOK_PULSE_PPM:
-            case OOK_PULSE_PWM:
-            case OOK_PULSE_MANCHESTER_ZEROBIT:
-            case OOK_PULSE_PIWM_RAW:
-            case OOK_PULSE_PIWM_DC:
-            case OOK_PULSE_DMC:
-            case OOK_PULSE_PWM_OSV1:
-            case OOK_PULSE_NRZS:
-                break;
-            case FSK_PULSE_PCM:
-                p_events += pulse_slicer_pcm(fsk_pulse_data, r_dev);
-                break;
-            case FSK_PULSE_PWM:
-                p_events += pulse_slicer_pwm(fsk_pulse_data, r_dev);
-                break;
-            case FSK_PULSE_MANCHESTER_ZEROBIT:
-                p_events += pulse_slicer_manchester_zerobit(fsk_pulse_data, r_dev);
-                break;
-            default:
-                fprintf(stderr, "Unknown modulation %u in protocol!\n", r_dev->modulation);
-            }
+/// Decay the hits of all decoders for a new package, by weighing new hits more.
+static void dispatch_decay_hits(r_dispatch_t *dispatch)
+{
+    dispatch->hit_weight *= dispatch->hit_growth;
+    if (dispatch->hit_weight < 1e100)
+        return;
+    // rescale before the weight overflows
+    for (unsigned i = 0; i < dispatch->len; ++i) {
+        dispatch->entries[i].hits /= dispatch->hit_weight;
+    }
+    dispatch->hit_weight = 1.0;
+}
+
+/// Run the jobs in order until one has events, then only those that always run, and move the hits forward.
+static int run_jobs_adaptive(r_dispatch_t *dispatch, unsigned num_jobs, unsigned group_start, unsigned group_end, pulse_data_t const *pulse_data)
+{
+    int p_events = 0;
+    for (unsigned j = 0; j < num_jobs; ++j) {
+        r_dispatch_entry_t *entry = &dispatch->entries[dispatch->jobs[j]];
+        if (p_events && !entry->always)
+            continue;
+        int events = run_entry(entry, &dispatch->cache, pulse_data);
+        if (events > 0)
+            entry->hits += dispatch->hit_weight;
+        p_events += events;
+    }
+    if (!p_events)
+        return 0;
+
+    // stable insertion sort by hits, the order changes by a few places at most
+    unsigned *order = dispatch->order;
+    for (unsigned i = group_start + 1; i < group_end; ++i) {
+        unsigned e  = order[i];
+        double hits = dispatch->entries[e].hits;
+        unsigned k  = i;
+        for (; k > group_start && dispatch->entries[order[k - 1]].hits < hits; --k) {
+            order[k] = order[k - 1];
         }
+        order[k] = e;
     }
+    return p_events;
+}
 
+/// Run all decoders of each priority, stop if an event is produced.
+static int run_dispatch(r_dispatch_t *dispatch, pulse_data_t *pulse_data)
+{
+    int p_events   = 0;
+    unsigned i     = 0;
+    int has_widths = 0;
+    if (dispatch->key_rate != pulse_data->sample_rate)
+        plan_dispatch_keys(dispatch, pulse_data->sample_rate);
+    pulse_slicer_cache_clear(&dispatch->cache);
+    for (unsigned w = 0; dispatch->pool && w < decoder_pool_num_threads(dispatch->pool); ++w) {
+        pulse_slicer_cache_clear(&dispatch->worker_caches[w]);
+    }
+    if (dispatch->half_life)
+        dispatch_decay_hits(dispatch);
+    for (unsigned g = 0; !p_events && g < dispatch->num_groups; ++g) {
+        unsigned group_start = i;
+        unsigned num_jobs    = 0;
+        int parallel         = dispatch->pool != NULL;
+        for (; i < dispatch->group_end[g]; ++i) {
+            r_dispatch_entry_t const *entry = &dispatch->entries[dispatch->order[i]];
+            if (entry->bands.widths) {
+                if (!has_widths) {
+                    pulse_slicer_widths(&dispatch->widths, pulse_data);
+                    has_widths = 1;
+                }
+                if (!pulse_slicer_bands_present(&entry->bands, &dispatch->widths)) {
+                    dispatch->prefiltered += 1;
+                    continue;
+                }
+            }
+            dispatch->jobs[num_jobs++] = dispatch->order[i];
+            parallel = parallel && entry->parallel;
+        }
+        if (dispatch->half_life) {
+            p_events += run_jobs_adaptive(dispatch, num_jobs, group_start, i, pulse_data);
+        }
+        else if (parallel && num_jobs > 1) {
+            p_events += run_jobs_parallel(dispatch, num_jobs, pulse_data);
+        }
+        else {
+            for (unsigned j = 0; j < num_jobs; ++j) {
+                p_events += run_entry(&dispatch->entries[dispatch->jobs[j]], &dispatch->cache, pulse_data);
+            }
+        }
+    }
     return p_events;
 }
 
+int run_ook_demods(r_dispatch_t *dispatch, pulse_data_t *pulse_data)
+{
+    return run_dispatch(dispatch, pulse_data);
+}
+
+int run_fsk_demods(r_dispatch_t *dispatch, pulse_data_t *fsk_pulse_data)
+{
+    return run_dispatch(dispatch, fsk_pulse_data);
+}
+
 /* handlers */
 
 static void log_handler(log_level_t level, char const *src, char const *msg, void *userdata)
@@ -711,8 +1166,8 @@ void data_acquired_handler(r_device *r_dev, data_t *data)
             if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_F")) {
                 d->value.v_dbl = fahrenheit2celsius(d->value.v_dbl);
                 char *new_label = str_replace(d->key, "_F", "_C");
-                free(d->key);
-                d->key = new_label;
+                data_rename(d, new_label, d->format);
+                free(new_label);
                 char *pos;
                 if (d->format && (pos = strrchr(d->format, 'F'))) {
                     *pos = 'C';
@@ -722,51 +1177,46 @@ void data_acquired_handler(r_device *r_dev, data_t *data)
             else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_mi_h")) {
                 d->value.v_dbl = mph2kmph(d->value.v_dbl);
                 char *new_label = str_replace(d->key, "_mi_h", "_km_h");
-                free(d->key);
-                d->key = new_label;
                 char *new_format_label = str_replace(d->format, "mi/h", "km/h");
-                free(d->format);
-                d->format = new_format_label;
+                data_rename(d, new_label, new_format_label);
+                free(new_label);
+                free(new_format_label);
             }
             // Convert double type fields ending in _in to _mm
             else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_in")) {
                 d->value.v_dbl = inch2mm(d->value.v_dbl);
                 char *new_label = str_replace(d->key, "_in", "_mm");
-                free(d->key);
-                d->key = new_label;
                 char *new_format_label = str_replace(d->format, "in", "mm");
-                free(d->format);
-                d->format = new_format_label;
+                data_rename(d, new_label, new_format_label);
+                free(new_label);
+                free(new_format_label);
             }
             // Convert double type fields ending in _in_h to _mm_h
             else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_in_h")) {
                 d->value.v_dbl = inch2mm(d->value.v_dbl);
                 char *new_label = str_replace(d->key, "_in_h", "_mm_h");
-                free(d->key);
-                d->key = new_label;
                 char *new_format_label = str_replace(d->format, "in/h", "mm/h");
-                free(d->format);
-                d->format = new_format_label;
+                data_rename(d, new_label, new_format_label);
+                free(new_label);
+                free(new_format_label);
             }
             // Convert double type fields ending in _inHg to _hPa
             else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_inHg")) {
                 d->value.v_dbl = inhg2hpa(d->value.v_dbl);
                 char *new_label = str_replace(d->key, "_inHg", "_hPa");
-                free(d->key);
-                d->key = new_label;
                 char *new_format_label = str_replace(d->format, "inHg", "hPa");
-                free(d->format);
-                d->format = new_format_label;
+                data_rename(d, new_label, new_format_label);
+                free(new_label);
+                free(new_format_label);
             }
             // Convert double type fields ending in _PSI to _kPa
             else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_PSI")) {
                 d->value.v_dbl = psi2kpa(d->value.v_dbl);
                 char *new_label = str_replace(d->key, "_PSI", "_kPa");
-                free(d->key);
-                d->key = new_label;
                 char *new_format_label = str_replace(d->format, "PSI", "kPa");
-                free(d->format);
-                d->format = new_format_label;
+                data_rename(d, new_label, new_format_label);
+                free(new_label);
+                free(new_format_label);
             }
         }
     }
@@ -776,8 +1226,8 @@ void data_acquired_handler(r_device *r_dev, data_t *data)
             if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_C")) {
                 d->value.v_dbl = celsius2fahrenheit(d->value.v_dbl);
                 char *new_label = str_replace(d->key, "_C", "_F");
-                free(d->key);
-                d->key = new_label;
+                data_rename(d, new_label, d->format);
+                free(new_label);
                 char *pos;
                 if (d->format && (pos = strrchr(d->format, 'C'))) {
                     *pos = 'F';
@@ -787,51 +1237,46 @@ void data_acquired_handler(r_device *r_dev, data_t *data)
             else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_km_h")) {
                 d->value.v_dbl = kmph2mph(d->value.v_dbl);
                 char *new_label = str_replace(d->key, "_km_h", "_mi_h");
-                free(d->key);
-                d->key = new_label;
                 char *new_format_label = str_replace(d->format, "km/h", "mi/h");
-                free(d->format);
-                d->format = new_format_label;
+                data_rename(d, new_label, new_format_label);
+                free(new_label);
+                free(new_format_label);
             }
             // Convert double type fields ending in _mm to _in
             else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_mm")) {
                 d->value.v_dbl = mm2inch(d->value.v_dbl);
                 char *new_label = str_replace(d->key, "_mm", "_in");
-                free(d->key);
-                d->key = new_label;
                 char *new_format_label = str_replace(d->format, "mm", "in");
-                free(d->format);
-                d->format = new_format_label;
+                data_rename(d, new_label, new_format_label);
+                free(new_label);
+                free(new_format_label);
             }
             // Convert double type fields ending in _mm_h to _in_h
             else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_mm_h")) {
                 d->value.v_dbl = mm2inch(d->value.v_dbl);
                 char *new_label = str_replace(d->key, "_mm_h", "_in_h");
-                free(d->key);
-                d->key = new_label;
                 char *new_format_label = str_replace(d->format, "mm/h", "in/h");
-                free(d->format);
-                d->format = new_format_label;
+                data_rename(d, new_label, new_format_label);
+                free(new_label);
+                free(new_format_label);
             }
             // Convert double type fields ending in _hPa to _inHg
             else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_hPa")) {
                 d->value.v_dbl = hpa2inhg(d->value.v_dbl);
                 char *new_label = str_replace(d->key, "_hPa", "_inHg");
-                free(d->key);
-                d->key = new_label;
                 char *new_format_label = str_replace(d->format, "hPa", "inHg");
-                free(d->format);
-                d->format = new_format_label;
+                data_rename(d, new_label, new_format_label);
+                free(new_label);
+                free(new_format_label);
             }
             // Convert double type fields ending in _kPa to _PSI
             else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_kPa")) {
                 d->value.v_dbl = kpa2psi(d->value.v_dbl);
                 char *new_label = str_replace(d->key, "_kPa", "_PSI");
-                free(d->key);
-                d->key = new_label;
                 char *new_format_label = str_replace(d->format, "kPa", "PSI");
-                free(d->format);
-                d->format = new_format_label;
+                data_rename(d, new_label, new_format_label);
+                free(new_label);
+                free(new_format_label);
             }
         }
     }
@@ -920,6 +1365,15 @@ data_t *create_report_data(r_cfg_t *cfg, int level)
             data = data_int(data, "fail_mic",     "", NULL, r_dev->decode_fails[-DECODE_FAIL_MIC]);
         if (r_dev->decode_fails[-DECODE_FAIL_SANITY])
             data = data_int(data, "fail_sanity",  "", NULL, r_dev->decode_fails[-DECODE_FAIL_SANITY]);
+#ifdef DECODER_PROFILING
+        r_device_profile_t const *profile = &r_dev->profile;
+        if (profile->calls) {
+            data = data_int(data, "calls",        "", NULL, profile->calls);
+            data = data_dbl(data, "run_ns",       "", "%.0f", (double)profile->slice_ns);
+            data = data_dbl(data, "decode_ns",    "", "%.0f", (double)profile->decode_ns);
+            data = data_dbl(data, "ns_per_call",  "", "%.0f", (double)(profile->slice_ns / profile->calls));
+        }
+#endif
 
         list_push(&dev_data_list, data);
     }
@@ -928,6 +1382,11 @@ data_t *create_report_data(r_cfg_t *cfg, int level)
             "count",            "", DATA_INT, cfg->frames_ook,
             "fsk",              "", DATA_INT, cfg->frames_fsk,
             "events",           "", DATA_INT, cfg->frames_events,
+            "rejected",         "", DATA_INT, cfg->frames_rejected,
+            "squelch_skipped",  "", DATA_FORMAT, "%.3f", DATA_DOUBLE, cfg->frames_samples ? (double)cfg->frames_samples_skipped / cfg->frames_samples : 0.0,
+            "slices",           "", DATA_INT, cfg->demod->ook_dispatch.cache.slices + cfg->demod->fsk_dispatch.cache.slices,
+            "slices_saved",     "", DATA_INT, cfg->demod->ook_dispatch.cache.slices_saved + cfg->demod->fsk_dispatch.cache.slices_saved,
+            "prefiltered",      "", DATA_FORMAT, "%.1f", DATA_DOUBLE, cfg->frames_ook + cfg->frames_fsk ? (double)(cfg->demod->ook_dispatch.prefiltered + cfg->demod->fsk_dispatch.prefiltered) / (cfg->frames_ook + cfg->frames_fsk) : 0.0,
             NULL);
 
     char since_str[LOCAL_TIME_BUFLEN];
@@ -952,6 +1411,15 @@ void flush_report_data(r_cfg_t *cfg)
     cfg->frames_ook = 0;
     cfg->frames_fsk = 0;
     cfg->frames_events = 0;
+    cfg->frames_rejected = 0;
+    cfg->frames_samples = 0;
+    cfg->frames_samples_skipped = 0;
+    cfg->demod->ook_dispatch.cache.slices       = 0;
+    cfg->demod->ook_dispatch.cache.slices_saved = 0;
+    cfg->demod->fsk_dispatch.cache.slices       = 0;
+    cfg->demod->fsk_dispatch.cache.slices_saved = 0;
+    cfg->demod->ook_dispatch.prefiltered        = 0;
+    cfg->demod->fsk_dispatch.prefiltered        = 0;
 
     for (void **iter = r_devs->elems; iter && *iter; ++iter) {
         r_device *r_dev = *iter;
@@ -964,6 +1432,11 @@ void flush_report_data(r_cfg_t *cfg)
         r_dev->decode_fails[2] = 0;
         r_dev->decode_fails[3] = 0;
         r_dev->decode_fails[4] = 0;
+
+        r_dev->profile_total.calls += r_dev->profile.calls;
+        r_dev->profile_total.slice_ns += r_dev->profile.slice_ns;
+        r_dev->profile_total.decode_ns += r_dev->profile.decode_ns;
+        r_dev->profile = (r_device_profile_t){0};
     }
 }
 
@@ -47,6 +47,8 @@
 #include "fileformat.h"
 #include "samp_grab.h"
 #include "am_analyze.h"
+#include "channelizer.h"
+#include "compat_pthread.h"
 #include "confparse.h"
 #include "term_ctl.h"
 #include "compat_paths.h"
@@ -159,7 +161,9 @@ static void usage(int exit_code)
             "  [-H <seconds>] Hop interval for polling of multiple frequencies (default: %d seconds)\n"
             "  [-p <ppm_error>] Correct rtl-sdr tuner frequency offset error (default: 0)\n"
             "  [-s <sample rate>] Set sample rate (default: %d Hz)\n"
-            "  [-D quit | restart | pause | manual] Input device run mode options (default: quit).\n"
+            "  [-D quit | restart | pause | manual] Input device run mode options (default: quit).\n",
+            DEFAULT_FREQUENCY, DEFAULT_HOP_TIME, DEFAULT_SAMPLE_RATE);
+    term_help_fprintf(exit_code ? stderr : stdout,
             "\t\t= Demodulator options =\n"
             "  [-R <device> | help] Enable only the specified device decoding protocol (can be used multiple times)\n"
             "       Specify a negative number to disable a device decoding protocol (can be used multiple times)\n"
@@ -170,7 +174,17 @@ static void usage(int exit_code)
             "  [-Y minsnr=<dB level>] Minimum SNR to determine pulses (1.0 to 99.0).\n"
             "  [-Y autolevel] Set minlevel automatically based on average estimated noise.\n"
             "  [-Y squelch] Skip frames below estimated noise level to reduce cpu load.\n"
+            "  [-Y fastsquelch] Squelch on a subsample first, compute the envelope only if a block is loud.\n"
             "  [-Y ampest | magest] Choose amplitude or magnitude level estimator.\n"
+            "  [-Y decimate=<n>] Decimate the input by n (2 to 16) before demodulation, e.g. 1M to 250k with n=4, not with raw IQ dumpers (-w *.cu8, *.cs8, *.cs16, *.cf32).\n"
+            "  [-Y channels=<n>] Split the input into n (2 to 64, a power of two) channels and decode all of them.\n"
+            "  [-Y threads=<n>] Run the decoders of each package on n threads (2 to 64), the output order is kept.\n"
+            "  [-Y adaptive[=<n>]] Run the decoders of a priority by recent hits, halved after n packages (default: 1000),\n"
+            "       and skip the rest of the priority after a hit. Runs the decoders on one thread.\n"
+            "  [-Y always=<n>] In adaptive mode still run protocol n after a hit (can be used multiple times).\n"
+            "  [-Y fmdisc=atan2 | poly | conj] FM discriminator: integer atan2 (default), polynomial atan2, or conjugate product.\n"
+            "  [-Y amfilter=iir | fir | biquad] AM low pass: fixed first order (default), or FIR or Butterworth designed for the sample rate.\n"
+            "  [-Y amcutoff=<n>] AM low pass cutoff in Hz, e.g. 5k, for fir and biquad (default 10k).\n"
             "\t\t= Analyze/Debug options =\n"
             "  [-A] Pulse Analyzer. Enable pulse analysis and decode attempt.\n"
             "       Disable all decoders with -R 0 if you want analyzer output only.\n"
@@ -192,8 +206,7 @@ static void usage(int exit_code)
             "  [-T <seconds>] Specify number of seconds to run, also 12:34 or 1h23m45s\n"
             "  [-E hop | quit] Hop/Quit after outputting successful event(s)\n"
             "  [-h] Output this usage help and exit\n"
-            "       Use -d, -g, -R, -X, -F, -M, -r, -w, or -W without argument for more help\n\n",
-            DEFAULT_FREQUENCY, DEFAULT_HOP_TIME, DEFAULT_SAMPLE_RATE);
+            "       Use -d, -g, -R, -X, -F, -M, -r, -w, or -W without argument for more help\n\n");
     exit(exit_code);
 }
 
@@ -413,62 +426,173 @@ static void reset_sdr_callback(r_cfg_t *cfg)
 
     baseband_low_pass_filter_reset(&demod->lowpass_filter_state);
     baseband_demod_FM_reset(&demod->demod_FM_state);
+    baseband_decimator_reset(&demod->decimator);
 
     pulse_detect_reset(demod->pulse_detect);
+
+    if (demod->channelizer) {
+        channelizer_reset(demod->channelizer);
+        for (unsigned c = 0; c < demod->num_channels; ++c) {
+            struct dm_state *ch_demod = demod->channels[c].demod;
+            ch_demod->min_level_auto  = 0.0f;
+            ch_demod->noise_level     = 0.0f;
+            baseband_low_pass_filter_reset(&ch_demod->lowpass_filter_state);
+            baseband_demod_FM_reset(&ch_demod->demod_FM_state);
+            pulse_detect_reset(ch_demod->pulse_detect);
+        }
+    }
 }
 
-static void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
+/// Get the resident set size of this process in KiB, 0 if not available.
+static unsigned long resident_size_kib(void)
+{
+#ifdef __linux__
+    unsigned long size     = 0;
+    unsigned long resident = 0;
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (!fp)
+        return 0;
+    if (fscanf(fp, "%lu %lu", &size, &resident) != 2)
+        resident = 0;
+    fclose(fp);
+    return resident * (unsigned long)sysconf(_SC_PAGESIZE) / 1024;
+#else
+    return 0;
+#endif
+}
+
+/// Create the channelizer and a demodulator state per channel, with the detector settings of the main demod.
+static void create_channels(r_cfg_t *cfg)
 {
-    //fprintf(stderr, "sdr_callback... %u\n", len);
-    r_cfg_t *cfg = ctx;
     struct dm_state *demod = cfg->demod;
-    char time_str[LOCAL_TIME_BUFLEN];
-    unsigned long n_samples;
 
-    if (!demod) {
-        // might happen when the demod closed and we get a last data frame
-        return; // ignore the data
+    if (demod->decimation > 1 || demod->dumper.len || demod->samp_grab || demod->am_analyze) {
+        print_log(LOG_ERROR, "Channelizer", "Channels can't be combined with decimation, dumpers, the signal grabber, or the AM analyzer.");
+        exit(1);
     }
-
-    // do this here and not in sdr_handler so realtime replay can use rtl_tcp output
-    for (void **iter = cfg->raw_handler.elems; iter && *iter; ++iter) {
-        raw_output_t *output = *iter;
-        raw_output_frame(output, iq_buf, len);
+    unsigned n = demod->num_channels;
+    if (n < 2 || n > CHANNELIZER_MAX_CHANNELS || (n & (n - 1))) {
+        print_logf(LOG_ERROR, "Channelizer", "Number of channels (%u) must be a power of two from 2 to %d.", demod->num_channels, CHANNELIZER_MAX_CHANNELS);
+        exit(1);
     }
+    demod->channelizer = channelizer_create(demod->num_channels);
+    if (!demod->channelizer)
+        FATAL_CALLOC("create_channels()");
+    demod->channels = calloc(demod->num_channels, sizeof(*demod->channels));
+    if (!demod->channels)
+        FATAL_CALLOC("create_channels()");
+
+    for (unsigned c = 0; c < demod->num_channels; ++c) {
+        struct dm_state *ch_demod = calloc(1, sizeof(*ch_demod));
+        if (!ch_demod)
+            FATAL_CALLOC("create_channels()");
+        ch_demod->auto_level       = demod->auto_level;
+        ch_demod->squelch_offset   = demod->squelch_offset;
+        ch_demod->fast_squelch     = demod->fast_squelch;
+        ch_demod->level_limit      = demod->level_limit;
+        ch_demod->min_level        = demod->min_level;
+        ch_demod->min_snr          = demod->min_snr;
+        ch_demod->low_pass         = demod->low_pass;
+        ch_demod->am_filter        = demod->am_filter;
+        ch_demod->am_cutoff        = demod->am_cutoff;
+        ch_demod->use_mag_est      = 1; // the channels are CS16
+        ch_demod->detect_verbosity = demod->detect_verbosity;
+        ch_demod->analyze_pulses   = demod->analyze_pulses;
+        ch_demod->sample_size      = sizeof(int16_t) * 2;
+        ch_demod->pulse_detect     = pulse_detect_create();
+        pulse_detect_set_levels(ch_demod->pulse_detect, ch_demod->use_mag_est, ch_demod->level_limit, ch_demod->min_level, ch_demod->min_snr, ch_demod->detect_verbosity);
+        demod->channels[c].demod = ch_demod;
+    }
+
+#ifdef THREADS
+    // the channel threads start once and wait for each buffer
+    demod->channel_pool = decoder_pool_create(demod->num_channels);
+    if (!demod->channel_pool)
+        print_log(LOG_WARNING, "Channelizer", "Can't start the channel threads, demodulating the channels on one thread.");
+#endif
+}
 
-    if ((cfg->bytes_to_read > 0) && (cfg->bytes_to_read <= len)) {
-        len = cfg->bytes_to_read;
-        cfg->exit_async = 1;
+/// Track the noise level, and adjust the minimum detection level if auto_level is set.
+static void track_noise_level(struct dm_state *demod, float avg_db, int noise_only)
+{
+    if (noise_only) {
+        demod->noise_level = (demod->noise_level * 7 + avg_db) / 8; // fast fall over 8 frames
+        // If auto_level and noise level well below min_level and significant change in noise level
+        if (demod->auto_level > 0 && demod->noise_level < demod->min_level - 3.0f
+                && fabsf(demod->min_level_auto - demod->noise_level - 3.0f) > 1.0f) {
+            demod->min_level_auto = demod->noise_level + 3.0f;
+            print_logf(LOG_WARNING, "Auto Level", "Estimated noise level is %.1f dB, adjusting minimum detection level to %.1f dB",
+                    demod->noise_level, demod->min_level_auto);
+            pulse_detect_set_levels(demod->pulse_detect, demod->use_mag_est, demod->level_limit, demod->min_level_auto, demod->min_snr, demod->detect_verbosity);
+        }
+    } else {
+        demod->noise_level = (demod->noise_level * 31 + avg_db) / 32; // slow rise over 32 frames
     }
+}
 
-    // save last frame time to see if a new second started
-    time_t last_frame_sec = demod->now.tv_sec;
-    get_time_now(&demod->now);
+/// Margin above the noise level of the loudest block that opens the fast squelch, in dB.
+#define SQUELCH_PEAK_MARGIN 6.0f
+
+/** AM and FM demodulate a frame of samples and track the noise level.
+
+    @param demod the demodulator state to use
+    @param iq_buf input samples
+    @param n_samples number of samples to process
+    @param sample_size CU8: 2, CS16: 4, CF32: 8
+    @param samp_rate sample rate of the input samples
+    @param fpdm the FSK pulse detector mode
+    @param[out] avg_db the average level of the frame
+    @param[out] noise_only set if the frame is below the estimated noise level
+    @param[out] skipped set if the fast squelch skipped the frame without computing the envelope
+    @return 1 if the frame needs further processing, 0 if it can be skipped
+*/
+static int demod_frame(struct dm_state *demod, unsigned char *iq_buf, unsigned long n_samples, int sample_size, uint32_t samp_rate, unsigned fpdm, float *avg_db_out, int *noise_only_out, int *skipped_out)
+{
+    float low_pass = demod->low_pass != 0.0f ? demod->low_pass : fpdm ? 0.2f : 0.1f;
 
-    n_samples = len / demod->sample_size;
-    if (n_samples * demod->sample_size != len) {
-        print_log(LOG_WARNING, __func__, "Sample buffer length not aligned to sample size!");
-    }
-    if (!n_samples) {
-        print_log(LOG_WARNING, __func__, "Sample buffer too short!");
-        return; // keep the watchdog timer running
-    }
+    // always process frames if loader, dumper, or analyzers are in use, otherwise skip silent frames
+    int always_process = demod->squelch_offset <= 0 || demod->load_info.format || demod->analyze_pulses || demod->dumper.len || demod->samp_grab;
+    // the squelch can't skip the frame, use a single pass for AM and FM demodulation
+    // note: without FM the FSK detector sees the envelope in the shared buf.temp/buf.fm, keep that as is
+    int fused_demod = always_process && demod->enable_FM_demod;
 
-    // age the frame position if there is one
-    if (demod->frame_start_ago)
-        demod->frame_start_ago += n_samples;
-    if (demod->frame_end_ago)
-        demod->frame_end_ago += n_samples;
+    baseband_low_pass_filter_setup(&demod->lowpass_filter_state, demod->am_filter, samp_rate, demod->am_cutoff);
 
-    cfg->watchdog++; // reset the frame acquire watchdog
+    if (demod->min_level_auto == 0.0f) {
+        demod->min_level_auto = demod->min_level;
+    }
+    if (demod->noise_level == 0.0f) {
+        demod->noise_level = demod->min_level_auto - 3.0f;
+    }
 
-    if (demod->samp_grab) {
-        samp_grab_push(demod->samp_grab, iq_buf, len);
+    // fast squelch: estimate from a subsample, compute the envelope only if the frame or any block is loud
+    float avg_db;
+    int block_loud = 0;
+    *skipped_out   = 0;
+    if (!always_process && demod->fast_squelch) {
+        float peak_db;
+        avg_db     = baseband_squelch_estimate(iq_buf, sample_size, demod->use_mag_est, n_samples, &peak_db);
+        block_loud = peak_db >= demod->noise_level + SQUELCH_PEAK_MARGIN;
+        if (!block_loud && avg_db < demod->noise_level + 3.0f) {
+            track_noise_level(demod, avg_db, 1);
+            *avg_db_out     = avg_db;
+            *noise_only_out = 1;
+            *skipped_out    = 1;
+            return 0;
+        }
     }
 
     // AM demodulation
-    float avg_db;
-    if (demod->sample_size == 2) { // CU8
+    if (fused_demod) {
+        if (sample_size == 2) { // CU8
+            avg_db = baseband_demod_AM_FM(&demod->lowpass_filter_state, &demod->demod_FM_state, iq_buf, demod->use_mag_est, demod->am_buf, demod->buf.fm, n_samples, samp_rate, low_pass);
+        } else if (sample_size == 4) { // CS16
+            avg_db = baseband_demod_AM_FM_cs16(&demod->lowpass_filter_state, &demod->demod_FM_state, (int16_t *)iq_buf, demod->am_buf, demod->buf.fm, n_samples, samp_rate, low_pass);
+        } else { // CF32
+            avg_db = baseband_demod_AM_FM_cf32(&demod->lowpass_filter_state, &demod->demod_FM_state, (float *)iq_buf, demod->am_buf, demod->buf.fm, n_samples, samp_rate, low_pass);
+        }
+    }
+    else if (sample_size == 2) { // CU8
         if (demod->use_mag_est) {
             //magnitude_true_cu8(iq_buf, demod->buf.temp, n_samples);
             avg_db = magnitude_est_cu8(iq_buf, demod->buf.temp, n_samples);
@@ -476,73 +600,148 @@ static void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
         else { // amp est
             avg_db = envelope_detect(iq_buf, demod->buf.temp, n_samples);
         }
-    } else { // CS16
+    } else if (sample_size == 4) { // CS16
         //magnitude_true_cs16((int16_t *)iq_buf, demod->buf.temp, n_samples);
         avg_db = magnitude_est_cs16((int16_t *)iq_buf, demod->buf.temp, n_samples);
+    } else { // CF32
+        avg_db = magnitude_est_cf32((float *)iq_buf, demod->buf.temp, n_samples);
     }
 
     //fprintf(stderr, "noise level: %.1f dB current: %.1f dB min level: %.1f dB\n", demod->noise_level, avg_db, demod->min_level_auto);
-    if (demod->min_level_auto == 0.0f) {
-        demod->min_level_auto = demod->min_level;
-    }
-    if (demod->noise_level == 0.0f) {
-        demod->noise_level = demod->min_level_auto - 3.0f;
-    }
     int noise_only = avg_db < demod->noise_level + 3.0f; // or demod->min_level_auto?
-    // always process frames if loader, dumper, or analyzers are in use, otherwise skip silent frames
-    int process_frame = demod->squelch_offset <= 0 || !noise_only || demod->load_info.format || demod->analyze_pulses || demod->dumper.len || demod->samp_grab;
-    cfg->total_frames_count += 1;
-    if (noise_only) {
-        cfg->total_frames_squelch += 1;
-        demod->noise_level = (demod->noise_level * 7 + avg_db) / 8; // fast fall over 8 frames
-        // If auto_level and noise level well below min_level and significant change in noise level
-        if (demod->auto_level > 0 && demod->noise_level < demod->min_level - 3.0f
-                && fabsf(demod->min_level_auto - demod->noise_level - 3.0f) > 1.0f) {
-            demod->min_level_auto = demod->noise_level + 3.0f;
-            print_logf(LOG_WARNING, "Auto Level", "Estimated noise level is %.1f dB, adjusting minimum detection level to %.1f dB",
-                    demod->noise_level, demod->min_level_auto);
-            pulse_detect_set_levels(demod->pulse_detect, demod->use_mag_est, demod->level_limit, demod->min_level_auto, demod->min_snr, demod->detect_verbosity);
+    // a loud block opens the fast squelch even if the frame average is quiet
+    int process_frame = always_process || !noise_only || block_loud;
+    track_noise_level(demod, avg_db, noise_only);
+
+    if (process_frame && !fused_demod) {
+        baseband_low_pass_filter(&demod->lowpass_filter_state, demod->buf.temp, demod->am_buf, n_samples);
+
+        // FM demodulation
+        if (demod->enable_FM_demod) {
+            if (sample_size == 2) { // CU8
+                baseband_demod_FM(&demod->demod_FM_state, iq_buf, demod->buf.fm, n_samples, samp_rate, low_pass);
+            } else if (sample_size == 4) { // CS16
+                baseband_demod_FM_cs16(&demod->demod_FM_state, (int16_t *)iq_buf, demod->buf.fm, n_samples, samp_rate, low_pass);
+            } else { // CF32
+                baseband_demod_FM_cf32(&demod->demod_FM_state, (float *)iq_buf, demod->buf.fm, n_samples, samp_rate, low_pass);
+            }
         }
-    } else {
-        demod->noise_level = (demod->noise_level * 31 + avg_db) / 32; // slow rise over 32 frames
     }
-    // Report noise every report_noise seconds, but only for the first frame that second
-    if (cfg->report_noise && last_frame_sec != demod->now.tv_sec && demod->now.tv_sec % cfg->report_noise == 0) {
-        print_logf(LOG_WARNING, "Auto Level", "Current %s level %.1f dB, estimated noise %.1f dB",
-                noise_only ? "noise" : "signal", avg_db, demod->noise_level);
+
+    *avg_db_out     = avg_db;
+    *noise_only_out = noise_only;
+    return process_frame;
+}
+
+/** Run the decoders, dumpers, and analyzers on a detected package.
+
+    @param cfg the config, decoders and dumpers are taken from cfg->demod
+    @param package_type PULSE_DATA_OOK or PULSE_DATA_FSK
+    @param pulses the package pulse data
+    @param n_samples number of samples in the current buffer
+    @param freq_offset frequency offset of the channel the package was received on, in Hz
+    @return the number of events produced
+*/
+static int process_package(r_cfg_t *cfg, int package_type, pulse_data_t *pulses, unsigned long n_samples, int freq_offset)
+{
+    struct dm_state *demod = cfg->demod;
+    char time_str[LOCAL_TIME_BUFLEN];
+    int is_fsk   = package_type == PULSE_DATA_FSK;
+    int p_events = 0; // Sensor events successfully detected per package
+
+    calc_rssi_snr(cfg, pulses);
+    // channelized packages report the frequency of their channel
+    pulses->freq1_hz += freq_offset;
+    pulses->freq2_hz += freq_offset;
+    pulses->centerfreq_hz += freq_offset;
+    if (demod->analyze_pulses) fprintf(stderr, "Detected %s package\t%s\n", is_fsk ? "FSK" : "OOK", time_pos_str(cfg, pulses->start_ago, time_str));
+
+    if (is_fsk) {
+        p_events += run_fsk_demods(&demod->fsk_dispatch, pulses);
+        cfg->total_frames_fsk += 1;
+        cfg->frames_fsk += 1;
+    }
+    else {
+        p_events += run_ook_demods(&demod->ook_dispatch, pulses);
+        cfg->total_frames_ook += 1;
+        cfg->frames_ook += 1;
     }
+    cfg->total_frames_events += p_events > 0;
+    cfg->frames_events += p_events > 0;
 
-    if (process_frame) {
-        baseband_low_pass_filter(&demod->lowpass_filter_state, demod->buf.temp, demod->am_buf, n_samples);
+    for (void **iter = demod->dumper.elems; iter && *iter; ++iter) {
+        file_info_t const *dumper = *iter;
+        if (dumper->format == VCD_LOGIC) pulse_data_print_vcd(dumper->file, pulses, is_fsk ? '"' : '\'');
+        if (dumper->format == U8_LOGIC) pulse_data_dump_raw(demod->u8_buf, n_samples, cfg->input_pos, pulses, is_fsk ? 0x04 : 0x02);
+        if (dumper->format == PULSE_OOK) pulse_data_dump(dumper->file, pulses);
     }
 
-    // FM demodulation
-    // Select the correct fsk pulse detector
-    unsigned fpdm = cfg->fsk_pulse_detect_mode;
-    if (cfg->fsk_pulse_detect_mode == FSK_PULSE_DETECT_AUTO) {
-        if (cfg->frequency[cfg->frequency_index] > FSK_PULSE_DETECTOR_LIMIT)
-            fpdm = FSK_PULSE_DETECT_NEW;
-        else
-            fpdm = FSK_PULSE_DETECT_OLD;
+    if (cfg->verbosity >= LOG_TRACE) pulse_data_print(pulses);
+    if (cfg->raw_mode == 1 || (cfg->raw_mode == 2 && p_events == 0) || (cfg->raw_mode == 3 && p_events > 0)) {
+        data_t *data = pulse_data_print_data(pulses);
+        event_occurred_handler(cfg, data);
     }
+    if (demod->analyze_pulses && (cfg->grab_mode <= 1 || (cfg->grab_mode == 2 && p_events == 0) || (cfg->grab_mode == 3 && p_events > 0))) {
+        r_device device = {.log_fn = log_device_handler, .output_ctx = cfg};
+        pulse_analyzer(pulses, package_type, &device);
+    }
+    return p_events;
+}
 
-    if (demod->enable_FM_demod && process_frame) {
-        float low_pass = demod->low_pass != 0.0f ? demod->low_pass : fpdm ? 0.2f : 0.1f;
-        if (demod->sample_size == 2) { // CU8
-            baseband_demod_FM(&demod->demod_FM_state, iq_buf, demod->buf.fm, n_samples, cfg->samp_rate, low_pass);
-        } else { // CS16
-            baseband_demod_FM_cs16(&demod->demod_FM_state, (int16_t *)iq_buf, demod->buf.fm, n_samples, cfg->samp_rate, low_pass);
+/// Demodulate and decode a buffer of samples on the single channel pipeline, returns the number of events.
+static int process_samples(r_cfg_t *cfg, unsigned char *iq_buf, uint32_t len, unsigned long n_samples, unsigned fpdm, time_t last_frame_sec)
+{
+    struct dm_state *demod = cfg->demod;
+
+    // Decimate ahead of demodulation, from here on all samples are CS16 at the reduced rate
+    int sample_size    = demod->sample_size;
+    uint32_t samp_rate = cfg->samp_rate;
+    unsigned decimation = demod->decimator.factor > 1 ? demod->decimator.factor : 1;
+    if (decimation > 1) {
+        if (sample_size == 2) { // CU8
+            n_samples = baseband_decimate_cu8(&demod->decimator, iq_buf, demod->decim_buf, n_samples);
+        } else if (sample_size == 4) { // CS16
+            n_samples = baseband_decimate_cs16(&demod->decimator, (int16_t *)iq_buf, demod->decim_buf, n_samples);
+        } else { // CF32
+            n_samples = baseband_decimate_cf32(&demod->decimator, (float *)iq_buf, demod->decim_buf, n_samples);
         }
+        iq_buf      = (unsigned char *)demod->decim_buf;
+        sample_size = sizeof(int16_t) * 2;
+        samp_rate   = cfg->samp_rate / decimation;
+    }
+
+    // age the frame position if there is one
+    if (demod->frame_start_ago)
+        demod->frame_start_ago += n_samples;
+    if (demod->frame_end_ago)
+        demod->frame_end_ago += n_samples;
+
+    float avg_db;
+    int noise_only;
+    int skipped;
+    int process_frame = demod_frame(demod, iq_buf, n_samples, sample_size, samp_rate, fpdm, &avg_db, &noise_only, &skipped);
+    cfg->total_frames_count += 1;
+    if (noise_only) {
+        cfg->total_frames_squelch += 1;
+    }
+    cfg->frames_samples += n_samples;
+    if (skipped) {
+        cfg->frames_samples_skipped += n_samples;
+    }
+    // Report noise every report_noise seconds, but only for the first frame that second
+    if (cfg->report_noise && last_frame_sec != demod->now.tv_sec && demod->now.tv_sec % cfg->report_noise == 0) {
+        print_logf(LOG_WARNING, "Auto Level", "Current %s level %.1f dB, estimated noise %.1f dB",
+                noise_only ? "noise" : "signal", avg_db, demod->noise_level);
     }
 
     // Handle special input formats
     if (demod->load_info.format == S16_AM) { // The IQ buffer is really AM demodulated data
-        if (len > sizeof(demod->am_buf))
+        if (len > demod->buf_samples * sizeof(int16_t))
             FATAL("Buffer too small");
         memcpy(demod->am_buf, iq_buf, len);
     } else if (demod->load_info.format == S16_FM) { // The IQ buffer is really FM demodulated data
         // we would need AM for the envelope too
-        if (len > sizeof(demod->buf.fm))
+        if (len > demod->buf_samples * sizeof(int16_t))
             FATAL("Buffer too small");
         memcpy(demod->buf.fm, iq_buf, len);
     }
@@ -559,8 +758,7 @@ static void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
             }
         }
         while (package_type && process_frame) {
-            int p_events = 0; // Sensor events successfully detected per package
-            package_type = pulse_detect_package(demod->pulse_detect, demod->am_buf, demod->buf.fm, n_samples, cfg->samp_rate, cfg->input_pos, &demod->pulse_data, &demod->fsk_pulse_data, fpdm);
+            package_type = pulse_detect_package(demod->pulse_detect, demod->am_buf, demod->buf.fm, n_samples, samp_rate, cfg->input_pos, &demod->pulse_data, &demod->fsk_pulse_data, fpdm);
             if (package_type) {
                 // new package: set a first frame start if we are not tracking one already
                 if (!demod->frame_start_ago)
@@ -569,61 +767,14 @@ static void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
                 demod->frame_end_ago = demod->pulse_data.end_ago;
             }
             if (package_type == PULSE_DATA_OOK) {
-                calc_rssi_snr(cfg, &demod->pulse_data);
-                if (demod->analyze_pulses) fprintf(stderr, "Detected OOK package\t%s\n", time_pos_str(cfg, demod->pulse_data.start_ago, time_str));
-
-                p_events += run_ook_demods(&demod->r_devs, &demod->pulse_data);
-                cfg->total_frames_ook += 1;
-                cfg->total_frames_events += p_events > 0;
-                cfg->frames_ook +=1;
-                cfg->frames_events += p_events > 0;
-
-                for (void **iter = demod->dumper.elems; iter && *iter; ++iter) {
-                    file_info_t const *dumper = *iter;
-                    if (dumper->format == VCD_LOGIC) pulse_data_print_vcd(dumper->file, &demod->pulse_data, '\'');
-                    if (dumper->format == U8_LOGIC) pulse_data_dump_raw(demod->u8_buf, n_samples, cfg->input_pos, &demod->pulse_data, 0x02);
-                    if (dumper->format == PULSE_OOK) pulse_data_dump(dumper->file, &demod->pulse_data);
-                }
-
-                if (cfg->verbosity >= LOG_TRACE) pulse_data_print(&demod->pulse_data);
-                if (cfg->raw_mode == 1 || (cfg->raw_mode == 2 && p_events == 0) || (cfg->raw_mode == 3 && p_events > 0)) {
-                    data_t *data = pulse_data_print_data(&demod->pulse_data);
-                    event_occurred_handler(cfg, data);
-                }
-                if (demod->analyze_pulses && (cfg->grab_mode <= 1 || (cfg->grab_mode == 2 && p_events == 0) || (cfg->grab_mode == 3 && p_events > 0)) ) {
-                    r_device device = {.log_fn = log_device_handler, .output_ctx = cfg};
-                    pulse_analyzer(&demod->pulse_data, package_type, &device);
-                }
-
+                d_events += process_package(cfg, package_type, &demod->pulse_data, n_samples, 0);
             } else if (package_type == PULSE_DATA_FSK) {
-                calc_rssi_snr(cfg, &demod->fsk_pulse_data);
-                if (demod->analyze_pulses) fprintf(stderr, "Detected FSK package\t%s\n", time_pos_str(cfg, demod->fsk_pulse_data.start_ago, time_str));
-
-                p_events += run_fsk_demods(&demod->r_devs, &demod->fsk_pulse_data);
-                cfg->total_frames_fsk +=1;
-                cfg->total_frames_events += p_events > 0;
-                cfg->frames_fsk += 1;
-                cfg->frames_events += p_events > 0;
-
-                for (void **iter = demod->dumper.elems; iter && *iter; ++iter) {
-                    file_info_t const *dumper = *iter;
-                    if (dumper->format == VCD_LOGIC) pulse_data_print_vcd(dumper->file, &demod->fsk_pulse_data, '"');
-                    if (dumper->format == U8_LOGIC) pulse_data_dump_raw(demod->u8_buf, n_samples, cfg->input_pos, &demod->fsk_pulse_data, 0x04);
-                    if (dumper->format == PULSE_OOK) pulse_data_dump(dumper->file, &demod->fsk_pulse_data);
-                }
-
-                if (cfg->verbosity >= LOG_TRACE) pulse_data_print(&demod->fsk_pulse_data);
-                if (cfg->raw_mode == 1 || (cfg->raw_mode == 2 && p_events == 0) || (cfg->raw_mode == 3 && p_events > 0)) {
-                    data_t *data = pulse_data_print_data(&demod->fsk_pulse_data);
-                    event_occurred_handler(cfg, data);
-                }
-                if (demod->analyze_pulses && (cfg->grab_mode <= 1 || (cfg->grab_mode == 2 && p_events == 0) || (cfg->grab_mode == 3 && p_events > 0))) {
-                    r_device device = {.log_fn = log_device_handler, .output_ctx = cfg};
-                    pulse_analyzer(&demod->fsk_pulse_data, package_type, &device);
-                }
-            } // if (package_type == ...
-            d_events += p_events;
+                d_events += process_package(cfg, package_type, &demod->fsk_pulse_data, n_samples, 0);
+            }
         } // while (package_type)...
+        unsigned rejected = pulse_detect_take_rejected(demod->pulse_detect);
+        cfg->total_frames_rejected += rejected;
+        cfg->frames_rejected += rejected;
 
         // add event counter to the frames currently tracked
         demod->frame_event_count += d_events;
@@ -638,7 +789,8 @@ static void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
                     unsigned start_padded = demod->frame_start_ago + frame_pad;
                     unsigned end_padded = demod->frame_end_ago - frame_pad;
                     unsigned len_padded = start_padded - end_padded;
-                    samp_grab_write(demod->samp_grab, len_padded, end_padded);
+                    // the grabber holds the input samples, scale back up from the decimated rate
+                    samp_grab_write(demod->samp_grab, len_padded * decimation, end_padded * decimation);
                 }
             }
             demod->frame_start_ago = 0;
@@ -667,46 +819,68 @@ static void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
                 || dumper->format == PULSE_OOK)
             continue;
         uint8_t *out_buf = iq_buf;  // Default is to dump IQ samples
-        unsigned long out_len = n_samples * demod->sample_size;
+        unsigned long out_len = n_samples * sample_size;
 
         if (dumper->format == CU8_IQ) {
-            if (demod->sample_size == 4) {
+            if (sample_size == 4) {
                 for (unsigned long n = 0; n < n_samples * 2; ++n)
                     ((uint8_t *)demod->buf.temp)[n] = (((int16_t *)iq_buf)[n] / 256) + 128; // scale Q0.15 to Q0.7
                 out_buf = (uint8_t *)demod->buf.temp;
                 out_len = n_samples * 2 * sizeof(uint8_t);
             }
+            else if (sample_size == 8) {
+                for (unsigned long n = 0; n < n_samples * 2; ++n) {
+                    float v = ((float *)iq_buf)[n] * 128.0f + 128.0f; // clamp float to [-1,1] and scale to Q0.7
+                    ((uint8_t *)demod->buf.temp)[n] = v < 0.0f ? 0 : v > 255.0f ? 255 : (uint8_t)v;
+                }
+                out_buf = (uint8_t *)demod->buf.temp;
+                out_len = n_samples * 2 * sizeof(uint8_t);
+            }
         }
         else if (dumper->format == CS16_IQ) {
-            if (demod->sample_size == 2) {
+            if (sample_size == 2) {
                 for (unsigned long n = 0; n < n_samples * 2; ++n)
                     ((int16_t *)demod->buf.temp)[n] = (iq_buf[n] * 256) - 32768; // scale Q0.7 to Q0.15
-                out_buf = (uint8_t *)demod->buf.temp; // this buffer is too small if out_block_size is large
+                out_buf = (uint8_t *)demod->buf.temp;
+                out_len = n_samples * 2 * sizeof(int16_t);
+            }
+            else if (sample_size == 8) {
+                for (unsigned long n = 0; n < n_samples * 2; ++n) {
+                    float v = ((float *)iq_buf)[n] * INT16_MAX; // clamp float to [-1,1] and scale to Q0.15
+                    ((int16_t *)demod->buf.temp)[n] = v < -INT16_MAX ? -INT16_MAX : v > INT16_MAX ? INT16_MAX : (int16_t)v;
+                }
+                out_buf = (uint8_t *)demod->buf.temp;
                 out_len = n_samples * 2 * sizeof(int16_t);
             }
         }
         else if (dumper->format == CS8_IQ) {
-            if (demod->sample_size == 2) {
+            if (sample_size == 2) {
                 for (unsigned long n = 0; n < n_samples * 2; ++n)
                     ((int8_t *)demod->buf.temp)[n] = (iq_buf[n] - 128);
             }
-            else if (demod->sample_size == 4) {
+            else if (sample_size == 4) {
                 for (unsigned long n = 0; n < n_samples * 2; ++n)
                     ((int8_t *)demod->buf.temp)[n] = ((int16_t *)iq_buf)[n] >> 8;
             }
+            else if (sample_size == 8) {
+                for (unsigned long n = 0; n < n_samples * 2; ++n) {
+                    float v = ((float *)iq_buf)[n] * 128.0f; // clamp float to [-1,1] and scale to Q0.7
+                    ((int8_t *)demod->buf.temp)[n] = v < -128.0f ? -128 : v > 127.0f ? 127 : (int8_t)v;
+                }
+            }
             out_buf = (uint8_t *)demod->buf.temp;
             out_len = n_samples * 2 * sizeof(int8_t);
         }
-        else if (dumper->format == CF32_IQ) {
-            if (demod->sample_size == 2) {
+        else if (dumper->format == CF32_IQ && sample_size != 8) { // CF32 input is dumped as is
+            if (sample_size == 2) {
                 for (unsigned long n = 0; n < n_samples * 2; ++n)
                     ((float *)demod->buf.temp)[n] = (iq_buf[n] - 128) / 128.0f;
             }
-            else if (demod->sample_size == 4) {
+            else if (sample_size == 4) {
                 for (unsigned long n = 0; n < n_samples * 2; ++n)
                     ((float *)demod->buf.temp)[n] = ((int16_t *)iq_buf)[n] / 32768.0f;
             }
-            out_buf = (uint8_t *)demod->buf.temp; // this buffer is too small if out_block_size is large
+            out_buf = (uint8_t *)demod->buf.temp;
             out_len = n_samples * 2 * sizeof(float);
         }
         else if (dumper->format == S16_AM) {
@@ -730,22 +904,28 @@ static void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
             out_len = n_samples * sizeof(float);
         }
         else if (dumper->format == F32_I) {
-            if (demod->sample_size == 2)
+            if (sample_size == 2)
                 for (unsigned long n = 0; n < n_samples; ++n)
                     demod->f32_buf[n] = (iq_buf[n * 2] - 128) * (1.0f / 0x80); // scale from Q0.7
-            else
+            else if (sample_size == 4)
                 for (unsigned long n = 0; n < n_samples; ++n)
                     demod->f32_buf[n] = ((int16_t *)iq_buf)[n * 2] * (1.0f / 0x8000); // scale from Q0.15
+            else
+                for (unsigned long n = 0; n < n_samples; ++n)
+                    demod->f32_buf[n] = ((float *)iq_buf)[n * 2];
             out_buf = (uint8_t *)demod->f32_buf;
             out_len = n_samples * sizeof(float);
         }
         else if (dumper->format == F32_Q) {
-            if (demod->sample_size == 2)
+            if (sample_size == 2)
                 for (unsigned long n = 0; n < n_samples; ++n)
                     demod->f32_buf[n] = (iq_buf[n * 2 + 1] - 128) * (1.0f / 0x80); // scale from Q0.7
-            else
+            else if (sample_size == 4)
                 for (unsigned long n = 0; n < n_samples; ++n)
                     demod->f32_buf[n] = ((int16_t *)iq_buf)[n * 2 + 1] * (1.0f / 0x8000); // scale from Q0.15
+            else
+                for (unsigned long n = 0; n < n_samples; ++n)
+                    demod->f32_buf[n] = ((float *)iq_buf)[n * 2 + 1];
             out_buf = (uint8_t *)demod->f32_buf;
             out_len = n_samples * sizeof(float);
         }
@@ -761,6 +941,162 @@ static void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
     }
 
     cfg->input_pos += n_samples;
+    return d_events;
+}
+
+/// Demodulate and detect packages on one channel, the packages are decoded later in channel order.
+static void channel_worker(void *ctx, unsigned job, unsigned worker)
+{
+    (void)worker;
+    dm_channel_t *channel  = &((dm_channel_t *)ctx)[job];
+    struct dm_state *demod = channel->demod;
+
+    float avg_db;
+    int process_frame = demod_frame(demod, (unsigned char *)demod->decim_buf, channel->n_samples, sizeof(int16_t) * 2, channel->samp_rate, channel->fpdm, &avg_db, &channel->noise_only, &channel->skipped);
+
+    int package_type = PULSE_DATA_OOK; // Just to get us started
+    while (package_type && process_frame && channel->detect) {
+        package_type = pulse_detect_package(demod->pulse_detect, demod->am_buf, demod->buf.fm, channel->n_samples, channel->samp_rate, channel->input_pos, &demod->pulse_data, &demod->fsk_pulse_data, channel->fpdm);
+        if (package_type) {
+            dm_package_t *package = malloc(sizeof(*package));
+            if (!package) {
+                WARN_MALLOC("channel_worker()");
+                continue; // NOTE: skips the package on alloc failure.
+            }
+            package->package_type   = package_type;
+            package->pulse_data     = demod->pulse_data;
+            package->fsk_pulse_data = demod->fsk_pulse_data;
+            list_push(&channel->packages, package);
+        }
+    }
+    channel->input_pos += channel->n_samples;
+}
+
+/// Split a buffer of samples into channels, demodulate them in parallel, then decode in channel order.
+static int process_channels(r_cfg_t *cfg, unsigned char *iq_buf, unsigned long n_samples, unsigned fpdm)
+{
+    struct dm_state *demod = cfg->demod;
+    unsigned num_channels  = channelizer_num_channels(demod->channelizer);
+    int16_t *out_bufs[CHANNELIZER_MAX_CHANNELS];
+
+    for (unsigned c = 0; c < num_channels; ++c) {
+        out_bufs[c] = demod->channels[c].demod->decim_buf;
+    }
+    uint32_t n_out;
+    if (demod->sample_size == 2) { // CU8
+        n_out = channelizer_process_cu8(demod->channelizer, iq_buf, n_samples, out_bufs);
+    } else if (demod->sample_size == 4) { // CS16
+        n_out = channelizer_process_cs16(demod->channelizer, (int16_t *)iq_buf, n_samples, out_bufs);
+    } else { // CF32
+        n_out = channelizer_process_cf32(demod->channelizer, (float *)iq_buf, n_samples, out_bufs);
+    }
+
+    for (unsigned c = 0; c < num_channels; ++c) {
+        dm_channel_t *channel = &demod->channels[c];
+        channel->n_samples    = n_out;
+        channel->samp_rate    = cfg->samp_rate / num_channels;
+        channel->fpdm         = fpdm;
+        channel->detect       = demod->r_devs.len || demod->analyze_pulses;
+        channel->demod->enable_FM_demod = demod->enable_FM_demod;
+    }
+    decoder_pool_run(demod->channel_pool, num_channels, channel_worker, demod->channels);
+
+    // decode in channel order, each package is moved to the main demod state the outputs use for meta data
+    int d_events = 0;
+    for (unsigned c = 0; c < num_channels; ++c) {
+        dm_channel_t *channel = &demod->channels[c];
+        int freq_offset       = channelizer_channel_offset(demod->channelizer, c, cfg->samp_rate);
+        cfg->total_frames_count += 1;
+        if (channel->noise_only) {
+            cfg->total_frames_squelch += 1;
+        }
+        cfg->frames_samples += n_out;
+        if (channel->skipped) {
+            cfg->frames_samples_skipped += n_out;
+        }
+        unsigned rejected = pulse_detect_take_rejected(channel->demod->pulse_detect);
+        cfg->total_frames_rejected += rejected;
+        cfg->frames_rejected += rejected;
+        for (void **iter = channel->packages.elems; iter && *iter; ++iter) {
+            dm_package_t *package = *iter;
+            demod->pulse_data     = package->pulse_data;
+            demod->fsk_pulse_data = package->fsk_pulse_data;
+            // the pulses stay in channel samples, time_pos_str() scales the times to input samples
+            pulse_data_t *pulses = package->package_type == PULSE_DATA_FSK ? &demod->fsk_pulse_data : &demod->pulse_data;
+            d_events += process_package(cfg, package->package_type, pulses, n_out, freq_offset);
+        }
+        list_free_elems(&channel->packages, free);
+    }
+    demod->frame_event_count += d_events;
+    cfg->input_pos += n_out;
+
+    return d_events;
+}
+
+static void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
+{
+    //fprintf(stderr, "sdr_callback... %u\n", len);
+    r_cfg_t *cfg = ctx;
+    struct dm_state *demod = cfg->demod;
+    unsigned long n_samples;
+
+    if (!demod) {
+        // might happen when the demod closed and we get a last data frame
+        return; // ignore the data
+    }
+
+    // do this here and not in sdr_handler so realtime replay can use rtl_tcp output
+    for (void **iter = cfg->raw_handler.elems; iter && *iter; ++iter) {
+        raw_output_t *output = *iter;
+        raw_output_frame(output, iq_buf, len);
+    }
+
+    if ((cfg->bytes_to_read > 0) && (cfg->bytes_to_read <= len)) {
+        len = cfg->bytes_to_read;
+        cfg->exit_async = 1;
+    }
+
+    // save last frame time to see if a new second started
+    time_t last_frame_sec = demod->now.tv_sec;
+    get_time_now(&demod->now);
+
+    n_samples = len / demod->sample_size;
+    if (n_samples * demod->sample_size != len) {
+        print_log(LOG_WARNING, __func__, "Sample buffer length not aligned to sample size!");
+    }
+    if (!n_samples) {
+        print_log(LOG_WARNING, __func__, "Sample buffer too short!");
+        return; // keep the watchdog timer running
+    }
+
+    cfg->watchdog++; // reset the frame acquire watchdog
+
+    // a source may deliver larger frames than the configured block size
+    if (n_samples > demod->buf_samples) {
+        print_logf(LOG_NOTICE, "Baseband", "Growing the buffers to %lu samples per frame", n_samples);
+        dm_state_alloc_buffers(demod, n_samples);
+    }
+
+    if (demod->samp_grab) {
+        samp_grab_push(demod->samp_grab, iq_buf, len);
+    }
+
+    // Select the correct fsk pulse detector
+    unsigned fpdm = cfg->fsk_pulse_detect_mode;
+    if (cfg->fsk_pulse_detect_mode == FSK_PULSE_DETECT_AUTO) {
+        if (cfg->frequency[cfg->frequency_index] > FSK_PULSE_DETECTOR_LIMIT)
+            fpdm = FSK_PULSE_DETECT_NEW;
+        else
+            fpdm = FSK_PULSE_DETECT_OLD;
+    }
+
+    int d_events; // Sensor events successfully detected
+    if (demod->channelizer) {
+        d_events = process_channels(cfg, iq_buf, n_samples, fpdm);
+    } else {
+        d_events = process_samples(cfg, iq_buf, len, n_samples, fpdm, last_frame_sec);
+    }
+
     if (cfg->bytes_to_read > 0)
         cfg->bytes_to_read -= len;
 
@@ -1201,6 +1537,7 @@ static void parse_conf_option(r_cfg_t *cfg, int opt, char *arg)
         else {
             fprintf(stderr, "Disabling all device decoders.\n");
             list_clear(&cfg->demod->r_devs, (list_elem_free_fn)free_protocol);
+            update_protocol_dispatch(cfg);
         }
         break;
     case 'X':
@@ -1302,6 +1639,11 @@ static void parse_conf_option(r_cfg_t *cfg, int opt, char *arg)
                 cfg->demod->auto_level = atoiv(val, 1); // arg_float_default(p + 9, "-Y autolevel: ");
             else if (kwargs_match(p, "squelch", &val))
                 cfg->demod->squelch_offset = atoiv(val, 1); // arg_float_default(p + 7, "-Y squelch: ");
+            else if (kwargs_match(p, "fastsquelch", &val)) {
+                cfg->demod->fast_squelch = atoiv(val, 1);
+                if (cfg->demod->fast_squelch && cfg->demod->squelch_offset <= 0)
+                    cfg->demod->squelch_offset = 1;
+            }
             else if (kwargs_match(p, "auto", &val))
                 cfg->fsk_pulse_detect_mode = FSK_PULSE_DETECT_AUTO;
             else if (kwargs_match(p, "classic", &val))
@@ -1322,6 +1664,63 @@ static void parse_conf_option(r_cfg_t *cfg, int opt, char *arg)
                 cfg->demod->min_snr = arg_float(val, "-Y minsnr: ");
             else if (kwargs_match(p, "filter", &val))
                 cfg->demod->low_pass = arg_float(val, "-Y filter: ");
+            else if (kwargs_match(p, "fmdisc", &val)) {
+                if (val && kwargs_match(val, "atan2", NULL))
+                    baseband_fm_disc_select(BASEBAND_FM_ATAN2);
+                else if (val && kwargs_match(val, "poly", NULL))
+                    baseband_fm_disc_select(BASEBAND_FM_POLY);
+                else if (val && kwargs_match(val, "conj", NULL))
+                    baseband_fm_disc_select(BASEBAND_FM_CONJ);
+                else {
+                    fprintf(stderr, "Unknown FM discriminator: %s\n", p);
+                    usage(1);
+                }
+            }
+            else if (kwargs_match(p, "amfilter", &val)) {
+                if (val && kwargs_match(val, "iir", NULL))
+                    cfg->demod->am_filter = BASEBAND_LP_IIR;
+                else if (val && kwargs_match(val, "fir", NULL))
+                    cfg->demod->am_filter = BASEBAND_LP_FIR;
+                else if (val && kwargs_match(val, "biquad", NULL))
+                    cfg->demod->am_filter = BASEBAND_LP_BIQUAD;
+                else {
+                    fprintf(stderr, "Unknown AM low pass filter: %s\n", p);
+                    usage(1);
+                }
+            }
+            else if (kwargs_match(p, "amcutoff", &val))
+                cfg->demod->am_cutoff = atouint32_metric(val, "-Y amcutoff: ");
+            else if (kwargs_match(p, "channels", &val))
+                cfg->demod->num_channels = atoiv(val, 0);
+            else if (kwargs_match(p, "threads", &val)) {
+                cfg->demod->decoder_threads = atoiv(val, 0);
+                if (cfg->demod->decoder_threads > DECODER_POOL_MAX_THREADS) {
+                    fprintf(stderr, "Decoder threads %u too many, maximum is %d\n", cfg->demod->decoder_threads, DECODER_POOL_MAX_THREADS);
+                    usage(1);
+                }
+            }
+            else if (kwargs_match(p, "adaptive", &val)) {
+                cfg->demod->adaptive_half_life = atoiv(val, DEFAULT_ADAPTIVE_HALF_LIFE);
+            }
+            else if (kwargs_match(p, "always", &val)) {
+                int protocol = atoiv(val, 0);
+                if (protocol <= 0) {
+                    fprintf(stderr, "Always run needs a protocol number: %s\n", p);
+                    usage(1);
+                }
+                unsigned *always_run = realloc(cfg->demod->always_run, (cfg->demod->num_always_run + 1) * sizeof(*always_run));
+                if (!always_run)
+                    FATAL_REALLOC("parse_conf_option()");
+                always_run[cfg->demod->num_always_run++] = (unsigned)protocol;
+                cfg->demod->always_run = always_run;
+            }
+            else if (kwargs_match(p, "decimate", &val)) {
+                cfg->demod->decimation = atoiv(val, 0);
+                if (cfg->demod->decimation > DECIMATOR_MAX_FACTOR) {
+                    fprintf(stderr, "Decimation factor %u too large, maximum is %d\n", cfg->demod->decimation, DECIMATOR_MAX_FACTOR);
+                    usage(1);
+                }
+            }
             else {
                 fprintf(stderr, "Unknown pulse detector setting: %s\n", p);
                 usage(1);
@@ -1659,6 +2058,33 @@ int main(int argc, char **argv) {
         add_infile(cfg, argv[optind++]);
     }
 
+    // raw IQ dumpers would record the decimated samples at the decimated rate
+    if (demod->decimation > 1) {
+        for (void **iter = demod->dumper.elems; iter && *iter; ++iter) {
+            file_info_t const *dumper = *iter;
+            if (dumper->format == CU8_IQ || dumper->format == CS8_IQ || dumper->format == CS16_IQ || dumper->format == CF32_IQ) {
+                print_logf(LOG_ERROR, "Decimate", "Raw IQ dumper (%s) can't be combined with decimation.", dumper->spec);
+                exit(1);
+            }
+        }
+    }
+    // the decimated and channelized samples are CS16, which always uses the magnitude estimator
+    if (demod->decimation > 1 || demod->num_channels > 1) {
+        demod->use_mag_est = 1;
+    }
+    baseband_decimator_setup(&demod->decimator, demod->decimation);
+    if (demod->num_channels > 1) {
+        create_channels(cfg);
+    }
+    if (demod->decoder_threads > 1) {
+        demod->decoder_pool = decoder_pool_create(demod->decoder_threads);
+        if (!demod->decoder_pool)
+            print_logf(LOG_WARNING, "Decoders", "Can't start %u decoder threads, decoding on one thread.", demod->decoder_threads);
+    }
+    if (demod->decoder_threads > 1 || demod->adaptive_half_life) {
+        update_protocol_dispatch(cfg);
+    }
+
     pulse_detect_set_levels(demod->pulse_detect, demod->use_mag_est, demod->level_limit, demod->min_level, demod->min_snr, demod->detect_verbosity);
 
     if (demod->am_analyze) {
@@ -1745,6 +2171,25 @@ int main(int argc, char **argv) {
         print_logf(LOG_NOTICE, "Protocols", "Registered %zu out of %u device decoding protocols%s",
                 demod->r_devs.len, cfg->num_r_devices, decoders_str);
     }
+    print_logf(LOG_INFO, "Baseband", "Using %s baseband kernels, %s FM discriminator",
+            baseband_simd_name(baseband_simd_current()), baseband_fm_disc_name(baseband_fm_disc_current()));
+    if (demod->decimation > 1) {
+        print_logf(LOG_INFO, "Baseband", "Decimating the input by %u before demodulation", demod->decimator.factor);
+    }
+    if (demod->channelizer) {
+        print_logf(LOG_INFO, "Baseband", "Splitting the input into %u channels", demod->num_channels);
+    }
+    if (demod->decoder_pool) {
+        print_logf(LOG_INFO, "Decoders", "Running the decoders on %u threads", decoder_pool_num_threads(demod->decoder_pool));
+    }
+    if (demod->adaptive_half_life) {
+        print_logf(LOG_INFO, "Decoders", "Ordering the decoders by hits with a half-life of %u packages", demod->adaptive_half_life);
+        if (demod->decoder_pool)
+            print_logf(LOG_WARNING, "Decoders", "Adaptive decoder order runs the decoders on one thread.");
+    }
+    else if (demod->num_always_run) {
+        print_logf(LOG_WARNING, "Decoders", "Always run decoders have no effect without adaptive order.");
+    }
 
     char const **well_known = well_known_output_fields(cfg);
     start_outputs(cfg, well_known);
@@ -1761,6 +2206,20 @@ int main(int argc, char **argv) {
         cfg->out_block_size = DEFAULT_BUF_LENGTH;
     }
 
+    // size the buffers from the block size, file inputs are read in default sized blocks
+    {
+        uint32_t frame_len = cfg->in_files.len ? MAX(cfg->out_block_size, DEFAULT_BUF_LENGTH) : cfg->out_block_size;
+        unsigned long max_samples = frame_len / (sizeof(uint8_t) * 2); // CU8 has the most samples per byte
+        size_t buf_size = dm_state_alloc_buffers(demod, max_samples);
+        unsigned long rss_kib = resident_size_kib();
+        if (rss_kib)
+            print_logf(LOG_INFO, "Baseband", "Buffers for %lu samples per frame use %zu KiB, resident size %lu KiB",
+                    max_samples, buf_size / 1024, rss_kib);
+        else
+            print_logf(LOG_INFO, "Baseband", "Buffers for %lu samples per frame use %zu KiB",
+                    max_samples, buf_size / 1024);
+    }
+
     // Special case for streaming test data
     if (cfg->test_data && (!strcasecmp(cfg->test_data, "-") || *cfg->test_data == '@')) {
         FILE *fp;
@@ -1810,10 +2269,13 @@ int main(int argc, char **argv) {
                     rfraw_parse(&pulse_data, e);
                     list_t single_dev = {0};
                     list_push(&single_dev, r_dev);
+                    r_dispatch_t single_dispatch = {0};
+                    r_dispatch_build(&single_dispatch, &single_dev, pulse_data.fsk_f2_est != 0);
                     if (!pulse_data.fsk_f2_est)
-                        r += run_ook_demods(&single_dev, &pulse_data);
+                        r += run_ook_demods(&single_dispatch, &pulse_data);
                     else
-                        r += run_fsk_demods(&single_dev, &pulse_data);
+                        r += run_fsk_demods(&single_dispatch, &pulse_data);
+                    r_dispatch_free(&single_dispatch);
                     list_free_elems(&single_dev, NULL);
                 } else
                 r += pulse_slicer_string(e, r_dev);
@@ -1824,9 +2286,9 @@ int main(int argc, char **argv) {
                 pulse_data_t pulse_data = {0};
                 rfraw_parse(&pulse_data, line);
                 if (!pulse_data.fsk_f2_est)
-                    r += run_ook_demods(&demod->r_devs, &pulse_data);
+                    r += run_ook_demods(&demod->ook_dispatch, &pulse_data);
                 else
-                    r += run_fsk_demods(&demod->r_devs, &pulse_data);
+                    r += run_fsk_demods(&demod->fsk_dispatch, &pulse_data);
             } else
             for (void **iter = demod->r_devs.elems; iter && *iter; ++iter) {
                 r_device *r_dev = *iter;
@@ -1850,9 +2312,9 @@ int main(int argc, char **argv) {
             pulse_data_t pulse_data = {0};
             rfraw_parse(&pulse_data, cfg->test_data);
             if (!pulse_data.fsk_f2_est)
-                r += run_ook_demods(&demod->r_devs, &pulse_data);
+                r += run_ook_demods(&demod->ook_dispatch, &pulse_data);
             else
-                r += run_fsk_demods(&demod->r_devs, &pulse_data);
+                r += run_fsk_demods(&demod->fsk_dispatch, &pulse_data);
         } else
         for (void **iter = demod->r_devs.elems; iter && *iter; ++iter) {
             r_device *r_dev = *iter;
@@ -1866,12 +2328,10 @@ int main(int argc, char **argv) {
 
     // Special case for in files
     if (cfg->in_files.len) {
-        unsigned char *test_mode_buf = malloc(DEFAULT_BUF_LENGTH * sizeof(unsigned char));
+        // CF32 blocks hold as many samples as CS16 blocks, i.e. twice the bytes
+        unsigned char *test_mode_buf = malloc(DEFAULT_BUF_LENGTH / sizeof(int16_t) * sizeof(float));
         if (!test_mode_buf)
             FATAL_MALLOC("test_mode_buf");
-        float *test_mode_float_buf = malloc(DEFAULT_BUF_LENGTH / sizeof(int16_t) * sizeof(float));
-        if (!test_mode_float_buf)
-            FATAL_MALLOC("test_mode_float_buf");
 
         if (cfg->duration > 0) {
             time(&cfg->stop_time);
@@ -1904,9 +2364,10 @@ int main(int argc, char **argv) {
                     || demod->load_info.format == S16_AM
                     || demod->load_info.format == S16_FM) {
                 demod->sample_size = sizeof(uint8_t) * 2; // CU8, AM, FM
-            } else if (demod->load_info.format == CS16_IQ
-                    || demod->load_info.format == CF32_IQ) {
-                demod->sample_size = sizeof(int16_t) * 2; // CS16, CF32 (after conversion)
+            } else if (demod->load_info.format == CS16_IQ) {
+                demod->sample_size = sizeof(int16_t) * 2; // CS16
+            } else if (demod->load_info.format == CF32_IQ) {
+                demod->sample_size = sizeof(float) * 2; // CF32
             } else if (demod->load_info.format == PULSE_OOK) {
                 // ignore
             } else {
@@ -1917,6 +2378,11 @@ int main(int argc, char **argv) {
                 print_logf(LOG_NOTICE, "Input", "Input format \"%s\"", file_info_string(&demod->load_info));
             }
             demod->sample_file_pos = 0.0;
+            // AM and FM inputs are already demodulated and can't be decimated
+            if (demod->load_info.format == S16_AM || demod->load_info.format == S16_FM)
+                baseband_decimator_setup(&demod->decimator, 1);
+            else
+                baseband_decimator_setup(&demod->decimator, demod->decimation);
 
             // special case for pulse data file-inputs
             if (demod->load_info.format == PULSE_OOK) {
@@ -1938,10 +2404,10 @@ int main(int argc, char **argv) {
                     }
 
                     if (demod->pulse_data.fsk_f2_est) {
-                        run_fsk_demods(&demod->r_devs, &demod->pulse_data);
+                        run_fsk_demods(&demod->fsk_dispatch, &demod->pulse_data);
                     }
                     else {
-                        int p_events = run_ook_demods(&demod->r_devs, &demod->pulse_data);
+                        int p_events = run_ook_demods(&demod->ook_dispatch, &demod->pulse_data);
                         if (cfg->verbosity >= LOG_DEBUG)
                             pulse_data_print(&demod->pulse_data);
                         if (demod->analyze_pulses && (cfg->grab_mode <= 1 || (cfg->grab_mode == 2 && p_events == 0) || (cfg->grab_mode == 3 && p_events > 0))) {
@@ -1961,42 +2427,26 @@ int main(int argc, char **argv) {
             // default case for file-inputs
             int n_blocks = 0;
             unsigned long n_read;
+            unsigned long block_len = demod->sample_size == 8 ? DEFAULT_BUF_LENGTH / sizeof(int16_t) * sizeof(float) : DEFAULT_BUF_LENGTH;
             delay_timer_t delay_timer;
             delay_timer_init(&delay_timer);
             do {
                 // Replay in realtime if requested
                 if (cfg->in_replay) {
                     // per block delay
-                    unsigned delay_us = (unsigned)(1000000llu * DEFAULT_BUF_LENGTH / cfg->samp_rate / demod->sample_size / cfg->in_replay);
-                    if (demod->load_info.format == CF32_IQ)
-                        delay_us /= 2; // adjust for float only reading half as many samples
+                    unsigned delay_us = (unsigned)(1000000llu * block_len / cfg->samp_rate / demod->sample_size / cfg->in_replay);
                     delay_timer_wait(&delay_timer, delay_us);
                 }
-                // Convert CF32 file to CS16 buffer
-                if (demod->load_info.format == CF32_IQ) {
-                    n_read = fread(test_mode_float_buf, sizeof(float), DEFAULT_BUF_LENGTH / 2, in_file);
-                    // clamp float to [-1,1] and scale to Q0.15
+                n_read = fread(test_mode_buf, 1, block_len, in_file);
+
+                // Convert CS8 file to CU8 buffer
+                if (demod->load_info.format == CS8_IQ) {
                     for (unsigned long n = 0; n < n_read; n++) {
-                        int s_tmp = test_mode_float_buf[n] * INT16_MAX;
-                        if (s_tmp < -INT16_MAX)
-                            s_tmp = -INT16_MAX;
-                        else if (s_tmp > INT16_MAX)
-                            s_tmp = INT16_MAX;
-                        ((int16_t *)test_mode_buf)[n] = s_tmp;
-                    }
-                    n_read *= 2; // convert to byte count
-                } else {
-                    n_read = fread(test_mode_buf, 1, DEFAULT_BUF_LENGTH, in_file);
-
-                    // Convert CS8 file to CU8 buffer
-                    if (demod->load_info.format == CS8_IQ) {
-                        for (unsigned long n = 0; n < n_read; n++) {
-                            test_mode_buf[n] = ((int8_t)test_mode_buf[n]) + 128;
-                        }
+                        test_mode_buf[n] = ((int8_t)test_mode_buf[n]) + 128;
                     }
                 }
                 if (n_read == 0) break;  // sdr_callback() will Segmentation Fault with len=0
-                demod->sample_file_pos = ((float)n_blocks * DEFAULT_BUF_LENGTH + n_read) / cfg->samp_rate / demod->sample_size;
+                demod->sample_file_pos = ((float)n_blocks * block_len + n_read) / cfg->samp_rate / demod->sample_size;
                 n_blocks++; // this assumes n_read == DEFAULT_BUF_LENGTH
                 sdr_callback(test_mode_buf, n_read, cfg);
             } while (n_read != 0 && !cfg->exit_async);
@@ -2009,14 +2459,19 @@ int main(int argc, char **argv) {
                 //    ((uint16_t *)test_mode_buf)[n] = 0x807f;
             }
             else { // CF32, CS16
-                    memset(test_mode_buf, 0, DEFAULT_BUF_LENGTH);
+                    memset(test_mode_buf, 0, block_len);
             }
-            demod->sample_file_pos = ((float)n_blocks + 1) * DEFAULT_BUF_LENGTH / cfg->samp_rate / demod->sample_size;
-            sdr_callback(test_mode_buf, DEFAULT_BUF_LENGTH, cfg);
+            demod->sample_file_pos = ((float)n_blocks + 1) * block_len / cfg->samp_rate / demod->sample_size;
+            sdr_callback(test_mode_buf, block_len, cfg);
 
             //Always classify a signal at the end of the file
             if (demod->am_analyze)
                 am_analyze_classify(demod->am_analyze);
+            // report the statistics of each file
+            if (cfg->report_stats > 0) {
+                event_occurred_handler(cfg, create_report_data(cfg, cfg->report_stats));
+                flush_report_data(cfg);
+            }
             if (cfg->verbosity >= LOG_NOTICE) {
                 print_logf(LOG_NOTICE, "Input", "Test mode file issued %d packets", n_blocks);
             }
@@ -2029,7 +2484,6 @@ int main(int argc, char **argv) {
 
         close_dumpers(cfg);
         free(test_mode_buf);
-        free(test_mode_float_buf);
         r_free_cfg(cfg);
         exit(0);
     }
@@ -217,8 +217,9 @@ int term_get_columns(void *ctx)
     return (c_info.srWindow.Right - c_info.srWindow.Left + 1);
 #else
     FILE *fp = (FILE *)ctx;
-    struct winsize w;
-    ioctl(fileno(fp), TIOCGWINSZ, &w);
+    struct winsize w = {0};
+    if (ioctl(fileno(fp), TIOCGWINSZ, &w) < 0)
+        return 0; // not a terminal
     return w.ws_col;
 #endif
 }
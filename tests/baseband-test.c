@@ -33,6 +33,8 @@ typedef SSIZE_T ssize_t;
 #endif
 
 #include <time.h>
+#include <string.h>
+#include <math.h>
 
 #include "fatal.h"
 #include "baseband.h"
@@ -46,6 +48,16 @@ typedef SSIZE_T ssize_t;
         printf("Time elapsed in ms: %f for: %s\n", elapsed, label);        \
     } while (0)
 
+#define MEASURE_RATE(label, n_samples, block)                                              \
+    do {                                                                                  \
+        clock_t start = clock();                                                          \
+        block;                                                                            \
+        clock_t stop   = clock();                                                         \
+        double elapsed = (double)(stop - start) * 1000.0 / CLOCKS_PER_SEC;                \
+        double rate    = elapsed > 0.0 ? (n_samples) / elapsed / 1000.0 : 0.0;            \
+        printf("Time elapsed in ms: %f (%.1f MS/s) for: %s\n", elapsed, rate, label);     \
+    } while (0)
+
 static int read_buf(const char *filename, void *buf, size_t nbyte)
 {
     int fd = open(filename, O_RDONLY);
@@ -70,6 +82,265 @@ static int write_buf(const char *filename, const void *buf, size_t nbyte)
     return ret;
 }
 
+/// Compare each available SIMD level against the scalar reference, and measure the throughput.
+static int compare_simd(uint8_t const *cu8_buf, int16_t const *cs16_buf, float const *cf32_buf, unsigned long n_samples, uint16_t *ref_buf, uint16_t *y16_buf)
+{
+    int failed = 0;
+    char label[64];
+    // odd length to also exercise the scalar tail
+    unsigned long len = n_samples > 7 ? n_samples - 7 : n_samples;
+
+    for (int level = BASEBAND_SIMD_NONE; level <= BASEBAND_SIMD_BEST; ++level) {
+        if (baseband_simd_select(level) != level)
+            continue; // not available on this build or cpu
+        char const *name = baseband_simd_name(level);
+
+        for (int fn = 0; fn < 4; ++fn) {
+            char const *fn_name = fn == 0 ? "envelope_detect" : fn == 1 ? "magnitude_est_cu8" : fn == 2 ? "magnitude_est_cs16" : "magnitude_est_cf32";
+            float db = 0.0f;
+            float ref_db = 0.0f;
+
+            baseband_simd_select(BASEBAND_SIMD_NONE);
+            memset(ref_buf, 0, sizeof(uint16_t) * n_samples);
+            if (fn == 0)
+                ref_db = envelope_detect(cu8_buf, ref_buf, len);
+            else if (fn == 1)
+                ref_db = magnitude_est_cu8(cu8_buf, ref_buf, len);
+            else if (fn == 2)
+                ref_db = magnitude_est_cs16(cs16_buf, ref_buf, len);
+            else
+                ref_db = magnitude_est_cf32(cf32_buf, ref_buf, len);
+
+            baseband_simd_select(level);
+            memset(y16_buf, 0, sizeof(uint16_t) * n_samples);
+            snprintf(label, sizeof(label), "%s (%s)", fn_name, name);
+            MEASURE_RATE(label, len,
+                if (fn == 0)
+                    db = envelope_detect(cu8_buf, y16_buf, len);
+                else if (fn == 1)
+                    db = magnitude_est_cu8(cu8_buf, y16_buf, len);
+                else if (fn == 2)
+                    db = magnitude_est_cs16(cs16_buf, y16_buf, len);
+                else
+                    db = magnitude_est_cf32(cf32_buf, y16_buf, len);
+            );
+
+            if (db != ref_db || memcmp(ref_buf, y16_buf, sizeof(uint16_t) * n_samples)) {
+                fprintf(stderr, "MISMATCH: %s differs from the scalar version\n", label);
+                failed++;
+            }
+        }
+    }
+    baseband_simd_select(BASEBAND_SIMD_BEST);
+    return failed;
+}
+
+/// Compare the fused AM and FM demodulator against the separate passes, and measure the throughput.
+static int compare_fused(uint8_t const *cu8_buf, unsigned long n_samples, uint16_t *env_buf, int16_t *am_buf, int16_t *fm_buf, int16_t *am2_buf, int16_t *fm2_buf)
+{
+    filter_state_t lp_state;
+    demodfm_state_t fm_state;
+    float ref_db;
+    float db = 0.0f;
+
+    baseband_low_pass_filter_reset(&lp_state);
+    baseband_demod_FM_reset(&fm_state);
+
+    MEASURE_RATE("separate AM, low pass, FM passes", n_samples,
+        ref_db = envelope_detect(cu8_buf, env_buf, n_samples);
+        baseband_low_pass_filter(&lp_state, env_buf, am_buf, n_samples);
+        baseband_demod_FM(&fm_state, cu8_buf, fm_buf, n_samples, 250000, 0.1f);
+    );
+
+    baseband_low_pass_filter_reset(&lp_state);
+    baseband_demod_FM_reset(&fm_state);
+    // fault in the output pages, as the separate passes had theirs touched already
+    memset(am2_buf, 0, sizeof(int16_t) * n_samples);
+    memset(fm2_buf, 0, sizeof(int16_t) * n_samples);
+    MEASURE_RATE("baseband_demod_AM_FM", n_samples,
+        db = baseband_demod_AM_FM(&lp_state, &fm_state, cu8_buf, 0, am2_buf, fm2_buf, n_samples, 250000, 0.1f);
+    );
+
+    if (db != ref_db || memcmp(am_buf, am2_buf, sizeof(int16_t) * n_samples) || memcmp(fm_buf, fm2_buf, sizeof(int16_t) * n_samples)) {
+        fprintf(stderr, "MISMATCH: baseband_demod_AM_FM differs from the separate passes\n");
+        return 1;
+    }
+    return 0;
+}
+
+/// Measure the accuracy and throughput of each FM discriminator, and compare the SIMD levels against the scalar version.
+static int compare_fm_disc(uint8_t const *cu8_buf, int16_t const *cs16_buf, float const *cf32_buf, unsigned long n_samples, int16_t *ref_buf, int16_t *f16_buf, int32_t *f32_buf, int32_t *ref32_buf)
+{
+    int failed = 0;
+    char label[96];
+    demodfm_state_t fm_state;
+    // odd length to also exercise the scalar tail
+    unsigned long len = n_samples > 7 ? n_samples - 7 : n_samples;
+
+    for (int disc = BASEBAND_FM_ATAN2; disc <= BASEBAND_FM_CONJ; ++disc) {
+        baseband_fm_disc_select(disc);
+        char const *disc_name = baseband_fm_disc_name(disc);
+
+        // accuracy against atan2(), overall and within +-0.5 radians
+        baseband_simd_select(BASEBAND_SIMD_NONE);
+        baseband_demod_FM_reset(&fm_state);
+        baseband_fm_discriminate(&fm_state, cu8_buf, ref_buf, len);
+        baseband_demod_FM_reset(&fm_state);
+        baseband_fm_discriminate_cs16(&fm_state, cs16_buf, f32_buf, len);
+        double err_cu8 = 0.0, err_cu8_small = 0.0;
+        double err_cs16 = 0.0, err_cs16_small = 0.0;
+        for (unsigned long n = 1; n < len; ++n) {
+            int x0r = cu8_buf[2 * n] - 128;
+            int x0i = cu8_buf[2 * n + 1] - 128;
+            int x1r = cu8_buf[2 * n - 2] - 128;
+            int x1i = cu8_buf[2 * n - 1] - 128;
+            int pr  = x0r * x1r + x0i * x1i;
+            int pi  = x0i * x1r - x0r * x1i;
+            if (pr || pi) {
+                double ref = atan2(pi, pr);
+                double err = fabs(remainder(ref_buf[n] * M_PI / INT16_MAX - ref, 2 * M_PI));
+                err_cu8    = err > err_cu8 ? err : err_cu8;
+                if (fabs(ref) <= 0.5)
+                    err_cu8_small = err > err_cu8_small ? err : err_cu8_small;
+            }
+
+            int64_t qr = (int64_t)cs16_buf[2 * n] * cs16_buf[2 * n - 2] + (int64_t)cs16_buf[2 * n + 1] * cs16_buf[2 * n - 1];
+            int64_t qi = (int64_t)cs16_buf[2 * n + 1] * cs16_buf[2 * n - 2] - (int64_t)cs16_buf[2 * n] * cs16_buf[2 * n - 1];
+            if (qr || qi) {
+                double ref = atan2((double)qi, (double)qr);
+                double err = fabs(remainder(f32_buf[n] * M_PI / INT32_MAX - ref, 2 * M_PI));
+                err_cs16   = err > err_cs16 ? err : err_cs16;
+                if (fabs(ref) <= 0.5)
+                    err_cs16_small = err > err_cs16_small ? err : err_cs16_small;
+            }
+        }
+        printf("FM discriminator %s: error max %.6f rad (%.6f rad within +-0.5 rad) CU8, %.6f rad (%.6f rad) CS16\n",
+                disc_name, err_cu8, err_cu8_small, err_cs16, err_cs16_small);
+
+        for (int level = BASEBAND_SIMD_NONE; level <= BASEBAND_SIMD_BEST; ++level) {
+            if (baseband_simd_select(level) != level)
+                continue; // not available on this build or cpu
+
+            baseband_demod_FM_reset(&fm_state);
+            memset(f16_buf, 0, sizeof(int16_t) * n_samples);
+            snprintf(label, sizeof(label), "baseband_demod_FM (%s, %s)", disc_name, baseband_simd_name(level));
+            MEASURE_RATE(label, len,
+                baseband_demod_FM(&fm_state, cu8_buf, f16_buf, len, 250000, 0.1f);
+            );
+
+            baseband_demod_FM_reset(&fm_state);
+            baseband_fm_discriminate(&fm_state, cu8_buf, f16_buf, len);
+            if (memcmp(ref_buf, f16_buf, sizeof(int16_t) * len)) {
+                fprintf(stderr, "MISMATCH: %s differs from the scalar version\n", label);
+                failed++;
+            }
+
+            baseband_demod_FM_reset(&fm_state);
+            snprintf(label, sizeof(label), "baseband_demod_FM_cf32 (%s, %s)", disc_name, baseband_simd_name(level));
+            MEASURE_RATE(label, len,
+                baseband_demod_FM_cf32(&fm_state, cf32_buf, f16_buf, len, 250000, 0.1f);
+            );
+
+            baseband_demod_FM_reset(&fm_state);
+            baseband_fm_discriminate_cf32(&fm_state, cf32_buf, f32_buf, len);
+            if (level == BASEBAND_SIMD_NONE)
+                memcpy(ref32_buf, f32_buf, sizeof(int32_t) * len);
+            else if (memcmp(ref32_buf, f32_buf, sizeof(int32_t) * len)) {
+                fprintf(stderr, "MISMATCH: %s differs from the scalar version\n", label);
+                failed++;
+            }
+        }
+
+        baseband_demod_FM_reset(&fm_state);
+        snprintf(label, sizeof(label), "baseband_demod_FM_cs16 (%s)", disc_name);
+        MEASURE_RATE(label, len,
+            baseband_demod_FM_cs16(&fm_state, cs16_buf, f16_buf, len, 250000, 0.1f);
+        );
+    }
+    baseband_fm_disc_select(BASEBAND_FM_ATAN2);
+    baseband_simd_select(BASEBAND_SIMD_BEST);
+    return failed;
+}
+
+/// Compare the designed low pass filters at each SIMD level against the scalar version, and measure the throughput.
+static int compare_low_pass(uint16_t const *env_buf, unsigned long n_samples, int16_t *ref_buf, int16_t *y16_buf)
+{
+    int failed = 0;
+    char label[96];
+    filter_state_t *lp_state = calloc(1, sizeof(*lp_state));
+    if (!lp_state) {
+        FATAL_CALLOC("compare_low_pass()");
+    }
+    // odd length to also exercise the scalar tails
+    unsigned long len = n_samples > 7 ? n_samples - 7 : n_samples;
+
+    for (int type = BASEBAND_LP_FIR; type <= BASEBAND_LP_BIQUAD; ++type) {
+        for (int samp_rate = 250000; samp_rate <= 1000000; samp_rate *= 4) {
+            char const *type_name = type == BASEBAND_LP_FIR ? "fir" : "biquad";
+
+            baseband_simd_select(BASEBAND_SIMD_NONE);
+            baseband_low_pass_filter_reset(lp_state);
+            baseband_low_pass_filter_setup(lp_state, type, samp_rate, 0.0f);
+            baseband_low_pass_filter(lp_state, env_buf, ref_buf, len);
+
+            for (int level = BASEBAND_SIMD_NONE; level <= BASEBAND_SIMD_BEST; ++level) {
+                if (baseband_simd_select(level) != level)
+                    continue; // not available on this build or cpu
+
+                snprintf(label, sizeof(label), "baseband_low_pass_filter (%s at %d Hz, %s)", type_name, samp_rate, baseband_simd_name(level));
+                baseband_low_pass_filter_reset(lp_state);
+                baseband_low_pass_filter_setup(lp_state, type, samp_rate, 0.0f);
+                memset(y16_buf, 0, sizeof(int16_t) * n_samples);
+                MEASURE_RATE(label, len,
+                    baseband_low_pass_filter(lp_state, env_buf, y16_buf, len);
+                );
+                if (memcmp(ref_buf, y16_buf, sizeof(int16_t) * len)) {
+                    fprintf(stderr, "MISMATCH: %s differs from the scalar version\n", label);
+                    failed++;
+                }
+            }
+        }
+    }
+    free(lp_state);
+    baseband_simd_select(BASEBAND_SIMD_BEST);
+    return failed;
+}
+
+/// Compare the SIMD level range kernels against the scalar version, and measure the throughput on idle sized blocks.
+static int compare_level_range(int16_t const *buf, unsigned long n_samples)
+{
+    int failed = 0;
+    char label[64];
+    uint32_t const lens[] = {1, 7, 15, 64, 100};
+
+    for (int level = BASEBAND_SIMD_NONE; level <= BASEBAND_SIMD_BEST; ++level) {
+        if (baseband_simd_select(level) != level)
+            continue; // not available on this build or cpu
+        for (unsigned long pos = 0; pos + 100 <= n_samples; pos += 997) {
+            for (unsigned k = 0; k < sizeof(lens) / sizeof(*lens); ++k) {
+                int16_t ref_min, ref_max, min, max;
+                baseband_simd_select(BASEBAND_SIMD_NONE);
+                baseband_level_range(&buf[pos], lens[k], &ref_min, &ref_max);
+                baseband_simd_select(level);
+                baseband_level_range(&buf[pos], lens[k], &min, &max);
+                if (min != ref_min || max != ref_max) {
+                    fprintf(stderr, "MISMATCH: baseband_level_range (%s) differs from the scalar version at %lu len %u\n",
+                            baseband_simd_name(level), pos, lens[k]);
+                    failed++;
+                }
+            }
+        }
+        int16_t min = 0, max = 0;
+        snprintf(label, sizeof(label), "baseband_level_range (%s)", baseband_simd_name(level));
+        MEASURE_RATE(label, n_samples,
+            for (unsigned long pos = 0; pos + 64 <= n_samples; pos += 64)
+                baseband_level_range(&buf[pos], 64, &min, &max);
+        );
+    }
+    baseband_simd_select(BASEBAND_SIMD_BEST);
+    return failed;
+}
+
 int main(int argc, char *argv[])
 {
     baseband_init();
@@ -77,6 +348,7 @@ int main(int argc, char *argv[])
     uint8_t *cu8_buf;
     uint16_t *y16_buf;
     int16_t *cs16_buf;
+    float *cf32_buf;
     uint32_t *y32_buf;
     uint16_t *u16_buf;
     uint32_t *u32_buf;
@@ -86,7 +358,7 @@ int main(int argc, char *argv[])
     long n_read;
     unsigned long n_samples;
     int max_block_size = 4096000;
-    filter_state_t state;
+    filter_state_t state = {0};
     demodfm_state_t fm_state;
 
     if (argc <= 1) {
@@ -112,6 +384,10 @@ int main(int argc, char *argv[])
     if (!cs16_buf) {
         FATAL_MALLOC("main()");
     }
+    cf32_buf = malloc(sizeof(float) * 2 * max_block_size);
+    if (!cf32_buf) {
+        FATAL_MALLOC("main()");
+    }
     y32_buf  = malloc(sizeof(uint32_t) * max_block_size);
     if (!y32_buf) {
         FATAL_MALLOC("main()");
@@ -140,6 +416,7 @@ int main(int argc, char *argv[])
         //cs16_buf[i] = (int16_t)cu8_buf[i] * 16 - 2040;
         cs16_buf[i] = (int16_t)cu8_buf[i] * 128 - 16320;
         //cs16_buf[i] = (int16_t)cu8_buf[i] * 256 - 32640;
+        cf32_buf[i] = (cu8_buf[i] - 127.5f) * (1.0f / 128);
     }
 
     MEASURE("envelope_detect",
@@ -190,12 +467,50 @@ int main(int argc, char *argv[])
     );
     write_buf("bb.cs16.fm.s16", s16_buf, sizeof(int16_t) * n_samples);
 
+    MEASURE("magnitude_est_cf32",
+        magnitude_est_cf32(cf32_buf, y16_buf, n_samples);
+    );
+    MEASURE("baseband_demod_FM_cf32",
+        baseband_demod_FM_cf32(&fm_state, cf32_buf, s16_buf, n_samples, 250000, 0.1f);
+    );
+    write_buf("bb.cf32.fm.s16", s16_buf, sizeof(int16_t) * n_samples);
+
+    decimator_state_t *decimator = malloc(sizeof(*decimator));
+    if (!decimator) {
+        FATAL_MALLOC("main()");
+    }
+    uint32_t n_decim = 0;
+    baseband_decimator_setup(decimator, 4);
+    MEASURE_RATE("baseband_decimate_cu8 (factor 4)", n_samples,
+        n_decim = baseband_decimate_cu8(decimator, cu8_buf, s16_buf, n_samples);
+    );
+    write_buf("bb.decim.cs16", s16_buf, sizeof(int16_t) * 2 * n_decim);
+    baseband_decimator_setup(decimator, 4);
+    MEASURE_RATE("baseband_decimate_cs16 (factor 4)", n_samples,
+        n_decim = baseband_decimate_cs16(decimator, cs16_buf, s16_buf, n_samples);
+    );
+    baseband_decimator_setup(decimator, 4);
+    MEASURE_RATE("baseband_decimate_cf32 (factor 4)", n_samples,
+        n_decim = baseband_decimate_cf32(decimator, cf32_buf, s16_buf, n_samples);
+    );
+    free(decimator);
+
+    int failed = compare_simd(cu8_buf, cs16_buf, cf32_buf, n_samples, u16_buf, y16_buf);
+    failed += compare_fm_disc(cu8_buf, cs16_buf, cf32_buf, n_samples, (int16_t *)y16_buf, s16_buf, s32_buf, (int32_t *)u32_buf);
+    envelope_detect(cu8_buf, y16_buf, n_samples);
+    failed += compare_low_pass(y16_buf, n_samples, s16_buf, (int16_t *)u16_buf);
+    failed += compare_fused(cu8_buf, n_samples, y16_buf, (int16_t *)u16_buf, s16_buf, (int16_t *)y32_buf, (int16_t *)u32_buf);
+    failed += compare_level_range(s16_buf, n_samples);
+
     free(cu8_buf);
     free(y16_buf);
     free(cs16_buf);
+    free(cf32_buf);
     free(y32_buf);
     free(u16_buf);
     free(u32_buf);
     free(s16_buf);
     free(s32_buf);
+
+    return failed ? 1 : 0;
 }
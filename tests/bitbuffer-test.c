@@ -0,0 +1,291 @@
+/*
+ * Bitbuffer Evaluation
+ *
+ * Functional and speed test for the bitbuffer search and Manchester decoding.
+ * With the argument "check" only the results are compared, as run by ctest.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bitbuffer.h"
+
+#define MEASURE_RATE(label, n_bits, block)                                                \
+    do {                                                                                  \
+        clock_t start = clock();                                                          \
+        block;                                                                            \
+        clock_t stop   = clock();                                                         \
+        double elapsed = (double)(stop - start) * 1000.0 / CLOCKS_PER_SEC;                \
+        double rate    = elapsed > 0.0 ? (n_bits) / elapsed / 1000.0 : 0.0;               \
+        printf("Time elapsed in ms: %f (%.1f Mbit/s) for: %s\n", elapsed, rate, label);   \
+    } while (0)
+
+#define ROW_BITS 1000
+#define REPEATS 20000
+
+static inline uint8_t bit_at(const uint8_t *bytes, unsigned bit)
+{
+    return (uint8_t)(bytes[bit >> 3] >> (7 - (bit & 7)) & 1);
+}
+
+/// The bit by bit search with backtracking, as a reference.
+static unsigned search_bitwise(bitbuffer_t *bitbuffer, unsigned row, unsigned start,
+        const uint8_t *pattern, unsigned pattern_bits_len)
+{
+    uint8_t *bits = bitbuffer->bb[row];
+    unsigned len  = bitbuffer->bits_per_row[row];
+    unsigned ipos = start;
+    unsigned ppos = 0;
+
+    while (ipos < len && ppos < pattern_bits_len) {
+        if (bit_at(bits, ipos) == bit_at(pattern, ppos)) {
+            ppos++;
+            ipos++;
+            if (ppos == pattern_bits_len)
+                return ipos - pattern_bits_len;
+        }
+        else {
+            ipos -= ppos;
+            ipos++;
+            ppos = 0;
+        }
+    }
+    return len;
+}
+
+/// The bit by bit Manchester decoder, as a reference.
+static unsigned manchester_bitwise(bitbuffer_t *inbuf, unsigned row, unsigned start,
+        bitbuffer_t *outbuf, unsigned max)
+{
+    uint8_t *bits     = inbuf->bb[row];
+    unsigned int len  = inbuf->bits_per_row[row];
+    unsigned int ipos = start;
+
+    if (max && len > start + (max * 2))
+        len = start + (max * 2);
+
+    while (ipos < len) {
+        uint8_t bit1, bit2;
+
+        bit1 = bit_at(bits, ipos++);
+        bit2 = bit_at(bits, ipos++);
+
+        if (bit1 == bit2)
+            break;
+
+        bitbuffer_add_bit(outbuf, bit2);
+    }
+
+    return ipos;
+}
+
+/// The bit by bit differential Manchester decoder, as a reference.
+static unsigned dmc_bitwise(bitbuffer_t *inbuf, unsigned row, unsigned start,
+        bitbuffer_t *outbuf, unsigned max)
+{
+    uint8_t *bits     = inbuf->bb[row];
+    unsigned int len  = inbuf->bits_per_row[row];
+    unsigned int ipos = start;
+    uint8_t bit1, bit2 = 0;
+
+    if (max && len > start + (max * 2))
+        len = start + (max * 2);
+
+    while (ipos < len) {
+        bit1 = bit_at(bits, ipos++);
+        bit2 = bit_at(bits, ipos++);
+        uint8_t bit3 = bit_at(bits, ipos);
+
+        if (bit1 != bit2) {
+            if (bit2 != bit3) {
+                bitbuffer_add_bit(outbuf, 0);
+            }
+            else {
+                bit2 = bit1;
+                ipos -= 1;
+                break;
+            }
+        }
+        else {
+            bit2 = 1 - bit1;
+            ipos -= 2;
+            break;
+        }
+    }
+
+    while (ipos < len) {
+        bit1 = bit_at(bits, ipos++);
+        if (bit1 == bit2)
+            break; // clock missing, abort
+        bit2 = bit_at(bits, ipos++);
+
+        if (bit1 == bit2)
+            bitbuffer_add_bit(outbuf, 1);
+        else
+            bitbuffer_add_bit(outbuf, 0);
+    }
+
+    return ipos;
+}
+
+typedef unsigned (*decode_fn)(bitbuffer_t *inbuf, unsigned row, unsigned start, bitbuffer_t *outbuf, unsigned max);
+
+/// Compare a decoder to its reference on random rows, mostly valid encodings with errors sprinkled in.
+static int check_decoder(char const *name, decode_fn decode, decode_fn reference, int differential)
+{
+    static bitbuffer_t in  = {0};
+    static bitbuffer_t out = {0};
+    static bitbuffer_t ref = {0};
+    int failed = 0;
+
+    for (int t = 0; t < 20000; ++t) {
+        bitbuffer_clear(&in);
+        unsigned len = rand() % 400;
+        int level    = rand() & 1;
+        while (in.bits_per_row[0] < len) {
+            int bit = rand() & 1;
+            if (differential) {
+                level ^= 1; // clock transition
+                bitbuffer_add_bit(&in, level);
+                level ^= !bit;
+                bitbuffer_add_bit(&in, level);
+            }
+            else {
+                bitbuffer_add_bit(&in, !bit);
+                bitbuffer_add_bit(&in, bit);
+            }
+            if (rand() % 200 == 0)
+                bitbuffer_add_bit(&in, rand() & 1);
+        }
+        unsigned start = rand() % 4 ? 0 : rand() % 20;
+        unsigned max   = rand() % 4 ? 0 : rand() % 150;
+        bitbuffer_clear(&out);
+        bitbuffer_clear(&ref);
+        unsigned pos  = decode(&in, 0, start, &out, max);
+        unsigned want = reference(&in, 0, start, &ref, max);
+        if (pos != want || out.num_rows != ref.num_rows || out.bits_per_row[0] != ref.bits_per_row[0]
+                || memcmp(out.bb[0], ref.bb[0], (ref.bits_per_row[0] + 7) / 8)) {
+            failed++;
+        }
+    }
+    if (failed)
+        fprintf(stderr, "FAIL: %s differs from the bitwise decoder %d times\n", name, failed);
+    return failed;
+}
+
+/// Decode a valid encoding of a row of ROW_BITS bits repeatedly.
+static void bench_decoder(char const *name, decode_fn decode, int differential)
+{
+    static bitbuffer_t in  = {0};
+    static bitbuffer_t out = {0};
+    unsigned sum = 0;
+
+    bitbuffer_clear(&in);
+    int level = 0;
+    for (unsigned n = 0; n < ROW_BITS / 2; ++n) {
+        int bit = rand() & 1;
+        if (differential) {
+            level ^= 1;
+            bitbuffer_add_bit(&in, level);
+            level ^= !bit;
+            bitbuffer_add_bit(&in, level);
+        }
+        else {
+            bitbuffer_add_bit(&in, !bit);
+            bitbuffer_add_bit(&in, bit);
+        }
+    }
+    MEASURE_RATE(name, (double)ROW_BITS * REPEATS, {
+        for (int r = 0; r < REPEATS; ++r) {
+            bitbuffer_clear(&out);
+            sum += decode(&in, 0, 0, &out, 0);
+        }
+    });
+    if (sum != (unsigned)ROW_BITS * REPEATS)
+        fprintf(stderr, "FAIL: %s stopped early\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+    static bitbuffer_t bits = {0};
+    // preamble like patterns of alternating bits and sync words
+    uint8_t const patterns[][4] = {
+            {0xaa, 0xa9},
+            {0xaa, 0xaa, 0x2d},
+            {0xaa, 0xaa, 0x2d, 0xd4},
+    };
+    unsigned const pattern_lens[] = {16, 24, 32};
+    int failed = 0;
+    int bench  = argc < 2 || strcmp(argv[1], "check");
+
+    srand(1);
+    for (int i = 0; i < 3; ++i) {
+        uint8_t const *pattern = patterns[i];
+        unsigned plen          = pattern_lens[i];
+
+        // a preamble over random bits, the pattern is found at the end of the row only
+        bitbuffer_clear(&bits);
+        bitbuffer_add_bits(&bits, 0, 7);
+        for (unsigned n = 0; n < ROW_BITS / 2 / 8; ++n) {
+            bitbuffer_add_word(&bits, 0xaa, 8);
+        }
+        while (bits.bits_per_row[0] < ROW_BITS - plen) {
+            bitbuffer_add_bit(&bits, rand() & 1);
+        }
+        unsigned pos = search_bitwise(&bits, 0, 0, pattern, plen);
+        if (pos == bits.bits_per_row[0]) {
+            for (unsigned n = plen; n > 0; --n) {
+                bitbuffer_add_bit(&bits, pattern[(plen - n) / 8] >> (7 - (plen - n) % 8) & 1);
+            }
+            pos = search_bitwise(&bits, 0, 0, pattern, plen);
+        }
+        if (bitbuffer_search(&bits, 0, 0, pattern, plen) != pos) {
+            fprintf(stderr, "FAIL: search for %u bit pattern\n", plen);
+            failed++;
+        }
+        if (!bench)
+            continue;
+
+        char label[64];
+        unsigned sum = 0;
+        snprintf(label, sizeof(label), "bitwise search %u bits at %u", plen, pos);
+        MEASURE_RATE(label, (double)pos * REPEATS, {
+            for (int r = 0; r < REPEATS; ++r)
+                sum += search_bitwise(&bits, 0, 0, pattern, plen);
+        });
+        snprintf(label, sizeof(label), "bitbuffer_search %u bits at %u", plen, pos);
+        MEASURE_RATE(label, (double)pos * REPEATS, {
+            for (int r = 0; r < REPEATS; ++r)
+                sum += bitbuffer_search(&bits, 0, 0, pattern, plen);
+        });
+        bitbuffer_pattern_t compiled;
+        bitbuffer_pattern_compile(&compiled, pattern, plen);
+        snprintf(label, sizeof(label), "bitbuffer_search_compiled %u bits at %u", plen, pos);
+        MEASURE_RATE(label, (double)pos * REPEATS, {
+            for (int r = 0; r < REPEATS; ++r)
+                sum += bitbuffer_search_compiled(&bits, 0, 0, &compiled);
+        });
+        if (sum != 3 * REPEATS * pos) {
+            fprintf(stderr, "FAIL: repeated search for %u bit pattern\n", plen);
+            failed++;
+        }
+    }
+
+    failed += check_decoder("bitbuffer_manchester_decode", bitbuffer_manchester_decode, manchester_bitwise, 0);
+    failed += check_decoder("bitbuffer_differential_manchester_decode", bitbuffer_differential_manchester_decode, dmc_bitwise, 1);
+    if (bench) {
+        bench_decoder("bitwise Manchester decode", manchester_bitwise, 0);
+        bench_decoder("bitbuffer_manchester_decode", bitbuffer_manchester_decode, 0);
+        bench_decoder("bitwise differential Manchester decode", dmc_bitwise, 1);
+        bench_decoder("bitbuffer_differential_manchester_decode", bitbuffer_differential_manchester_decode, 1);
+    }
+
+    return failed ? 1 : 0;
+}
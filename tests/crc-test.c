@@ -0,0 +1,122 @@
+/*
+ * CRC Evaluation
+ *
+ * Functional and speed test for the table driven CRC functions.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bit_util.h"
+
+#define MEASURE_RATE(label, n_bytes, block)                                               \
+    do {                                                                                  \
+        clock_t start = clock();                                                          \
+        block;                                                                            \
+        clock_t stop   = clock();                                                         \
+        double elapsed = (double)(stop - start) * 1000.0 / CLOCKS_PER_SEC;                \
+        double rate    = elapsed > 0.0 ? (n_bytes) / elapsed / 1000.0 : 0.0;              \
+        printf("Time elapsed in ms: %f (%.1f MB/s) for: %s\n", elapsed, rate, label);     \
+    } while (0)
+
+#define MSG_BYTES 4096
+#define TOTAL_BYTES 20000000
+
+/// The bit by bit CRC-8, as a reference.
+static uint8_t crc8_bitwise(uint8_t const message[], unsigned nBytes, uint8_t polynomial, uint8_t init)
+{
+    uint8_t remainder = init;
+    unsigned byte, bit;
+
+    for (byte = 0; byte < nBytes; ++byte) {
+        remainder ^= message[byte];
+        for (bit = 0; bit < 8; ++bit) {
+            if (remainder & 0x80) {
+                remainder = (remainder << 1) ^ polynomial;
+            } else {
+                remainder = (remainder << 1);
+            }
+        }
+    }
+    return remainder;
+}
+
+/// The bit by bit CRC-16, as a reference.
+static uint16_t crc16_bitwise(uint8_t const message[], unsigned nBytes, uint16_t polynomial, uint16_t init)
+{
+    uint16_t remainder = init;
+    unsigned byte, bit;
+
+    for (byte = 0; byte < nBytes; ++byte) {
+        remainder ^= message[byte] << 8;
+        for (bit = 0; bit < 8; ++bit) {
+            if (remainder & 0x8000) {
+                remainder = (remainder << 1) ^ polynomial;
+            }
+            else {
+                remainder = (remainder << 1);
+            }
+        }
+    }
+    return remainder;
+}
+
+int main(void)
+{
+    static uint8_t msg[MSG_BYTES];
+    // typical sensor messages and a long block
+    unsigned const lens[] = {5, 10, 32, 256};
+    int failed = 0;
+
+    srand(1);
+    for (unsigned i = 0; i < MSG_BYTES; ++i) {
+        msg[i] = rand() & 0xff;
+    }
+
+    for (unsigned i = 0; i < sizeof(lens) / sizeof(*lens); ++i) {
+        unsigned len   = lens[i];
+        unsigned count = TOTAL_BYTES / len;
+        unsigned sum_a = 0;
+        unsigned sum_b = 0;
+        char label[64];
+
+        snprintf(label, sizeof(label), "bitwise crc8 %u bytes", len);
+        MEASURE_RATE(label, (double)count * len, {
+            for (unsigned n = 0; n < count; ++n)
+                sum_a += crc8_bitwise(&msg[n % (MSG_BYTES - len)], len, 0x31, 0x00);
+        });
+        snprintf(label, sizeof(label), "crc8 %u bytes", len);
+        MEASURE_RATE(label, (double)count * len, {
+            for (unsigned n = 0; n < count; ++n)
+                sum_b += crc8(&msg[n % (MSG_BYTES - len)], len, 0x31, 0x00);
+        });
+        if (sum_a != sum_b) {
+            fprintf(stderr, "FAIL: crc8 %u bytes\n", len);
+            failed++;
+        }
+
+        sum_a = sum_b = 0;
+        snprintf(label, sizeof(label), "bitwise crc16 %u bytes", len);
+        MEASURE_RATE(label, (double)count * len, {
+            for (unsigned n = 0; n < count; ++n)
+                sum_a += crc16_bitwise(&msg[n % (MSG_BYTES - len)], len, 0x1021, 0xffff);
+        });
+        snprintf(label, sizeof(label), "crc16 %u bytes", len);
+        MEASURE_RATE(label, (double)count * len, {
+            for (unsigned n = 0; n < count; ++n)
+                sum_b += crc16(&msg[n % (MSG_BYTES - len)], len, 0x1021, 0xffff);
+        });
+        if (sum_a != sum_b) {
+            fprintf(stderr, "FAIL: crc16 %u bytes\n", len);
+            failed++;
+        }
+    }
+
+    return failed ? 1 : 0;
+}
@@ -19,10 +19,100 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "data.h"
 #include "output_file.h"
 
+#define EVENTS 1000000
+
+// not with sanitizers, which replace malloc themselves (clang does not define __SANITIZE_ADDRESS__)
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__clang__)
+// Count the heap allocations, glibc allows to replace malloc, strdup() is replaced to use it
+#define COUNT_ALLOCS
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static unsigned long num_allocs;
+
+void *malloc(size_t size)
+{
+    ++num_allocs;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    ++num_allocs;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    ++num_allocs;
+    return __libc_realloc(ptr, size);
+}
+
+char *strdup(char const *str)
+{
+    size_t len = strlen(str) + 1;
+    char *copy = malloc(len);
+    if (copy)
+        memcpy(copy, str, len);
+    return copy;
+}
+#endif
+
+/// A typical sensor event with the meta data and time fields rtl_433 adds.
+static data_t *make_event(int id, double temp)
+{
+    /* clang-format off */
+    data_t *data = data_make(
+            "model",            "",             DATA_STRING, "Acurite-Tower",
+            "id",               "",             DATA_INT,    id,
+            "channel",          "",             DATA_STRING, "A",
+            "battery_ok",       "Battery",      DATA_INT,    1,
+            "temperature_C",    "Temperature",  DATA_FORMAT, "%.1f C", DATA_DOUBLE, temp,
+            "humidity",         "Humidity",     DATA_FORMAT, "%u %%", DATA_INT, 45,
+            "mic",              "Integrity",    DATA_STRING, "CHECKSUM",
+            NULL);
+    /* clang-format on */
+    data = data_prepend(data, data_int(NULL, "protocol", "Protocol", NULL, 40));
+    data = data_str(data, "mod",   "Modulation",  NULL,         "ASK");
+    data = data_dbl(data, "freq",  "Freq",        "%.1f MHz",   433.92);
+    data = data_dbl(data, "rssi",  "RSSI",        "%.1f dB",    -12.1);
+    data = data_dbl(data, "snr",   "SNR",         "%.1f dB",    18.5);
+    data = data_dbl(data, "noise", "Noise",       "%.1f dB",    -30.6);
+    data = data_prepend(data, data_str(NULL, "time", "", NULL, "2024-01-01 12:00:00"));
+    return data;
+}
+
+static void bench_events(void)
+{
+    double sum = 0.0;
+#ifdef COUNT_ALLOCS
+    unsigned long allocs = num_allocs;
+#endif
+    clock_t start = clock();
+    for (int i = 0; i < EVENTS; ++i) {
+        data_t *data = make_event(i, 20.0 + i % 100 * 0.1);
+        // the HTTP history and MQTT outputs keep events around
+        data_retain(data);
+        sum += data->next->next->next->value.v_int;
+        data_free(data);
+        data_free(data);
+    }
+    clock_t stop   = clock();
+    double elapsed = (double)(stop - start) * 1000.0 / CLOCKS_PER_SEC;
+    fprintf(stderr, "Time elapsed in ms: %f for: %d events (%.0f)\n", elapsed, EVENTS, sum);
+#ifdef COUNT_ALLOCS
+    fprintf(stderr, "Heap allocations per event: %.1f\n", (double)(num_allocs - allocs) / EVENTS);
+#endif
+}
+
 int main(void)
 {
     /* clang-format off */
@@ -54,4 +144,6 @@ int main(void)
     data_output_free(csv_output);
 
     data_free(data);
+
+    bench_events();
 }
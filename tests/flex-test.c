@@ -0,0 +1,153 @@
+/*
+ * Flex decoder Evaluation
+ *
+ * Speed test for the flex decoders of the given conf files, e.g.
+ *   flex-test ../conf/<name>.conf ...
+ * The checksum over all outputs needs to stay the same across changes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "r_device.h"
+#include "bitbuffer.h"
+#include "confparse.h"
+#include "data.h"
+
+#define MEASURE_RATE(label, n_calls, block)                                               \
+    do {                                                                                  \
+        clock_t start = clock();                                                          \
+        block;                                                                            \
+        clock_t stop   = clock();                                                         \
+        double elapsed = (double)(stop - start) * 1000.0 / CLOCKS_PER_SEC;                \
+        double rate    = elapsed > 0.0 ? (n_calls) / elapsed / 1000.0 : 0.0;              \
+        printf("Time elapsed in ms: %f (%.2f M calls/s) for: %s\n", elapsed, rate, label); \
+    } while (0)
+
+#define MAX_DECODERS 256
+#define NUM_PACKAGES 2000
+#define ROUNDS 20
+
+r_device *flex_create_device(char *spec);
+
+static unsigned long num_outputs;
+static uint32_t checksum = 2166136261u;
+static int hash_outputs; // the timed run only counts the outputs
+
+/// Hash the JSON of each output, FNV-1a.
+static void hash_output(r_device *decoder, data_t *data)
+{
+    (void)decoder;
+    num_outputs++;
+    if (!hash_outputs) {
+        data_free(data);
+        return;
+    }
+    char buf[4096];
+    size_t len = data_print_jsons(data, buf, sizeof(buf));
+    for (size_t i = 0; i < len; ++i) {
+        checksum = (checksum ^ (uint8_t)buf[i]) * 16777619u;
+    }
+    data_free(data);
+}
+
+/// Typical lengths and some noise, repeated rows in half of the packages.
+static void make_package(bitbuffer_t *bits)
+{
+    unsigned const lens[] = {12, 24, 25, 32, 36, 40, 42, 48, 56, 64, 65, 72, 80, 88, 96, 128};
+    bitbuffer_clear(bits);
+    unsigned num_rows = 1 + rand() % 8;
+    unsigned len      = rand() % 4 ? lens[rand() % 16] : 1 + (unsigned)rand() % 160;
+    int repeated      = rand() % 2;
+    uint8_t row[BITBUF_COLS];
+    for (unsigned r = 0; r < num_rows; ++r) {
+        if (r == 0 || !repeated) {
+            for (unsigned i = 0; i < BITBUF_COLS; ++i) {
+                row[i] = rand() & 0xff;
+            }
+        }
+        if (r > 0)
+            bitbuffer_add_row(bits);
+        for (unsigned b = 0; b < len; ++b) {
+            bitbuffer_add_bit(bits, row[b / 8] >> (7 - b % 8) & 1);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static r_device *decoders[MAX_DECODERS];
+    static bitbuffer_t packages[NUM_PACKAGES];
+    static bitbuffer_t work;
+    // other keywords in the conf files are skipped
+    struct conf_keywords const keywords[] = {
+            {"decoder", 'X'},
+            {"frequency", 0},
+            {"sample_rate", 0},
+            {"gain", 0},
+            {"protocol", 0},
+            {"pulse_detect", 0},
+            {"report_meta", 0},
+            {"output", 0},
+            {"convert", 0},
+            {NULL, 0}};
+    unsigned num_decoders = 0;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <conf file>...\n", argv[0]);
+        return 1;
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        char *conf = readconf(argv[i]);
+        char *p    = conf;
+        char *arg;
+        int opt;
+        while (conf && (opt = getconf(&p, keywords, &arg)) != -1) {
+            if (opt != 'X' || num_decoders >= MAX_DECODERS)
+                continue;
+            r_device *dev = flex_create_device(arg);
+            if (!dev)
+                continue;
+            dev->output_fn           = hash_output;
+            decoders[num_decoders++] = dev;
+        }
+    }
+    printf("Loaded %u flex decoders\n", num_decoders);
+
+    srand(1);
+    for (unsigned k = 0; k < NUM_PACKAGES; ++k) {
+        make_package(&packages[k]);
+    }
+
+    unsigned long calls = (unsigned long)ROUNDS * NUM_PACKAGES * num_decoders;
+    MEASURE_RATE("flex decoders on random packages", calls, {
+        for (unsigned n = 0; n < ROUNDS; ++n) {
+            for (unsigned k = 0; k < NUM_PACKAGES; ++k) {
+                for (unsigned d = 0; d < num_decoders; ++d) {
+                    bitbuffer_copy(&work, &packages[k]);
+                    decoders[d]->decode_fn(decoders[d], &work);
+                }
+            }
+        }
+    });
+    printf("Outputs: %lu\n", num_outputs);
+
+    hash_outputs = 1;
+    for (unsigned k = 0; k < NUM_PACKAGES; ++k) {
+        for (unsigned d = 0; d < num_decoders; ++d) {
+            bitbuffer_copy(&work, &packages[k]);
+            decoders[d]->decode_fn(decoders[d], &work);
+        }
+    }
+    printf("Checksum: %08x\n", checksum);
+
+    return 0;
+}
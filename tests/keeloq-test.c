@@ -0,0 +1,82 @@
+/*
+ * Keeloq Evaluation
+ *
+ * Functional and speed test for the batch Keeloq decryption.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bit_util.h"
+
+#define MEASURE_RATE(label, n_keys, block)                                                \
+    do {                                                                                  \
+        clock_t start = clock();                                                          \
+        block;                                                                            \
+        clock_t stop   = clock();                                                         \
+        double elapsed = (double)(stop - start) * 1000.0 / CLOCKS_PER_SEC;                \
+        double rate    = elapsed > 0.0 ? (n_keys) / elapsed / 1000.0 : 0.0;               \
+        printf("Time elapsed in ms: %f (%.3f M/s) for: %s\n", elapsed, rate, label);      \
+    } while (0)
+
+#define NUM_KEYS 1024
+#define REPEATS 200
+
+int main(void)
+{
+    static uint64_t keys[NUM_KEYS];
+    static uint32_t data[NUM_KEYS];
+    static uint32_t scalar[NUM_KEYS];
+    static uint32_t batch[NUM_KEYS];
+    int failed = 0;
+
+    srand(1);
+    for (unsigned i = 0; i < NUM_KEYS; ++i) {
+        keys[i] = (uint64_t)rand() << 40 ^ (uint64_t)rand() << 20 ^ rand();
+        data[i] = (uint32_t)rand() << 16 ^ rand();
+    }
+
+    // one code under a list of manufacturer keys
+    MEASURE_RATE("keeloq_common_decrypt keys", (double)NUM_KEYS * REPEATS, {
+        for (int r = 0; r < REPEATS; ++r)
+            for (unsigned i = 0; i < NUM_KEYS; ++i)
+                scalar[i] = keeloq_common_decrypt(data[r], keys[i]);
+    });
+    MEASURE_RATE("keeloq_common_decrypt_keys", (double)NUM_KEYS * REPEATS, {
+        for (int r = 0; r < REPEATS; ++r)
+            keeloq_common_decrypt_keys(data[r], keys, NUM_KEYS, batch);
+    });
+    for (unsigned i = 0; i < NUM_KEYS; ++i) {
+        if (scalar[i] != batch[i]) {
+            fprintf(stderr, "FAIL: keeloq_common_decrypt_keys key %u\n", i);
+            failed++;
+            break;
+        }
+    }
+
+    // many codes under one key
+    MEASURE_RATE("keeloq_common_decrypt blocks", (double)NUM_KEYS * REPEATS, {
+        for (int r = 0; r < REPEATS; ++r)
+            for (unsigned i = 0; i < NUM_KEYS; ++i)
+                scalar[i] = keeloq_common_decrypt(data[i], keys[r]);
+    });
+    MEASURE_RATE("keeloq_common_decrypt_blocks", (double)NUM_KEYS * REPEATS, {
+        for (int r = 0; r < REPEATS; ++r)
+            keeloq_common_decrypt_blocks(data, NUM_KEYS, keys[r], batch);
+    });
+    for (unsigned i = 0; i < NUM_KEYS; ++i) {
+        if (scalar[i] != batch[i]) {
+            fprintf(stderr, "FAIL: keeloq_common_decrypt_blocks block %u\n", i);
+            failed++;
+            break;
+        }
+    }
+
+    return failed ? 1 : 0;
+}
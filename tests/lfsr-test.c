@@ -0,0 +1,137 @@
+/*
+ * LFSR Digest Evaluation
+ *
+ * Functional and speed test for the table driven LFSR digests.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bit_util.h"
+
+#define MEASURE_RATE(label, n_bytes, block)                                               \
+    do {                                                                                  \
+        clock_t start = clock();                                                          \
+        block;                                                                            \
+        clock_t stop   = clock();                                                         \
+        double elapsed = (double)(stop - start) * 1000.0 / CLOCKS_PER_SEC;                \
+        double rate    = elapsed > 0.0 ? (n_bytes) / elapsed / 1000.0 : 0.0;              \
+        printf("Time elapsed in ms: %f (%.1f MB/s) for: %s\n", elapsed, rate, label);     \
+    } while (0)
+
+#define MSG_BYTES 4096
+#define TOTAL_BYTES 20000000
+
+/// The bit by bit Digest-8, as a reference.
+static uint8_t lfsr_digest8_bitwise(uint8_t const message[], unsigned bytes, uint8_t gen, uint8_t key)
+{
+    uint8_t sum = 0;
+    for (unsigned k = 0; k < bytes; ++k) {
+        uint8_t data = message[k];
+        for (int i = 7; i >= 0; --i) {
+            if ((data >> i) & 1)
+                sum ^= key;
+            if (key & 1)
+                key = (key >> 1) ^ gen;
+            else
+                key = (key >> 1);
+        }
+    }
+    return sum;
+}
+
+/// The bit by bit Digest-16, as a reference.
+static uint16_t lfsr_digest16_bitwise(uint8_t const message[], unsigned bytes, uint16_t gen, uint16_t key)
+{
+    uint16_t sum = 0;
+    for (unsigned k = 0; k < bytes; ++k) {
+        uint8_t data = message[k];
+        for (int i = 7; i >= 0; --i) {
+            if ((data >> i) & 1)
+                sum ^= key;
+            if (key & 1)
+                key = (key >> 1) ^ gen;
+            else
+                key = (key >> 1);
+        }
+    }
+    return sum;
+}
+
+int main(void)
+{
+    static uint8_t msg[MSG_BYTES];
+    // message lengths of Ambient Weather, TP-82xB and Bresser 7-in-1
+    unsigned const lens[] = {5, 11, 23};
+    int failed = 0;
+
+    srand(1);
+    for (unsigned i = 0; i < MSG_BYTES; ++i) {
+        msg[i] = rand() & 0xff;
+    }
+
+    for (unsigned i = 0; i < sizeof(lens) / sizeof(*lens); ++i) {
+        unsigned len   = lens[i];
+        unsigned count = TOTAL_BYTES / len;
+        unsigned sum_a = 0;
+        unsigned sum_b = 0;
+        char label[64];
+
+        // like a decoder trying every row offset
+        snprintf(label, sizeof(label), "bitwise lfsr_digest8 %u bytes", len);
+        MEASURE_RATE(label, (double)count * len, {
+            for (unsigned n = 0; n < count; ++n)
+                sum_a += lfsr_digest8_bitwise(&msg[n % (MSG_BYTES - len)], len, 0x98, 0x3e);
+        });
+        snprintf(label, sizeof(label), "lfsr_digest8 %u bytes", len);
+        MEASURE_RATE(label, (double)count * len, {
+            for (unsigned n = 0; n < count; ++n)
+                sum_b += lfsr_digest8(&msg[n % (MSG_BYTES - len)], len, 0x98, 0x3e);
+        });
+        if (sum_a != sum_b) {
+            fprintf(stderr, "FAIL: lfsr_digest8 %u bytes\n", len);
+            failed++;
+        }
+
+        sum_a = sum_b = 0;
+        snprintf(label, sizeof(label), "bitwise lfsr_digest16 %u bytes", len);
+        MEASURE_RATE(label, (double)count * len, {
+            for (unsigned n = 0; n < count; ++n)
+                sum_a += lfsr_digest16_bitwise(&msg[n % (MSG_BYTES - len)], len, 0x8810, 0xba95);
+        });
+        snprintf(label, sizeof(label), "lfsr_digest16 %u bytes", len);
+        MEASURE_RATE(label, (double)count * len, {
+            for (unsigned n = 0; n < count; ++n)
+                sum_b += lfsr_digest16(&msg[n % (MSG_BYTES - len)], len, 0x8810, 0xba95);
+        });
+        if (sum_a != sum_b) {
+            fprintf(stderr, "FAIL: lfsr_digest16 %u bytes\n", len);
+            failed++;
+        }
+    }
+
+    // worst case, more keys than the tables are cached for
+    unsigned count = TOTAL_BYTES / 5 / 10;
+    unsigned sum_a = 0;
+    unsigned sum_b = 0;
+    MEASURE_RATE("bitwise lfsr_digest8 5 bytes, 64 keys", (double)count * 5, {
+        for (unsigned n = 0; n < count; ++n)
+            sum_a += lfsr_digest8_bitwise(&msg[n % (MSG_BYTES - 5)], 5, 0x98, n % 64);
+    });
+    MEASURE_RATE("lfsr_digest8 5 bytes, 64 keys", (double)count * 5, {
+        for (unsigned n = 0; n < count; ++n)
+            sum_b += lfsr_digest8(&msg[n % (MSG_BYTES - 5)], 5, 0x98, n % 64);
+    });
+    if (sum_a != sum_b) {
+        fprintf(stderr, "FAIL: lfsr_digest8 with 64 keys\n");
+        failed++;
+    }
+
+    return failed ? 1 : 0;
+}